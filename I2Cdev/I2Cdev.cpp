@@ -3,6 +3,8 @@
 // 2013-06-05 by Jeff Rowberg <jeff@rowberg.net>
 //
 // Changelog:
+//      2026-10-17 - add asynchronous job queue (submitRead/submitWrite/poll)
+//      2026-10-17 - add readBurst() with 16-bit length, fix readWords() chunking
 //      2013-05-06 - add Francesco Ferrara's Fastwire v0.24 implementation with small modifications
 //      2013-05-05 - fix issue with writing bit values to words (Sasquatch/Farzanegan)
 //      2012-06-09 - fix major issue with reading > 32 bytes at a time with Arduino Wire
@@ -45,6 +47,12 @@ THE SOFTWARE.
 
 #include "I2Cdev.h"
 
+#ifdef I2CDEV_ENABLE_STATS
+    #include <string.h>
+    #define I2CDEV_STATS(call) call
+#else
+    #define I2CDEV_STATS(call)
+#endif
 
 /** Default constructor.
  */
@@ -159,28 +167,80 @@ char I2Cdev::readWord(unsigned char devAddr, unsigned char regAddr, unsigned sho
  * @param length Number of bytes to read
  * @param data Buffer to store read data in
  * @param timeout Optional read timeout in milliseconds (0 to disable, leave off to use default class value in I2Cdev::readTimeout)
- * @return Number of bytes read (-1 indicates failure)
+ * @return Number of bytes read (-1 indicates failure; use readBurst() for more than 127 bytes)
+ * @see readBurst()
  */
 char I2Cdev::readBytes(unsigned char devAddr, unsigned char regAddr, unsigned char length, unsigned char *data, unsigned short timeout) {
+    int16 count = readBurst(devAddr, regAddr, length, data, timeout);
+    return count < 0 ? -1 : (char)count;
+}
 
-    char count = 0;
+/** Read an arbitrarily long block from an 8-bit device register.
+ * The register address is sent once; the data is then clocked in as
+ * BUFFER_LENGTH-sized chunks without re-addressing, so the device's own
+ * pointer carries on between chunks (auto-increment for normal registers,
+ * the same port for FIFO_R_W/MEM_R_W style registers). With
+ * I2CDEV_REPEATED_START the chunks follow repeated STARTs and only the last
+ * one ends with a STOP.
+ * @param devAddr I2C slave device address
+ * @param regAddr First register regAddr to read from
+ * @param length Number of bytes to read (e.g. a whole 512-byte FIFO)
+ * @param data Buffer to store read data in (at least length bytes)
+ * @param timeout Optional read timeout in milliseconds (0 to disable, leave off to use default class value in I2Cdev::readTimeout)
+ * @return Number of bytes read (-1 indicates failure: NACK, a short chunk or timeout)
+ */
+int16 I2Cdev::readBurst(unsigned char devAddr, unsigned char regAddr, uint16 length, unsigned char *data, unsigned short timeout) {
+    uint16 count = 0;
     unsigned int t1 = millis();
+    I2CDEV_STATS(statsBegin(devAddr, regAddr));
+
+    Wire.beginTransmission(devAddr);
+    Wire.write(regAddr);
+#if I2CDEV_REPEATED_START
+    unsigned char status = Wire.endTransmission(false); // keep the bus, no STOP
+    I2CDEV_STATS(statsTransfer(false, 1, 0, status != 0));
+#else
+    unsigned char status = Wire.endTransmission();
+    I2CDEV_STATS(statsTransfer(false, 1, 0, true));
+#endif
+    if (status != 0) {
+        I2CDEV_STATS(statsEnd());
+        return -1;
+    }
 
-            for (unsigned char k = 0; k < length; k += min(length, BUFFER_LENGTH)) {
+    for (uint16 k = 0; k < length; k += BUFFER_LENGTH) {
+        unsigned char chunk = min(length - k, BUFFER_LENGTH);
+#if I2CDEV_REPEATED_START
+        unsigned char last = k + chunk >= length;
+        unsigned char received = Wire.requestFrom(devAddr, chunk, last);
+        I2CDEV_STATS(statsTransfer(true, 0, received, last));
+#else
+        unsigned char received = Wire.requestFrom(devAddr, chunk);
+        I2CDEV_STATS(statsTransfer(false, 0, received, true));
+#endif
+        (void)received;
+
+        for (; Wire.available() && count < k + chunk; count++) {
+            data[count] = Wire.read();
+        }
+
+        // a short chunk (NACK, bus error) or an expired timeout ends the
+        // burst: the device pointer is no longer where the next chunk expects it
+        if (count < k + chunk || (timeout > 0 && millis() - t1 >= timeout && count < length)) {
+#if I2CDEV_REPEATED_START
+            if (!last) {
+                // the chunk ended without STOP; release the bus
                 Wire.beginTransmission(devAddr);
-                Wire.write(regAddr);
                 Wire.endTransmission();
-                Wire.beginTransmission(devAddr);
-                Wire.requestFrom(devAddr, (unsigned char)min(length - k, BUFFER_LENGTH));
-        
-                for (; Wire.available() && (timeout == 0 || millis() - t1 < timeout); count++) {
-                    data[count] = Wire.read();
-
-                }
+                I2CDEV_STATS(statsTransfer(true, 0, 0, true));
             }
-            
-    if (timeout > 0 && millis() - t1 >= timeout && count < length) count = -1; // timeout
+#endif
+            I2CDEV_STATS(statsEnd());
+            return -1;
+        }
+    }
 
+    I2CDEV_STATS(statsEnd());
     return count;
 }
 
@@ -193,36 +253,17 @@ char I2Cdev::readBytes(unsigned char devAddr, unsigned char regAddr, unsigned ch
  * @return Number of words read (-1 indicates failure)
  */
 char I2Cdev::readWords(unsigned char devAddr, unsigned char regAddr, unsigned char length, unsigned short *data, unsigned short timeout) {
-    char count = 0;
-    unsigned int t1 = millis();
-
-            for (unsigned char k = 0; k < length * 2; k += min(length * 2, BUFFER_LENGTH)) {
-                Wire.beginTransmission(devAddr);
-                Wire.write(regAddr);
-                Wire.endTransmission();
-                Wire.beginTransmission(devAddr);
-                Wire.requestFrom(devAddr, (unsigned char)(length * 2)); // length=words, this wants bytes
-        
-                boolean msb = true; // starts with MSB, then LSB
-                for (; Wire.available() && count < length && (timeout == 0 || millis() - t1 < timeout);) {
-                    if (msb) {
-                        // first byte is bits 15-8 (MSb=15)
-                        data[count] = Wire.read() << 8;
-                    } else {
-                        // second byte is bits 7-0 (LSb=0)
-                        data[count] |= Wire.read();
-                        count++;
-                    }
-                    msb = !msb;
-                }
-        
-                Wire.endTransmission();
-            }
-
-
-
-    if (timeout > 0 && millis() - t1 >= timeout && count < length) count = -1; // timeout
-    return count;
+    // read the raw big-endian bytes straight into the word buffer, then
+    // assemble in place (word i only ever reads bytes 2i and 2i+1)
+    unsigned char *bytes = (unsigned char *)data;
+    int16 count = readBurst(devAddr, regAddr, (uint16)length * 2, bytes, timeout);
+    if (count < 0) return -1;
+    count /= 2;
+    for (int16 i = 0; i < count; i++) {
+        // first byte is bits 15-8 (MSb=15), second byte is bits 7-0 (LSb=0)
+        data[i] = ((unsigned short)bytes[2*i] << 8) | bytes[2*i + 1];
+    }
+    return (char)count;
 }
 
 /** write a single bit in an 8-bit device register.
@@ -341,6 +382,7 @@ boolean I2Cdev::writeWord(unsigned char devAddr, unsigned char regAddr, unsigned
 boolean I2Cdev::writeBytes(unsigned char devAddr, unsigned char regAddr, unsigned char length, unsigned char* data) {
 
     byte status = 0;
+    I2CDEV_STATS(statsBegin(devAddr, regAddr));
 
         Wire.beginTransmission(devAddr);
         Wire.write((byte) regAddr); // send address
@@ -349,6 +391,8 @@ boolean I2Cdev::writeBytes(unsigned char devAddr, unsigned char regAddr, unsigne
             Wire.write((unsigned char) data[i]);
     }
         status = Wire.endTransmission();
+    I2CDEV_STATS(statsTransfer(false, length + 1, 0, true));
+    I2CDEV_STATS(statsEnd());
 
     return status == 0;
 }
@@ -363,6 +407,7 @@ boolean I2Cdev::writeBytes(unsigned char devAddr, unsigned char regAddr, unsigne
 boolean I2Cdev::writeWords(unsigned char devAddr, unsigned char regAddr, unsigned char length, unsigned short* data) {
 
     unsigned char status = 0;
+    I2CDEV_STATS(statsBegin(devAddr, regAddr));
 
 
         Wire.beginTransmission(devAddr);
@@ -373,9 +418,314 @@ boolean I2Cdev::writeWords(unsigned char devAddr, unsigned char regAddr, unsigne
             Wire.write((unsigned char)data[i++]);         // send LSB
     }
         status = Wire.endTransmission();
+    I2CDEV_STATS(statsTransfer(false, length * 2 + 1, 0, true));
+    I2CDEV_STATS(statsEnd());
     return status == 0;
 }
 
+/** Queue a register read to be carried out by poll().
+ * The read is split into BUFFER_LENGTH-sized steps; each poll() performs at
+ * most one step, so the caller can interleave other work (fusion math,
+ * servo and RC-100 I/O) with a long transfer. Like readBurst(), the register
+ * address is only sent with the first step and later steps rely on the
+ * device's own pointer, so avoid synchronous calls to the same device while
+ * its jobs are queued.
+ * @param devAddr I2C slave device address
+ * @param regAddr First register regAddr to read from
+ * @param length Number of bytes to read
+ * @param data Buffer to store read data in (must stay valid until completion)
+ * @param callback Optional function called from poll() when the job finishes
+ * @param context Passed through to the callback
+ * @return True if the job was queued, false if the queue is full
+ */
+boolean I2Cdev::submitRead(unsigned char devAddr, unsigned char regAddr, uint16 length, unsigned char *data, I2CdevCallback callback, void *context) {
+    return submit(devAddr, regAddr, false, length, data, callback, context);
+}
+
+/** Queue a register write to be carried out by poll().
+ * @param devAddr I2C slave device address
+ * @param regAddr First register address to write to
+ * @param length Number of bytes to write (at most BUFFER_LENGTH - 1)
+ * @param data Buffer to copy new data from (must stay valid until completion)
+ * @param callback Optional function called from poll() when the job finishes
+ * @param context Passed through to the callback
+ * @return True if the job was queued, false if the queue is full or the write is too long
+ */
+boolean I2Cdev::submitWrite(unsigned char devAddr, unsigned char regAddr, unsigned char length, unsigned char *data, I2CdevCallback callback, void *context) {
+    if (length > BUFFER_LENGTH - 1) return false;
+    return submit(devAddr, regAddr, true, length, data, callback, context);
+}
+
+/** Advance the job queue by at most one bus step.
+ * Call this from the main loop, or from a timer interrupt as long as the main
+ * loop does not make synchronous I2Cdev calls while jobs are queued.
+ * Completion callbacks run from inside poll().
+ *
+ * On the host simulator a step does not block: the transfer is issued, the
+ * on-wire time is accounted as "bus busy", and the step only completes on a
+ * later poll() once that much virtual time has passed, as it would with an
+ * interrupt/DMA driven controller.
+ * @return Number of jobs still queued
+ */
+uint8 I2Cdev::poll() {
+    if (polling) return getQueueCount();
+    polling = true;
+
+    if (queueHead != queueTail) {
+        I2CdevJob *job = &queue[queueHead];
+        boolean finished;
+#if I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIM
+        static boolean busy = false;
+        static boolean busyFinished = false;
+        static uint64 busyUntil = 0;
+        if (!busy) {
+            Wire.setDeferred(true);
+            busyFinished = step(job);
+            busyUntil = I2CdevSim::nanos() + Wire.takeDeferredNanos();
+            Wire.setDeferred(false);
+            busy = true;
+        }
+        finished = false;
+        if (I2CdevSim::nanos() >= busyUntil) {
+            busy = false;
+            finished = busyFinished;
+        }
+#else
+        finished = step(job);
+#endif
+        if (finished) {
+            int16 result = job->done == job->length ? (int16)job->done : -1;
+            I2CdevCallback callback = job->callback;
+            void *context = job->context;
+            queueHead = (queueHead + 1) % I2CDEV_QUEUE_LENGTH;
+            if (callback != 0) callback(result, context);
+        }
+    }
+
+    polling = false;
+    return getQueueCount();
+}
+
+/** Get number of jobs waiting in the queue (including the one in progress).
+ * @return Queued job count
+ */
+uint8 I2Cdev::getQueueCount() {
+    return (queueTail + I2CDEV_QUEUE_LENGTH - queueHead) % I2CDEV_QUEUE_LENGTH;
+}
+
+/** Run poll() until every queued job has completed.
+ */
+void I2Cdev::flushQueue() {
+    while (poll() > 0) {
+#if I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIM
+        I2CdevSim::advance(1000);
+#endif
+    }
+}
+
+boolean I2Cdev::submit(unsigned char devAddr, unsigned char regAddr, boolean write, uint16 length, unsigned char *data, I2CdevCallback callback, void *context) {
+    uint8 next = (queueTail + 1) % I2CDEV_QUEUE_LENGTH;
+    if (next == queueHead) return false; // full
+    I2CdevJob *job = &queue[queueTail];
+    job->devAddr = devAddr;
+    job->regAddr = regAddr;
+    job->write = write;
+    job->length = length;
+    job->data = data;
+    job->done = 0;
+    job->callback = callback;
+    job->context = context;
+    queueTail = next;
+    return true;
+}
+
+// perform one bus step of a job; returns true once the job is finished
+// (successfully or not). Every step ends with a STOP so the bus is free
+// between polls.
+boolean I2Cdev::step(I2CdevJob *job) {
+    I2CDEV_STATS(statsBegin(job->devAddr, job->regAddr));
+    boolean finished = true;
+    if (job->write) {
+        Wire.beginTransmission(job->devAddr);
+        Wire.write(job->regAddr);
+        for (uint16 i = 0; i < job->length; i++) Wire.write(job->data[i]);
+        if (Wire.endTransmission() == 0) job->done = job->length;
+        I2CDEV_STATS(statsTransfer(false, job->length + 1, 0, true));
+    } else {
+        unsigned char status = 0;
+        boolean repeated = false;
+        if (job->done == 0) {
+            Wire.beginTransmission(job->devAddr);
+            Wire.write(job->regAddr);
+#if I2CDEV_REPEATED_START
+            status = Wire.endTransmission(false); // keep the bus, no STOP
+            I2CDEV_STATS(statsTransfer(false, 1, 0, status != 0));
+            repeated = true;
+#else
+            status = Wire.endTransmission();
+            I2CDEV_STATS(statsTransfer(false, 1, 0, true));
+#endif
+        }
+        if (status == 0 && job->length > 0) {
+            unsigned char chunk = min(job->length - job->done, BUFFER_LENGTH);
+            unsigned char received = Wire.requestFrom(job->devAddr, chunk);      // ends with a STOP
+            I2CDEV_STATS(statsTransfer(repeated, 0, received, true));
+            for (unsigned char i = 0; i < received && Wire.available(); i++) {
+                job->data[job->done++] = Wire.read();
+            }
+            // keep going unless done or the device came up short
+            finished = received < chunk || job->done >= job->length;
+        }
+        (void)repeated;
+    }
+    I2CDEV_STATS(statsEnd());
+    return finished;
+}
+
+I2CdevJob I2Cdev::queue[I2CDEV_QUEUE_LENGTH];
+volatile uint8 I2Cdev::queueHead = 0;
+volatile uint8 I2Cdev::queueTail = 0;
+volatile boolean I2Cdev::polling = false;
+
+/** Set the bus clock used by the on-wire time model.
+ * The board's Wire library keeps its own clock; this value only feeds the
+ * wireMicros prediction (and, on the host simulator, Wire.setClock() so that
+ * simulated and predicted times agree).
+ * @param hz Bus clock in Hz (e.g. 100000, 400000, 1000000)
+ */
+void I2Cdev::setBusSpeed(uint32 hz) {
+    if (hz == 0) return;
+    busSpeed = hz;
+#if I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIM
+    Wire.setClock(hz);
+#endif
+}
+
+/** Get the bus clock used by the on-wire time model.
+ * @return Bus clock in Hz
+ */
+uint32 I2Cdev::getBusSpeed() {
+    return busSpeed;
+}
+
+#ifdef I2CDEV_ENABLE_STATS
+
+// bus activity of the call in progress
+static I2CdevStats statsCall;
+static uint32 statsCallBits;
+static uint32 statsCallStart;
+static unsigned char statsCallDevAddr;
+static unsigned char statsCallRegAddr;
+
+/** Get bus traffic totals since the last resetStats().
+ * Wrap a high-level call with resetStats()/getStats() to measure its cost.
+ * @return Totals over all devices and registers
+ */
+const I2CdevStats *I2Cdev::getStats() {
+    return &stats;
+}
+
+/** Get bus traffic for calls addressed to one device register.
+ * @param devAddr I2C slave device address
+ * @param regAddr First register address of the calls
+ * @return Counters, or 0 if no call used this devAddr/regAddr pair (or the
+ *         table was full when it first appeared)
+ */
+const I2CdevStats *I2Cdev::getStats(unsigned char devAddr, unsigned char regAddr) {
+    for (uint8 i = 0; i < statsEntryCount; i++) {
+        if (statsEntries[i].devAddr == devAddr && statsEntries[i].regAddr == regAddr) return &statsEntries[i].stats;
+    }
+    return 0;
+}
+
+/** Get number of devAddr/regAddr pairs tracked so far.
+ * @return Entry count (at most I2CDEV_STATS_ENTRIES)
+ */
+uint8 I2Cdev::getStatsEntryCount() {
+    return statsEntryCount;
+}
+
+/** Get one tracked devAddr/regAddr pair, in order of first use.
+ * @param index Entry index (0 to getStatsEntryCount() - 1)
+ * @return Entry, or 0 if index is out of range
+ */
+const I2CdevStatsEntry *I2Cdev::getStatsEntry(uint8 index) {
+    if (index >= statsEntryCount) return 0;
+    return &statsEntries[index];
+}
+
+/** Clear all bus traffic counters.
+ */
+void I2Cdev::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+    memset(statsEntries, 0, sizeof(statsEntries));
+    statsEntryCount = 0;
+}
+
+void I2Cdev::statsBegin(unsigned char devAddr, unsigned char regAddr) {
+    memset(&statsCall, 0, sizeof(statsCall));
+    statsCallBits = 0;
+    statsCallStart = micros();
+    statsCallDevAddr = devAddr;
+    statsCallRegAddr = regAddr;
+}
+
+/** Account for one addressed transfer: (repeated) START, address byte, data
+ * bytes and an optional STOP, each byte taking 9 SCL periods (8 + ACK).
+ */
+void I2Cdev::statsTransfer(boolean repeated, unsigned char bytesOut, unsigned char bytesIn, boolean stop) {
+    statsCall.starts++;
+    if (repeated) statsCall.repeatedStarts++;
+    statsCall.bytesOut += 1 + bytesOut;
+    statsCall.bytesIn += bytesIn;
+    statsCallBits += 1 + 9 * (1 + bytesOut + bytesIn);
+    if (stop) {
+        statsCall.stops++;
+        statsCallBits += 1;
+    }
+}
+
+void I2Cdev::statsEnd() {
+    statsCall.transactions = 1;
+    statsCall.wallMicros = micros() - statsCallStart;
+    statsCall.wireMicros = (uint32)(((uint64)statsCallBits * 1000000UL + busSpeed - 1) / busSpeed);
+
+    I2CdevStats *entry = 0;
+    for (uint8 i = 0; i < statsEntryCount; i++) {
+        if (statsEntries[i].devAddr == statsCallDevAddr && statsEntries[i].regAddr == statsCallRegAddr) {
+            entry = &statsEntries[i].stats;
+            break;
+        }
+    }
+    if (entry == 0 && statsEntryCount < I2CDEV_STATS_ENTRIES) {
+        statsEntries[statsEntryCount].devAddr = statsCallDevAddr;
+        statsEntries[statsEntryCount].regAddr = statsCallRegAddr;
+        entry = &statsEntries[statsEntryCount++].stats;
+    }
+
+    I2CdevStats *targets[2] = { &stats, entry };
+    for (uint8 t = 0; t < 2 && targets[t] != 0; t++) {
+        targets[t]->transactions += statsCall.transactions;
+        targets[t]->starts += statsCall.starts;
+        targets[t]->repeatedStarts += statsCall.repeatedStarts;
+        targets[t]->stops += statsCall.stops;
+        targets[t]->bytesOut += statsCall.bytesOut;
+        targets[t]->bytesIn += statsCall.bytesIn;
+        targets[t]->wallMicros += statsCall.wallMicros;
+        targets[t]->wireMicros += statsCall.wireMicros;
+    }
+}
+
+I2CdevStats I2Cdev::stats;
+I2CdevStatsEntry I2Cdev::statsEntries[I2CDEV_STATS_ENTRIES];
+uint8 I2Cdev::statsEntryCount = 0;
+
+#endif // I2CDEV_ENABLE_STATS
+
+/** Modelled bus clock in Hz, see setBusSpeed().
+ */
+uint32 I2Cdev::busSpeed = I2CDEV_DEFAULT_BUS_SPEED;
+
 /** Default timeout value for read operations.
  * Set this to 0 to disable timeout detection.
  */
@@ -3,6 +3,11 @@
 // 2013-06-05 by Jeff Rowberg <jeff@rowberg.net>
 //
 // Changelog:
+//      2026-10-17 - add asynchronous job queue (submitRead/submitWrite/poll)
+//      2026-10-17 - add readBurst() for reads longer than 255 bytes (whole FIFO)
+//      2026-10-17 - read with a repeated-START combined transaction (I2CDEV_REPEATED_START)
+//      2026-10-17 - add optional bus traffic counters (I2CDEV_ENABLE_STATS) and bus speed model
+//      2026-10-17 - add I2CDEV_HOST_SIM implementation (simulated Wire backend for Linux hosts)
 //      2015-10-30 - simondlevy : support i2c_t3 for Teensy3.1
 //      2013-05-06 - add Francesco Ferrara's Fastwire v0.24 implementation with small modifications
 //      2013-05-05 - fix issue with writing bit values to words (Sasquatch/Farzanegan)
@@ -47,6 +52,12 @@ THE SOFTWARE.
 #ifndef _I2CDEV_H_
 #define _I2CDEV_H_
 	
+	// -----------------------------------------------------------------------------
+	// I2C interface implementation setting
+	// -----------------------------------------------------------------------------
+	#define I2CDEV_ARDUINO_WIRE         1 // libmaple/Arduino Wire object (OpenCM9.04 board)
+	#define I2CDEV_HOST_SIM             2 // simulated Wire object on a Linux host, see I2Cdev_host.h
+
 	#ifndef I2CDEV_IMPLEMENTATION
 	#define I2CDEV_IMPLEMENTATION       I2CDEV_ARDUINO_WIRE
 	//#define I2CDEV_IMPLEMENTATION       I2CDEV_BUILTIN_FASTWIRE
@@ -55,7 +66,11 @@ THE SOFTWARE.
 
     #define BUFFER_LENGTH 32
   
-    #include <Wire.h>
+    #if I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIM
+        #include "I2Cdev_host.h"
+    #else
+        #include <Wire.h>
+    #endif
 
 
 
@@ -63,6 +78,63 @@ THE SOFTWARE.
 // 1000ms default read timeout (modify with "I2Cdev::readTimeout = [ms];")
 #define I2CDEV_DEFAULT_READ_TIMEOUT     1000
 
+// define as 1 (or build with -DI2CDEV_REPEATED_START=1) to send the register
+// address and read the data in one combined transaction (repeated START, no
+// STOP in between). Needs a Wire library whose endTransmission() and
+// requestFrom() take a sendStop argument (AVR/SAM Wire, I2CDEV_HOST_SIM);
+// the default 0 uses only endTransmission() and the 2-argument requestFrom()
+// of the libmaple WireBase on the OpenCM9.04.
+#ifndef I2CDEV_REPEATED_START
+#define I2CDEV_REPEATED_START           0
+#endif
+
+// 100kHz default bus speed model (modify with "I2Cdev::setBusSpeed([Hz]);")
+#define I2CDEV_DEFAULT_BUS_SPEED        100000
+
+// uncomment (or build with -DI2CDEV_ENABLE_STATS) to count bus traffic per
+// device register, see I2Cdev::getStats()
+//#define I2CDEV_ENABLE_STATS
+
+// number of asynchronous jobs that can wait in the queue, see I2Cdev::submitRead()
+#define I2CDEV_QUEUE_LENGTH             8
+
+// completion callback for queued jobs: result is the number of bytes
+// transferred, or -1 on failure (NACK, short read or timeout)
+typedef void (*I2CdevCallback)(int16 result, void *context);
+
+struct I2CdevJob {
+    unsigned char devAddr;
+    unsigned char regAddr;
+    boolean write;
+    uint16 length;
+    unsigned char *data;
+    uint16 done;            // bytes transferred so far
+    I2CdevCallback callback;
+    void *context;
+};
+
+#ifdef I2CDEV_ENABLE_STATS
+    // number of distinct devAddr/regAddr pairs tracked individually
+    #define I2CDEV_STATS_ENTRIES        32
+
+    struct I2CdevStats {
+        uint32 transactions;    // I2Cdev read/write calls
+        uint32 starts;          // START conditions, including repeated STARTs
+        uint32 repeatedStarts;  // STARTs issued without a preceding STOP
+        uint32 stops;           // STOP conditions
+        uint32 bytesOut;        // bytes sent by the master, address bytes included
+        uint32 bytesIn;         // bytes received from the slave
+        uint32 wallMicros;      // measured time spent inside the calls
+        uint32 wireMicros;      // predicted on-wire time at the modelled bus speed
+    };
+
+    struct I2CdevStatsEntry {
+        uint8 devAddr;
+        uint8 regAddr;
+        I2CdevStats stats;
+    };
+#endif
+
 class I2Cdev {
     public:
     I2Cdev();
@@ -75,6 +147,7 @@ class I2Cdev {
     static     char readWord(unsigned char devAddr, unsigned char regAddr, unsigned short *data, unsigned short timeout=I2Cdev::readTimeout);
     static     char readBytes(unsigned char devAddr, unsigned char regAddr, unsigned char length, unsigned char *data, unsigned short timeout=I2Cdev::readTimeout);
     static     char readWords(unsigned char devAddr, unsigned char regAddr, unsigned char length, unsigned short *data, unsigned short timeout=I2Cdev::readTimeout);
+    static     int16 readBurst(unsigned char devAddr, unsigned char regAddr, uint16 length, unsigned char *data, unsigned short timeout=I2Cdev::readTimeout);
 
     static    boolean writeBit(unsigned char devAddr, unsigned char regAddr, unsigned char bitNum, unsigned char data);
     static    boolean writeBitW(unsigned char devAddr, unsigned char regAddr, unsigned char bitNum, unsigned short data);
@@ -85,7 +158,45 @@ class I2Cdev {
     static     boolean writeBytes(unsigned char devAddr, unsigned char regAddr, unsigned char length, unsigned char *data);
     static     boolean writeWords(unsigned char devAddr, unsigned char regAddr, unsigned char length, unsigned short *data);
 
+    static boolean submitRead(unsigned char devAddr, unsigned char regAddr, uint16 length, unsigned char *data, I2CdevCallback callback=0, void *context=0);
+    static boolean submitWrite(unsigned char devAddr, unsigned char regAddr, unsigned char length, unsigned char *data, I2CdevCallback callback=0, void *context=0);
+    static uint8 poll();
+    static uint8 getQueueCount();
+    static void flushQueue();
+
+    static void setBusSpeed(uint32 hz);
+    static uint32 getBusSpeed();
+
+    #ifdef I2CDEV_ENABLE_STATS
+    static const I2CdevStats *getStats();
+    static const I2CdevStats *getStats(unsigned char devAddr, unsigned char regAddr);
+    static uint8 getStatsEntryCount();
+    static const I2CdevStatsEntry *getStatsEntry(uint8 index);
+    static void resetStats();
+    #endif
+
     static uint16 readTimeout;
+
+    private:
+    static uint32 busSpeed;
+
+    static I2CdevJob queue[I2CDEV_QUEUE_LENGTH];
+    static volatile uint8 queueHead;
+    static volatile uint8 queueTail;
+    static volatile boolean polling;
+
+    static boolean submit(unsigned char devAddr, unsigned char regAddr, boolean write, uint16 length, unsigned char *data, I2CdevCallback callback, void *context);
+    static boolean step(I2CdevJob *job);
+
+    #ifdef I2CDEV_ENABLE_STATS
+    static I2CdevStats stats;
+    static I2CdevStatsEntry statsEntries[I2CDEV_STATS_ENTRIES];
+    static uint8 statsEntryCount;
+
+    static void statsBegin(unsigned char devAddr, unsigned char regAddr);
+    static void statsTransfer(boolean repeated, unsigned char bytesOut, unsigned char bytesIn, boolean stop);
+    static void statsEnd();
+    #endif
 };
 
 
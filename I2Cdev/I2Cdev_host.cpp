@@ -0,0 +1,384 @@
+// I2Cdev library collection - host (Linux) simulation backend
+// See I2Cdev_host.h for usage.
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2013 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#include "I2Cdev.h"
+
+#if I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIM
+
+// virtual time is stepped in slices no longer than this so that devices can
+// raise interrupt edges close to when they would happen on hardware
+#define I2CDEV_SIM_STEP_NS      50000ULL
+
+TwoWire Wire;
+
+uint64 I2CdevSim::now = 0;
+boolean I2CdevSim::advancing = false;
+uint8 I2CdevSim::pinLevel[I2CDEV_SIM_MAX_PINS];
+void (*I2CdevSim::pinHandler[I2CDEV_SIM_MAX_PINS])(void);
+int I2CdevSim::pinMode[I2CDEV_SIM_MAX_PINS];
+
+// ============================================================================
+// Arduino core stand-ins
+// ============================================================================
+
+uint32 millis() {
+    return (uint32)(I2CdevSim::nanos() / 1000000ULL);
+}
+
+uint32 micros() {
+    return (uint32)(I2CdevSim::nanos() / 1000ULL);
+}
+
+void delay(uint32 ms) {
+    I2CdevSim::advance((uint64)ms * 1000000ULL);
+}
+
+void delayMicroseconds(uint32 us) {
+    I2CdevSim::advance((uint64)us * 1000ULL);
+}
+
+void pinMode(uint8 pin, uint8 mode) {
+}
+
+uint8 digitalRead(uint8 pin) {
+    return I2CdevSim::getPin(pin);
+}
+
+void digitalWrite(uint8 pin, uint8 value) {
+    I2CdevSim::setPin(pin, value);
+}
+
+void attachInterrupt(uint8 pin, void (*handler)(void), int mode) {
+    if (pin >= I2CDEV_SIM_MAX_PINS) return;
+    I2CdevSim::pinHandler[pin] = handler;
+    I2CdevSim::pinMode[pin] = mode;
+}
+
+void detachInterrupt(uint8 pin) {
+    if (pin >= I2CDEV_SIM_MAX_PINS) return;
+    I2CdevSim::pinHandler[pin] = 0;
+}
+
+void noInterrupts() {
+}
+
+void interrupts() {
+}
+
+// ============================================================================
+// I2CdevSim (virtual clock and pins)
+// ============================================================================
+
+/** Get current virtual time.
+ * @return Nanoseconds since the last I2CdevSim::reset()
+ */
+uint64 I2CdevSim::nanos() {
+    return now;
+}
+
+/** Move virtual time forward and let every attached device catch up.
+ * Calls made from inside an interrupt handler (e.g. a delay() in an ISR) only
+ * move the clock; they do not recurse into the devices.
+ * @param ns Nanoseconds to advance
+ */
+void I2CdevSim::advance(uint64 ns) {
+    if (advancing) {
+        now += ns;
+        return;
+    }
+    advancing = true;
+    uint64 target = now + ns;
+    while (now < target) {
+        uint64 step = target - now;
+        if (step > I2CDEV_SIM_STEP_NS) step = I2CDEV_SIM_STEP_NS;
+        now += step;
+        Wire.advance(now);
+    }
+    Wire.advance(now);
+    advancing = false;
+}
+
+/** Rewind virtual time to zero and release all pins and interrupt handlers.
+ * Attached devices are left in place; reset them separately if needed.
+ */
+void I2CdevSim::reset() {
+    now = 0;
+    advancing = false;
+    memset(pinLevel, 0, sizeof(pinLevel));
+    memset(pinHandler, 0, sizeof(pinHandler));
+    memset(pinMode, 0, sizeof(pinMode));
+}
+
+/** Drive a pin from a simulated device.
+ * Fires the handler registered with attachInterrupt() on a matching edge.
+ * @param pin Pin number
+ * @param level New level (LOW or HIGH)
+ */
+void I2CdevSim::setPin(uint8 pin, uint8 level) {
+    if (pin >= I2CDEV_SIM_MAX_PINS) return;
+    uint8 old = pinLevel[pin];
+    pinLevel[pin] = level ? HIGH : LOW;
+    if (old == pinLevel[pin] || pinHandler[pin] == 0) return;
+    if (pinMode[pin] == CHANGE
+            || (pinMode[pin] == RISING && pinLevel[pin] == HIGH)
+            || (pinMode[pin] == FALLING && pinLevel[pin] == LOW)) {
+        boolean wasAdvancing = advancing;
+        advancing = true;
+        pinHandler[pin]();
+        advancing = wasAdvancing;
+    }
+}
+
+/** Read a pin level.
+ * @param pin Pin number
+ * @return Current level
+ */
+uint8 I2CdevSim::getPin(uint8 pin) {
+    if (pin >= I2CDEV_SIM_MAX_PINS) return LOW;
+    return pinLevel[pin];
+}
+
+// ============================================================================
+// I2CdevSimDevice
+// ============================================================================
+
+I2CdevSimDevice::I2CdevSimDevice() {
+    nextDevice = 0;
+}
+
+I2CdevSimDevice::~I2CdevSimDevice() {
+}
+
+void I2CdevSimDevice::start(uint8 address, boolean read) {
+}
+
+void I2CdevSimDevice::stop(uint8 address) {
+}
+
+void I2CdevSimDevice::advance(uint64 nanos) {
+}
+
+// ============================================================================
+// TwoWire
+// ============================================================================
+
+TwoWire::TwoWire() {
+    devices = 0;
+    held = 0;
+    heldAddress = 0;
+    clock = 100000;
+    deferred = false;
+    deferredNanos = 0;
+    txAddress = 0;
+    txLength = 0;
+    rxLength = 0;
+    rxIndex = 0;
+}
+
+void TwoWire::begin() {
+}
+
+void TwoWire::begin(uint8 sda, uint8 scl) {
+}
+
+/** Set the bus clock used to charge virtual time for each transaction.
+ * @param frequency SCL frequency in Hz (e.g. 100000, 400000, 1000000)
+ */
+void TwoWire::setClock(uint32 frequency) {
+    if (frequency > 0) clock = frequency;
+}
+
+uint32 TwoWire::getClock() {
+    return clock;
+}
+
+void TwoWire::beginTransmission(uint8 address) {
+    txAddress = address;
+    txLength = 0;
+}
+
+uint8 TwoWire::write(uint8 data) {
+    if (txLength >= BUFFER_LENGTH) return 0;
+    txBuffer[txLength++] = data;
+    return 1;
+}
+
+uint8 TwoWire::write(const uint8 *data, uint8 quantity) {
+    uint8 n = 0;
+    while (n < quantity && write(data[n])) n++;
+    return n;
+}
+
+/** Perform the queued write transaction.
+ * @param sendStop Whether to release the bus (false leaves it held for a
+ *        repeated START by the next endTransmission()/requestFrom())
+ * @return 0 on success, 2 on address NACK, 3 on data NACK
+ */
+uint8 TwoWire::endTransmission(boolean sendStop) {
+    uint32 bits = 0;
+    I2CdevSimDevice *device = open(txAddress, false, &bits);
+    uint8 status = 0;
+    if (device == 0) {
+        status = 2;
+    } else {
+        for (uint8 k = 0; k < txLength; k++) {
+            bits += 9;
+            if (!device->write(txAddress, txBuffer[k])) {
+                status = 3;
+                break;
+            }
+        }
+    }
+    close(device, txAddress, sendStop || status != 0, &bits);
+    charge(bits);
+    txLength = 0;
+    return status;
+}
+
+/** Perform a read transaction.
+ * @param address 7-bit device address
+ * @param quantity Number of bytes to read (at most BUFFER_LENGTH)
+ * @param sendStop Whether to release the bus afterwards
+ * @return Number of bytes received (0 on address NACK)
+ */
+uint8 TwoWire::requestFrom(uint8 address, uint8 quantity, boolean sendStop) {
+    uint32 bits = 0;
+    rxIndex = 0;
+    rxLength = 0;
+    if (quantity > BUFFER_LENGTH) quantity = BUFFER_LENGTH;
+    I2CdevSimDevice *device = open(address, true, &bits);
+    if (device != 0) {
+        for (; rxLength < quantity; rxLength++) {
+            bits += 9;
+            rxBuffer[rxLength] = device->read(address);
+        }
+    }
+    close(device, address, sendStop || device == 0, &bits);
+    charge(bits);
+    return rxLength;
+}
+
+int TwoWire::available() {
+    return rxLength - rxIndex;
+}
+
+int TwoWire::read() {
+    if (rxIndex >= rxLength) return -1;
+    return rxBuffer[rxIndex++];
+}
+
+/** Put a simulated device on the bus.
+ * @param device Device to attach (not owned)
+ */
+void TwoWire::attach(I2CdevSimDevice *device) {
+    device->nextDevice = devices;
+    devices = device;
+    device->advance(I2CdevSim::nanos());
+}
+
+/** Remove a simulated device from the bus.
+ * @param device Device to detach
+ */
+void TwoWire::detach(I2CdevSimDevice *device) {
+    for (I2CdevSimDevice **p = &devices; *p != 0; p = &(*p)->nextDevice) {
+        if (*p == device) {
+            *p = device->nextDevice;
+            device->nextDevice = 0;
+            break;
+        }
+    }
+    if (held == device) held = 0;
+}
+
+/** Bring every attached device up to the given time.
+ * @param nanos Current virtual time
+ */
+void TwoWire::advance(uint64 nanos) {
+    for (I2CdevSimDevice *d = devices; d != 0; d = d->nextDevice) d->advance(nanos);
+}
+
+I2CdevSimDevice *TwoWire::find(uint8 address) {
+    for (I2CdevSimDevice *d = devices; d != 0; d = d->nextDevice) {
+        if (d->acknowledges(address)) return d;
+    }
+    return 0;
+}
+
+// (repeated) START + address byte; a repeated START to a different device
+// implicitly ends the held transfer
+I2CdevSimDevice *TwoWire::open(uint8 address, boolean read, uint32 *bits) {
+    advance(I2CdevSim::nanos());
+    if (held != 0 && heldAddress != address) {
+        held->stop(heldAddress);
+        held = 0;
+    }
+    *bits += 1 + 9;
+    I2CdevSimDevice *device = find(address);
+    if (device != 0) device->start(address, read);
+    return device;
+}
+
+void TwoWire::close(I2CdevSimDevice *device, uint8 address, boolean sendStop, uint32 *bits) {
+    if (sendStop) {
+        *bits += 1;
+        if (device != 0) device->stop(address);
+        if (held != 0 && held != device) held->stop(heldAddress);
+        held = 0;
+    } else {
+        held = device;
+        heldAddress = address;
+    }
+}
+
+/** Stop charging on-wire time to the virtual clock and accumulate it instead.
+ * Used to model transfers that run in the background (I2Cdev::poll()).
+ * @param deferred True to accumulate, false to charge the clock again
+ */
+void TwoWire::setDeferred(boolean deferred) {
+    this->deferred = deferred;
+}
+
+/** Get and clear the on-wire time accumulated while deferred.
+ * @return Nanoseconds of bus activity
+ */
+uint64 TwoWire::takeDeferredNanos() {
+    uint64 ns = deferredNanos;
+    deferredNanos = 0;
+    return ns;
+}
+
+// charge on-wire time for the given number of SCL periods
+void TwoWire::charge(uint32 bits) {
+    uint64 ns = ((uint64)bits * 1000000000ULL + clock - 1) / clock;
+    if (deferred) {
+        deferredNanos += ns;
+    } else {
+        I2CdevSim::advance(ns);
+    }
+}
+
+#endif // I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIM
@@ -0,0 +1,194 @@
+// I2Cdev library collection - host (Linux) simulation backend header file
+// Provides the small slice of the Arduino/OpenCM core that I2Cdev and the
+// device classes depend on (integer types, millis/micros/delay, pin
+// interrupts) plus a TwoWire-compatible "Wire" object which routes bus
+// transactions to simulated I2C devices instead of real hardware.
+//
+// Select it with -DI2CDEV_IMPLEMENTATION=I2CDEV_HOST_SIM, e.g.:
+//
+//     g++ -DI2CDEV_IMPLEMENTATION=I2CDEV_HOST_SIM -II2Cdev -IMPU9250_master
+//         I2Cdev/*.cpp MPU9250_master/*.cpp host/sim_harness.cpp
+//
+// host/sim_harness.cpp is a complete example (DMP load and init timings).
+//
+// Time is virtual and fully deterministic: it only moves forward through
+// delay()/delayMicroseconds(), I2CdevSim::advance() and the on-wire duration
+// of each bus transaction at the current Wire.setClock() speed.
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2013 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#ifndef _I2CDEV_HOST_H_
+#define _I2CDEV_HOST_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// libmaple/wirish integer types used throughout the OpenCM sources
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef uint64_t uint64;
+typedef int8_t   int8;
+typedef int16_t  int16;
+typedef int32_t  int32;
+typedef int64_t  int64;
+typedef bool     boolean;
+typedef uint8_t  byte;
+
+#ifndef min
+#define min(a,b) ((a)<(b)?(a):(b))
+#endif
+#ifndef max
+#define max(a,b) ((a)>(b)?(a):(b))
+#endif
+#ifndef constrain
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#endif
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+#define HIGH    0x1
+#define LOW     0x0
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define I2CDEV_SIM_MAX_PINS     64
+
+uint32 millis();
+uint32 micros();
+void delay(uint32 ms);
+void delayMicroseconds(uint32 us);
+
+void pinMode(uint8 pin, uint8 mode);
+uint8 digitalRead(uint8 pin);
+void digitalWrite(uint8 pin, uint8 value);
+void attachInterrupt(uint8 pin, void (*handler)(void), int mode);
+void detachInterrupt(uint8 pin);
+void noInterrupts();
+void interrupts();
+
+/** Simulated I2C slave.
+ * A device sees the bus at byte level: a START (or repeated START) addressed
+ * to it, a number of written or read bytes, then a STOP. advance() is called
+ * with the current virtual time before every transaction and whenever the
+ * clock moves, so a device can update its internal state (sample timers,
+ * FIFOs, interrupt lines) lazily.
+ */
+class I2CdevSimDevice {
+    public:
+        I2CdevSimDevice();
+        virtual ~I2CdevSimDevice();
+
+        virtual boolean acknowledges(uint8 address) = 0;
+        virtual void start(uint8 address, boolean read);
+        virtual boolean write(uint8 address, uint8 data) = 0;
+        virtual uint8 read(uint8 address) = 0;
+        virtual void stop(uint8 address);
+        virtual void advance(uint64 nanos);
+
+        I2CdevSimDevice *nextDevice;
+};
+
+/** Virtual clock and pin state shared by all simulated devices.
+ */
+class I2CdevSim {
+    public:
+        static uint64 nanos();
+        static void advance(uint64 ns);
+        static void reset();
+
+        static void setPin(uint8 pin, uint8 level);
+        static uint8 getPin(uint8 pin);
+
+    private:
+        static uint64 now;
+        static boolean advancing;
+        static uint8 pinLevel[I2CDEV_SIM_MAX_PINS];
+        static void (*pinHandler[I2CDEV_SIM_MAX_PINS])(void);
+        static int pinMode[I2CDEV_SIM_MAX_PINS];
+
+        friend void attachInterrupt(uint8 pin, void (*handler)(void), int mode);
+        friend void detachInterrupt(uint8 pin);
+};
+
+/** TwoWire work-alike backed by simulated devices.
+ * Buffering and return codes follow the Arduino Wire library: write() queues
+ * up to BUFFER_LENGTH bytes, endTransmission() performs the write and returns
+ * 0 (success), 2 (address NACK) or 3 (data NACK), and requestFrom() performs
+ * the read and returns the number of bytes received.
+ */
+class TwoWire {
+    public:
+        TwoWire();
+
+        void begin();
+        void begin(uint8 sda, uint8 scl);
+        void setClock(uint32 frequency);
+        uint32 getClock();
+
+        void beginTransmission(uint8 address);
+        uint8 endTransmission(boolean sendStop=true);
+        uint8 requestFrom(uint8 address, uint8 quantity, boolean sendStop=true);
+        uint8 write(uint8 data);
+        uint8 write(const uint8 *data, uint8 quantity);
+        int available();
+        int read();
+
+        void attach(I2CdevSimDevice *device);
+        void detach(I2CdevSimDevice *device);
+        void advance(uint64 nanos);
+
+        void setDeferred(boolean deferred);
+        uint64 takeDeferredNanos();
+
+    private:
+        I2CdevSimDevice *devices;
+        I2CdevSimDevice *held;      // device addressed by a transfer that ended without STOP
+        uint8 heldAddress;
+        uint32 clock;
+        boolean deferred;           // accumulate on-wire time instead of advancing the clock
+        uint64 deferredNanos;
+
+        uint8 txAddress;
+        uint8 txBuffer[BUFFER_LENGTH];
+        uint8 txLength;
+        uint8 rxBuffer[BUFFER_LENGTH];
+        uint8 rxLength;
+        uint8 rxIndex;
+
+        I2CdevSimDevice *find(uint8 address);
+        I2CdevSimDevice *open(uint8 address, boolean read, uint32 *bits);
+        void close(I2CdevSimDevice *device, uint8 address, boolean sendStop, uint32 *bits);
+        void charge(uint32 bits);
+};
+
+extern TwoWire Wire;
+
+#endif /* _I2CDEV_HOST_H_ */
@@ -41,6 +41,21 @@ THE SOFTWARE.
  */
 MPU9250::MPU9250() {
     devAddr = MPU9250_DEFAULT_ADDRESS;
+    configuring = false;
+    magAutoFetch = false;
+    magStatus = 0;
+    invalidateShadow();
+#ifdef MPU9250_INCLUDE_DMP_MOTIONAPPS41
+    dmpInitTable = 0;   // as dmpInitBegin(), without millis() in a global constructor
+    dmpInitLength = 0;
+    dmpInitIndex = 0;
+    dmpInitStatus = MPU9250_DMP_INIT_BUSY;
+    dmpInitWaiting = false;
+    dmpInitUpdate = 0;
+    dmpInitOffset = 0;
+    dmpInitStepStart = 0;
+    dmpInitFIFOCount = 0;
+#endif
 }
 
 /** Specific address constructor.
@@ -51,6 +66,216 @@ MPU9250::MPU9250() {
  */
 MPU9250::MPU9250(uint8 address) {
     devAddr = address;
+    configuring = false;
+    magAutoFetch = false;
+    magStatus = 0;
+    invalidateShadow();
+#ifdef MPU9250_INCLUDE_DMP_MOTIONAPPS41
+    dmpInitTable = 0;   // as dmpInitBegin(), without millis() in a global constructor
+    dmpInitLength = 0;
+    dmpInitIndex = 0;
+    dmpInitStatus = MPU9250_DMP_INIT_BUSY;
+    dmpInitWaiting = false;
+    dmpInitUpdate = 0;
+    dmpInitOffset = 0;
+    dmpInitStepStart = 0;
+    dmpInitFIFOCount = 0;
+#endif
+}
+
+// register shadow
+
+/** Shadowed configuration registers in ascending order, with the bits of each
+ * that read back exactly what was last written. Self-clearing trigger bits are
+ * left out: they must never be written back. Slot i of the table is slot i of
+ * MPU9250::shadow[], so a run of consecutive registers is also a run of slots.
+ */
+static const uint8 shadowTable[MPU9250_SHADOW_SIZE][2] = {
+    { MPU9250_RA_XG_OFFS_TC,         0xFF },
+    { MPU9250_RA_YG_OFFS_TC,         0xFF },
+    { MPU9250_RA_ZG_OFFS_TC,         0xFF },
+    { MPU9250_RA_SMPLRT_DIV,         0xFF },
+    { MPU9250_RA_CONFIG,             0xFF },
+    { MPU9250_RA_GYRO_CONFIG,        0xFF },
+    { MPU9250_RA_ACCEL_CONFIG,       0xFF },
+    { MPU9250_RA_FIFO_EN,            0xFF },
+    { MPU9250_RA_I2C_MST_CTRL,       0xFF },
+    { MPU9250_RA_I2C_SLV0_CTRL,      0xFF },
+    { MPU9250_RA_I2C_SLV1_CTRL,      0xFF },
+    { MPU9250_RA_I2C_SLV2_CTRL,      0xFF },
+    { MPU9250_RA_I2C_SLV3_CTRL,      0xFF },
+    { MPU9250_RA_I2C_SLV4_CTRL,      0x7F },    // I2C_SLV4_EN clears when the transfer completes
+    { MPU9250_RA_INT_PIN_CFG,        0xFF },
+    { MPU9250_RA_INT_ENABLE,         0xFF },
+    { MPU9250_RA_I2C_MST_DELAY_CTRL, 0xFF },
+    { MPU9250_RA_MOT_DETECT_CTRL,    0xFF },
+    { MPU9250_RA_USER_CTRL,          0xF0 },    // DMP/FIFO/I2C_MST/SIG_COND reset bits clear themselves
+    { MPU9250_RA_PWR_MGMT_1,         0x7F },    // DEVICE_RESET clears itself
+    { MPU9250_RA_PWR_MGMT_2,         0xFF },
+};
+
+/** Find the shadow slot of a register.
+ * @param regAddr Register address
+ * @return Index into shadowTable[], or MPU9250_SHADOW_SIZE if the register is not shadowed
+ */
+static uint8 shadowIndex(uint8 regAddr) {
+    uint8 i = 0;
+    while (i < MPU9250_SHADOW_SIZE && shadowTable[i][0] != regAddr) i++;
+    return i;
+}
+
+/** Get the bits of a register that can be served from the shadow.
+ * @param regAddr Register address
+ * @return Mask of persistent bits, or 0 if the register is not shadowed
+ */
+static uint8 shadowMask(uint8 regAddr) {
+    uint8 i = shadowIndex(regAddr);
+    return i < MPU9250_SHADOW_SIZE ? shadowTable[i][1] : 0;
+}
+
+/** Forget all shadowed register values.
+ * The next read-modify-write of each configuration register fetches it from
+ * the device again. Called by reset(); call it yourself after writing MPU9250
+ * registers directly through I2Cdev.
+ * @see reset()
+ */
+void MPU9250::invalidateShadow() {
+    shadowValid = 0;
+    shadowDirty = 0;
+}
+
+/** Get the current value of a register, from the shadow when it is valid.
+ * @param regAddr Register address
+ * @param data Container for the value
+ * @return Status of operation (true = success)
+ */
+boolean MPU9250::readShadow(uint8 regAddr, uint8 *data) {
+    uint8 i = shadowIndex(regAddr);
+    if (i < MPU9250_SHADOW_SIZE && (shadowValid & (1UL << i))) {
+        *data = shadow[i];
+        return true;
+    }
+    return I2Cdev::readByte(devAddr, regAddr, data) == 1;
+}
+
+/** Write a register and keep its shadow in step.
+ * @param regAddr Register address
+ * @param data New value
+ * @return Status of operation (true = success)
+ */
+boolean MPU9250::writeRegByte(uint8 regAddr, uint8 data) {
+    uint8 i = shadowIndex(regAddr);
+    uint8 mask = i < MPU9250_SHADOW_SIZE ? shadowTable[i][1] : 0;
+    boolean deviceReset = regAddr == MPU9250_RA_PWR_MGMT_1 && (data & (1 << MPU9250_PWR1_DEVICE_RESET_BIT));
+    if (configuring && mask != 0 && !deviceReset) {
+        // held back for commitConfig(); trigger bits are kept until then
+        shadow[i] = data;
+        shadowValid |= 1UL << i;
+        shadowDirty |= 1UL << i;
+        return true;
+    }
+    boolean ok = I2Cdev::writeByte(devAddr, regAddr, data);
+    if (mask == 0) return ok;
+    if (deviceReset) {
+        // every register returns to its power-on value
+        invalidateShadow();
+    } else if (ok) {
+        shadow[i] = data & mask;
+        shadowValid |= 1UL << i;
+    } else {
+        // the device may or may not have taken the value
+        shadowValid &= ~(1UL << i);
+    }
+    return ok;
+}
+
+/** Start collecting configuration register writes.
+ * Until commitConfig(), setters for shadowed configuration registers only
+ * update the shadow; other registers are still written immediately. Each
+ * register is written once with its last value, in ascending register
+ * order, so do not batch sequences whose order matters (device, FIFO or DMP
+ * resets followed by enables).
+ * @see commitConfig()
+ */
+void MPU9250::beginConfig() {
+    configuring = true;
+}
+
+/** Write all configuration changes collected since beginConfig().
+ * Changed registers are sent as the fewest possible burst writes. A burst
+ * starts at the lowest changed register and runs on to the next changed one
+ * across any number of unchanged registers, as long as every register in
+ * between is shadowed with a known value and a full 0xFF mask (it is then
+ * rewritten with that same value), and the burst stays within
+ * BUFFER_LENGTH - 1 registers. Registers that are never rewritten as filler
+ * end the burst: unshadowed ones (sensor data, status, FIFO_R_W, DMP
+ * memory/bank, I2C slave address/register/data) and those with
+ * self-clearing bits (PWR_MGMT_1, USER_CTRL, I2C_SLV4_CTRL).
+ * @return Status of operation (true = success)
+ * @see beginConfig()
+ */
+boolean MPU9250::commitConfig() {
+    boolean ok = true;
+    configuring = false;
+    for (uint8 i = 0; i < MPU9250_SHADOW_SIZE; i++) {
+        if (!(shadowDirty & (1UL << i))) continue;
+        uint8 last = i;
+        for (uint8 j = i + 1; j < MPU9250_SHADOW_SIZE && j - i < BUFFER_LENGTH - 1; j++) {
+            if (shadowTable[j][0] != shadowTable[j - 1][0] + 1) break;  // unshadowed registers in between
+            if (shadowDirty & (1UL << j)) {
+                last = j;
+            } else if (!(shadowValid & (1UL << j)) || shadowTable[j][1] != 0xFF) {
+                break;
+            }
+        }
+        boolean written = I2Cdev::writeBytes(devAddr, shadowTable[i][0], last - i + 1, shadow + i);
+        for (uint8 j = i; j <= last; j++) {
+            shadowDirty &= ~(1UL << j);
+            if (written) {
+                shadow[j] &= shadowTable[j][1];
+            } else {
+                shadowValid &= ~(1UL << j);
+            }
+        }
+        ok = ok && written;
+        i = last;
+    }
+    return ok;
+}
+
+/** Write a single bit of a register, reading it only if it is not shadowed.
+ * @param regAddr Register address
+ * @param bitNum Bit position to write (0-7)
+ * @param data New bit value
+ * @return Status of operation (true = success)
+ * @see I2Cdev::writeBit()
+ */
+boolean MPU9250::writeRegBit(uint8 regAddr, uint8 bitNum, uint8 data) {
+    if (shadowMask(regAddr) == 0) return I2Cdev::writeBit(devAddr, regAddr, bitNum, data);
+    uint8 b;
+    if (!readShadow(regAddr, &b)) return false;
+    b = (data != 0) ? (b | (1 << bitNum)) : (b & ~(1 << bitNum));
+    return writeRegByte(regAddr, b);
+}
+
+/** Write a bit field of a register, reading it only if it is not shadowed.
+ * @param regAddr Register address
+ * @param bitStart First bit position to write (0-7)
+ * @param length Number of bits to write (not more than 8)
+ * @param data Right-aligned value to write
+ * @return Status of operation (true = success)
+ * @see I2Cdev::writeBits()
+ */
+boolean MPU9250::writeRegBits(uint8 regAddr, uint8 bitStart, uint8 length, uint8 data) {
+    if (shadowMask(regAddr) == 0) return I2Cdev::writeBits(devAddr, regAddr, bitStart, length, data);
+    uint8 b;
+    if (!readShadow(regAddr, &b)) return false;
+    uint8 mask = ((1 << length) - 1) << (bitStart - length + 1);
+    data <<= (bitStart - length + 1); // shift data into correct position
+    data &= mask; // zero all non-important bits in data
+    b &= ~(mask); // zero all important bits in existing byte
+    b |= data; // combine data with existing byte
+    return writeRegByte(regAddr, b);
 }
 
 /** Power on and prepare for general usage.
@@ -61,10 +286,12 @@ MPU9250::MPU9250(uint8 address) {
  * the default internal clock source.
  */
 void MPU9250::initialize() {
+    beginConfig();
     setClockSource(MPU9250_CLOCK_PLL_XGYRO);
     setFullScaleGyroRange(MPU9250_GYRO_FS_250);
     setFullScaleAccelRange(MPU9250_ACCEL_FS_2);
     setSleepEnabled(false); // thanks to Jack Elston for pointing this one out!
+    commitConfig();
 }
 
 /** Verify the I2C connection.
@@ -94,7 +321,7 @@ uint8 MPU9250::getAuxVDDIOLevel() {
  * @param level I2C supply voltage level (0=VLOGIC, 1=VDD)
  */
 void MPU9250::setAuxVDDIOLevel(uint8 level) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_YG_OFFS_TC, MPU9250_TC_PWR_MODE_BIT, level);
+    writeRegBit(MPU9250_RA_YG_OFFS_TC, MPU9250_TC_PWR_MODE_BIT, level);
 }
 
 // SMPLRT_DIV register
@@ -130,7 +357,7 @@ uint8 MPU9250::getRate() {
  * @see MPU9250_RA_SMPLRT_DIV
  */
 void MPU9250::setRate(uint8 rate) {
-    I2Cdev::writeByte(devAddr, MPU9250_RA_SMPLRT_DIV, rate);
+    writeRegByte(MPU9250_RA_SMPLRT_DIV, rate);
 }
 
 // CONFIG register
@@ -172,7 +399,7 @@ uint8 MPU9250::getExternalFrameSync() {
  * @param sync New FSYNC configuration value
  */
 void MPU9250::setExternalFrameSync(uint8 sync) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_CONFIG, MPU9250_CFG_EXT_SYNC_SET_BIT, MPU9250_CFG_EXT_SYNC_SET_LENGTH, sync);
+    writeRegBits(MPU9250_RA_CONFIG, MPU9250_CFG_EXT_SYNC_SET_BIT, MPU9250_CFG_EXT_SYNC_SET_LENGTH, sync);
 }
 /** Get digital low-pass filter configuration.
  * The DLPF_CFG parameter sets the digital low pass filter configuration. It
@@ -215,7 +442,7 @@ uint8 MPU9250::getDLPFMode() {
  * @see MPU9250_CFG_DLPF_CFG_LENGTH
  */
 void MPU9250::setDLPFMode(uint8 mode) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_CONFIG, MPU9250_CFG_DLPF_CFG_BIT, MPU9250_CFG_DLPF_CFG_LENGTH, mode);
+    writeRegBits(MPU9250_RA_CONFIG, MPU9250_CFG_DLPF_CFG_BIT, MPU9250_CFG_DLPF_CFG_LENGTH, mode);
 }
 
 // GYRO_CONFIG register
@@ -250,7 +477,7 @@ uint8 MPU9250::getFullScaleGyroRange() {
  * @see MPU9250_GCONFIG_FS_SEL_LENGTH
  */
 void MPU9250::setFullScaleGyroRange(uint8 range) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_GYRO_CONFIG, MPU9250_GCONFIG_FS_SEL_BIT, MPU9250_GCONFIG_FS_SEL_LENGTH, range);
+    writeRegBits(MPU9250_RA_GYRO_CONFIG, MPU9250_GCONFIG_FS_SEL_BIT, MPU9250_GCONFIG_FS_SEL_LENGTH, range);
 }
 
 // ACCEL_CONFIG register
@@ -268,7 +495,7 @@ boolean MPU9250::getAccelXSelfTest() {
  * @see MPU9250_RA_ACCEL_CONFIG
  */
 void MPU9250::setAccelXSelfTest(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_ACCEL_CONFIG, MPU9250_ACONFIG_XA_ST_BIT, enabled);
+    writeRegBit(MPU9250_RA_ACCEL_CONFIG, MPU9250_ACONFIG_XA_ST_BIT, enabled);
 }
 /** Get self-test enabled value for accelerometer Y axis.
  * @return Self-test enabled value
@@ -283,7 +510,7 @@ boolean MPU9250::getAccelYSelfTest() {
  * @see MPU9250_RA_ACCEL_CONFIG
  */
 void MPU9250::setAccelYSelfTest(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_ACCEL_CONFIG, MPU9250_ACONFIG_YA_ST_BIT, enabled);
+    writeRegBit(MPU9250_RA_ACCEL_CONFIG, MPU9250_ACONFIG_YA_ST_BIT, enabled);
 }
 /** Get self-test enabled value for accelerometer Z axis.
  * @return Self-test enabled value
@@ -298,7 +525,7 @@ boolean MPU9250::getAccelZSelfTest() {
  * @see MPU9250_RA_ACCEL_CONFIG
  */
 void MPU9250::setAccelZSelfTest(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_ACCEL_CONFIG, MPU9250_ACONFIG_ZA_ST_BIT, enabled);
+    writeRegBit(MPU9250_RA_ACCEL_CONFIG, MPU9250_ACONFIG_ZA_ST_BIT, enabled);
 }
 /** Get full-scale accelerometer range.
  * The FS_SEL parameter allows setting the full-scale range of the accelerometer
@@ -326,7 +553,7 @@ uint8 MPU9250::getFullScaleAccelRange() {
  * @see getFullScaleAccelRange()
  */
 void MPU9250::setFullScaleAccelRange(uint8 range) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_ACCEL_CONFIG, MPU9250_ACONFIG_AFS_SEL_BIT, MPU9250_ACONFIG_AFS_SEL_LENGTH, range);
+    writeRegBits(MPU9250_RA_ACCEL_CONFIG, MPU9250_ACONFIG_AFS_SEL_BIT, MPU9250_ACONFIG_AFS_SEL_LENGTH, range);
 }
 /** Get the high-pass filter configuration.
  * The DHPF is a filter module in the path leading to motion detectors (Free
@@ -374,7 +601,7 @@ uint8 MPU9250::getDHPFMode() {
  * @see MPU9250_RA_ACCEL_CONFIG
  */
 void MPU9250::setDHPFMode(uint8 bandwidth) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_ACCEL_CONFIG, MPU9250_ACONFIG_ACCEL_HPF_BIT, MPU9250_ACONFIG_ACCEL_HPF_LENGTH, bandwidth);
+    writeRegBits(MPU9250_RA_ACCEL_CONFIG, MPU9250_ACONFIG_ACCEL_HPF_BIT, MPU9250_ACONFIG_ACCEL_HPF_LENGTH, bandwidth);
 }
 
 // FF_THR register
@@ -592,7 +819,7 @@ boolean MPU9250::getTempFIFOEnabled() {
  * @see MPU9250_RA_FIFO_EN
  */
 void MPU9250::setTempFIFOEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_FIFO_EN, MPU9250_TEMP_FIFO_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_FIFO_EN, MPU9250_TEMP_FIFO_EN_BIT, enabled);
 }
 /** Get gyroscope X-axis FIFO enabled value.
  * When set to 1, this bit enables GYRO_XOUT_H and GYRO_XOUT_L (Registers 67 and
@@ -610,7 +837,7 @@ boolean MPU9250::getXGyroFIFOEnabled() {
  * @see MPU9250_RA_FIFO_EN
  */
 void MPU9250::setXGyroFIFOEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_FIFO_EN, MPU9250_XG_FIFO_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_FIFO_EN, MPU9250_XG_FIFO_EN_BIT, enabled);
 }
 /** Get gyroscope Y-axis FIFO enabled value.
  * When set to 1, this bit enables GYRO_YOUT_H and GYRO_YOUT_L (Registers 69 and
@@ -628,7 +855,7 @@ boolean MPU9250::getYGyroFIFOEnabled() {
  * @see MPU9250_RA_FIFO_EN
  */
 void MPU9250::setYGyroFIFOEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_FIFO_EN, MPU9250_YG_FIFO_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_FIFO_EN, MPU9250_YG_FIFO_EN_BIT, enabled);
 }
 /** Get gyroscope Z-axis FIFO enabled value.
  * When set to 1, this bit enables GYRO_ZOUT_H and GYRO_ZOUT_L (Registers 71 and
@@ -646,7 +873,7 @@ boolean MPU9250::getZGyroFIFOEnabled() {
  * @see MPU9250_RA_FIFO_EN
  */
 void MPU9250::setZGyroFIFOEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_FIFO_EN, MPU9250_ZG_FIFO_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_FIFO_EN, MPU9250_ZG_FIFO_EN_BIT, enabled);
 }
 /** Get accelerometer FIFO enabled value.
  * When set to 1, this bit enables ACCEL_XOUT_H, ACCEL_XOUT_L, ACCEL_YOUT_H,
@@ -665,7 +892,7 @@ boolean MPU9250::getAccelFIFOEnabled() {
  * @see MPU9250_RA_FIFO_EN
  */
 void MPU9250::setAccelFIFOEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_FIFO_EN, MPU9250_ACCEL_FIFO_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_FIFO_EN, MPU9250_ACCEL_FIFO_EN_BIT, enabled);
 }
 /** Get Slave 2 FIFO enabled value.
  * When set to 1, this bit enables EXT_SENS_DATA registers (Registers 73 to 96)
@@ -683,7 +910,7 @@ boolean MPU9250::getSlave2FIFOEnabled() {
  * @see MPU9250_RA_FIFO_EN
  */
 void MPU9250::setSlave2FIFOEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_FIFO_EN, MPU9250_SLV2_FIFO_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_FIFO_EN, MPU9250_SLV2_FIFO_EN_BIT, enabled);
 }
 /** Get Slave 1 FIFO enabled value.
  * When set to 1, this bit enables EXT_SENS_DATA registers (Registers 73 to 96)
@@ -701,7 +928,7 @@ boolean MPU9250::getSlave1FIFOEnabled() {
  * @see MPU9250_RA_FIFO_EN
  */
 void MPU9250::setSlave1FIFOEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_FIFO_EN, MPU9250_SLV1_FIFO_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_FIFO_EN, MPU9250_SLV1_FIFO_EN_BIT, enabled);
 }
 /** Get Slave 0 FIFO enabled value.
  * When set to 1, this bit enables EXT_SENS_DATA registers (Registers 73 to 96)
@@ -719,7 +946,7 @@ boolean MPU9250::getSlave0FIFOEnabled() {
  * @see MPU9250_RA_FIFO_EN
  */
 void MPU9250::setSlave0FIFOEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_FIFO_EN, MPU9250_SLV0_FIFO_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_FIFO_EN, MPU9250_SLV0_FIFO_EN_BIT, enabled);
 }
 
 // I2C_MST_CTRL register
@@ -749,7 +976,7 @@ boolean MPU9250::getMultiMasterEnabled() {
  * @see MPU9250_RA_I2C_MST_CTRL
  */
 void MPU9250::setMultiMasterEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_I2C_MST_CTRL, MPU9250_MULT_MST_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_I2C_MST_CTRL, MPU9250_MULT_MST_EN_BIT, enabled);
 }
 /** Get wait-for-external-sensor-data enabled value.
  * When the WAIT_FOR_ES bit is set to 1, the Data Ready interrupt will be
@@ -772,7 +999,7 @@ boolean MPU9250::getWaitForExternalSensorEnabled() {
  * @see MPU9250_RA_I2C_MST_CTRL
  */
 void MPU9250::setWaitForExternalSensorEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_I2C_MST_CTRL, MPU9250_WAIT_FOR_ES_BIT, enabled);
+    writeRegBit(MPU9250_RA_I2C_MST_CTRL, MPU9250_WAIT_FOR_ES_BIT, enabled);
 }
 /** Get Slave 3 FIFO enabled value.
  * When set to 1, this bit enables EXT_SENS_DATA registers (Registers 73 to 96)
@@ -790,7 +1017,7 @@ boolean MPU9250::getSlave3FIFOEnabled() {
  * @see MPU9250_RA_MST_CTRL
  */
 void MPU9250::setSlave3FIFOEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_I2C_MST_CTRL, MPU9250_SLV_3_FIFO_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_I2C_MST_CTRL, MPU9250_SLV_3_FIFO_EN_BIT, enabled);
 }
 /** Get slave read/write transition enabled value.
  * The I2C_MST_P_NSR bit configures the I2C Master's transition from one slave
@@ -812,7 +1039,7 @@ boolean MPU9250::getSlaveReadWriteTransitionEnabled() {
  * @see MPU9250_RA_I2C_MST_CTRL
  */
 void MPU9250::setSlaveReadWriteTransitionEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_I2C_MST_CTRL, MPU9250_I2C_MST_P_NSR_BIT, enabled);
+    writeRegBit(MPU9250_RA_I2C_MST_CTRL, MPU9250_I2C_MST_P_NSR_BIT, enabled);
 }
 /** Get I2C master clock speed.
  * I2C_MST_CLK is a 4 bit unsigned value which configures a divider on the
@@ -852,7 +1079,7 @@ uint8 MPU9250::getMasterClockSpeed() {
  * @see MPU9250_RA_I2C_MST_CTRL
  */
 void MPU9250::setMasterClockSpeed(uint8 speed) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_I2C_MST_CTRL, MPU9250_I2C_MST_CLK_BIT, MPU9250_I2C_MST_CLK_LENGTH, speed);
+    writeRegBits(MPU9250_RA_I2C_MST_CTRL, MPU9250_I2C_MST_CLK_BIT, MPU9250_I2C_MST_CLK_LENGTH, speed);
 }
 
 // I2C_SLV* registers (Slave 0-3)
@@ -959,7 +1186,7 @@ boolean MPU9250::getSlaveEnabled(uint8 num) {
  */
 void MPU9250::setSlaveEnabled(uint8 num, boolean enabled) {
     if (num > 3) return;
-    I2Cdev::writeBit(devAddr, MPU9250_RA_I2C_SLV0_CTRL + num*3, MPU9250_I2C_SLV_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_I2C_SLV0_CTRL + num*3, MPU9250_I2C_SLV_EN_BIT, enabled);
 }
 /** Get word pair byte-swapping enabled for the specified slave (0-3).
  * When set to 1, this bit enables byte swapping. When byte swapping is enabled,
@@ -985,7 +1212,7 @@ boolean MPU9250::getSlaveWordByteSwap(uint8 num) {
  */
 void MPU9250::setSlaveWordByteSwap(uint8 num, boolean enabled) {
     if (num > 3) return;
-    I2Cdev::writeBit(devAddr, MPU9250_RA_I2C_SLV0_CTRL + num*3, MPU9250_I2C_SLV_BYTE_SW_BIT, enabled);
+    writeRegBit(MPU9250_RA_I2C_SLV0_CTRL + num*3, MPU9250_I2C_SLV_BYTE_SW_BIT, enabled);
 }
 /** Get write mode for the specified slave (0-3).
  * When set to 1, the transaction will read or write data only. When cleared to
@@ -1010,7 +1237,7 @@ boolean MPU9250::getSlaveWriteMode(uint8 num) {
  */
 void MPU9250::setSlaveWriteMode(uint8 num, boolean mode) {
     if (num > 3) return;
-    I2Cdev::writeBit(devAddr, MPU9250_RA_I2C_SLV0_CTRL + num*3, MPU9250_I2C_SLV_REG_DIS_BIT, mode);
+    writeRegBit(MPU9250_RA_I2C_SLV0_CTRL + num*3, MPU9250_I2C_SLV_REG_DIS_BIT, mode);
 }
 /** Get word pair grouping order offset for the specified slave (0-3).
  * This sets specifies the grouping order of word pairs received from registers.
@@ -1036,7 +1263,7 @@ boolean MPU9250::getSlaveWordGroupOffset(uint8 num) {
  */
 void MPU9250::setSlaveWordGroupOffset(uint8 num, boolean enabled) {
     if (num > 3) return;
-    I2Cdev::writeBit(devAddr, MPU9250_RA_I2C_SLV0_CTRL + num*3, MPU9250_I2C_SLV_GRP_BIT, enabled);
+    writeRegBit(MPU9250_RA_I2C_SLV0_CTRL + num*3, MPU9250_I2C_SLV_GRP_BIT, enabled);
 }
 /** Get number of bytes to read for the specified slave (0-3).
  * Specifies the number of bytes transferred to and from Slave 0. Clearing this
@@ -1058,7 +1285,7 @@ uint8 MPU9250::getSlaveDataLength(uint8 num) {
  */
 void MPU9250::setSlaveDataLength(uint8 num, uint8 length) {
     if (num > 3) return;
-    I2Cdev::writeBits(devAddr, MPU9250_RA_I2C_SLV0_CTRL + num*3, MPU9250_I2C_SLV_LEN_BIT, MPU9250_I2C_SLV_LEN_LENGTH, length);
+    writeRegBits(MPU9250_RA_I2C_SLV0_CTRL + num*3, MPU9250_I2C_SLV_LEN_BIT, MPU9250_I2C_SLV_LEN_LENGTH, length);
 }
 
 // I2C_SLV* registers (Slave 4)
@@ -1128,7 +1355,7 @@ boolean MPU9250::getSlave4Enabled() {
  * @see MPU9250_RA_I2C_SLV4_CTRL
  */
 void MPU9250::setSlave4Enabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_I2C_SLV4_CTRL, MPU9250_I2C_SLV4_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_I2C_SLV4_CTRL, MPU9250_I2C_SLV4_EN_BIT, enabled);
 }
 /** Get the enabled value for Slave 4 transaction interrupts.
  * When set to 1, this bit enables the generation of an interrupt signal upon
@@ -1149,7 +1376,7 @@ boolean MPU9250::getSlave4InterruptEnabled() {
  * @see MPU9250_RA_I2C_SLV4_CTRL
  */
 void MPU9250::setSlave4InterruptEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_I2C_SLV4_CTRL, MPU9250_I2C_SLV4_INT_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_I2C_SLV4_CTRL, MPU9250_I2C_SLV4_INT_EN_BIT, enabled);
 }
 /** Get write mode for Slave 4.
  * When set to 1, the transaction will read or write data only. When cleared to
@@ -1170,7 +1397,7 @@ boolean MPU9250::getSlave4WriteMode() {
  * @see MPU9250_RA_I2C_SLV4_CTRL
  */
 void MPU9250::setSlave4WriteMode(boolean mode) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_I2C_SLV4_CTRL, MPU9250_I2C_SLV4_REG_DIS_BIT, mode);
+    writeRegBit(MPU9250_RA_I2C_SLV4_CTRL, MPU9250_I2C_SLV4_REG_DIS_BIT, mode);
 }
 /** Get Slave 4 master delay value.
  * This configures the reduced access rate of I2C slaves relative to the Sample
@@ -1197,7 +1424,7 @@ uint8 MPU9250::getSlave4MasterDelay() {
  * @see MPU9250_RA_I2C_SLV4_CTRL
  */
 void MPU9250::setSlave4MasterDelay(uint8 delay) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_I2C_SLV4_CTRL, MPU9250_I2C_SLV4_MST_DLY_BIT, MPU9250_I2C_SLV4_MST_DLY_LENGTH, delay);
+    writeRegBits(MPU9250_RA_I2C_SLV4_CTRL, MPU9250_I2C_SLV4_MST_DLY_BIT, MPU9250_I2C_SLV4_MST_DLY_LENGTH, delay);
 }
 /** Get last available byte read from Slave 4.
  * This register stores the data read from Slave 4. This field is populated
@@ -1323,7 +1550,7 @@ boolean MPU9250::getInterruptMode() {
  * @see MPU9250_INTCFG_INT_LEVEL_BIT
  */
 void MPU9250::setInterruptMode(boolean mode) {
-   I2Cdev::writeBit(devAddr, MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_INT_LEVEL_BIT, mode);
+   writeRegBit(MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_INT_LEVEL_BIT, mode);
 }
 /** Get interrupt drive mode.
  * Will be set 0 for push-pull, 1 for open-drain.
@@ -1342,7 +1569,7 @@ boolean MPU9250::getInterruptDrive() {
  * @see MPU9250_INTCFG_INT_OPEN_BIT
  */
 void MPU9250::setInterruptDrive(boolean drive) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_INT_OPEN_BIT, drive);
+    writeRegBit(MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_INT_OPEN_BIT, drive);
 }
 /** Get interrupt latch mode.
  * Will be set 0 for 50us-pulse, 1 for latch-until-int-cleared.
@@ -1361,7 +1588,7 @@ boolean MPU9250::getInterruptLatch() {
  * @see MPU9250_INTCFG_LATCH_INT_EN_BIT
  */
 void MPU9250::setInterruptLatch(boolean latch) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_LATCH_INT_EN_BIT, latch);
+    writeRegBit(MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_LATCH_INT_EN_BIT, latch);
 }
 /** Get interrupt latch clear mode.
  * Will be set 0 for status-read-only, 1 for any-register-read.
@@ -1380,7 +1607,7 @@ boolean MPU9250::getInterruptLatchClear() {
  * @see MPU9250_INTCFG_INT_RD_CLEAR_BIT
  */
 void MPU9250::setInterruptLatchClear(boolean clear) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_INT_RD_CLEAR_BIT, clear);
+    writeRegBit(MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_INT_RD_CLEAR_BIT, clear);
 }
 /** Get FSYNC interrupt logic level mode.
  * @return Current FSYNC interrupt mode (0=active-high, 1=active-low)
@@ -1399,7 +1626,7 @@ boolean MPU9250::getFSyncInterruptLevel() {
  * @see MPU9250_INTCFG_FSYNC_INT_LEVEL_BIT
  */
 void MPU9250::setFSyncInterruptLevel(boolean level) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_FSYNC_INT_LEVEL_BIT, level);
+    writeRegBit(MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_FSYNC_INT_LEVEL_BIT, level);
 }
 /** Get FSYNC pin interrupt enabled setting.
  * Will be set 0 for disabled, 1 for enabled.
@@ -1418,7 +1645,7 @@ boolean MPU9250::getFSyncInterruptEnabled() {
  * @see MPU9250_INTCFG_FSYNC_INT_EN_BIT
  */
 void MPU9250::setFSyncInterruptEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_FSYNC_INT_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_FSYNC_INT_EN_BIT, enabled);
 }
 /** Get I2C bypass enabled status.
  * When this bit is equal to 1 and I2C_MST_EN (Register 106 bit[5]) is equal to
@@ -1447,7 +1674,7 @@ boolean MPU9250::getI2CBypassEnabled() {
  * @see MPU9250_INTCFG_I2C_BYPASS_EN_BIT
  */
 void MPU9250::setI2CBypassEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_I2C_BYPASS_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_I2C_BYPASS_EN_BIT, enabled);
 }
 /** Get reference clock output enabled status.
  * When this bit is equal to 1, a reference clock output is provided at the
@@ -1472,7 +1699,7 @@ boolean MPU9250::getClockOutputEnabled() {
  * @see MPU9250_INTCFG_CLKOUT_EN_BIT
  */
 void MPU9250::setClockOutputEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_CLKOUT_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_INT_PIN_CFG, MPU9250_INTCFG_CLKOUT_EN_BIT, enabled);
 }
 
 // INT_ENABLE register
@@ -1497,7 +1724,7 @@ uint8 MPU9250::getIntEnabled() {
  * @see MPU9250_INTERRUPT_FF_BIT
  **/
 void MPU9250::setIntEnabled(uint8 enabled) {
-    I2Cdev::writeByte(devAddr, MPU9250_RA_INT_ENABLE, enabled);
+    writeRegByte(MPU9250_RA_INT_ENABLE, enabled);
 }
 /** Get Free Fall interrupt enabled status.
  * Will be set 0 for disabled, 1 for enabled.
@@ -1516,7 +1743,7 @@ boolean MPU9250::getIntFreefallEnabled() {
  * @see MPU9250_INTERRUPT_FF_BIT
  **/
 void MPU9250::setIntFreefallEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_FF_BIT, enabled);
+    writeRegBit(MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_FF_BIT, enabled);
 }
 /** Get Motion Detection interrupt enabled status.
  * Will be set 0 for disabled, 1 for enabled.
@@ -1535,7 +1762,7 @@ boolean MPU9250::getIntMotionEnabled() {
  * @see MPU9250_INTERRUPT_MOT_BIT
  **/
 void MPU9250::setIntMotionEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_MOT_BIT, enabled);
+    writeRegBit(MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_MOT_BIT, enabled);
 }
 /** Get Zero Motion Detection interrupt enabled status.
  * Will be set 0 for disabled, 1 for enabled.
@@ -1554,7 +1781,7 @@ boolean MPU9250::getIntZeroMotionEnabled() {
  * @see MPU9250_INTERRUPT_ZMOT_BIT
  **/
 void MPU9250::setIntZeroMotionEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_ZMOT_BIT, enabled);
+    writeRegBit(MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_ZMOT_BIT, enabled);
 }
 /** Get FIFO Buffer Overflow interrupt enabled status.
  * Will be set 0 for disabled, 1 for enabled.
@@ -1573,7 +1800,7 @@ boolean MPU9250::getIntFIFOBufferOverflowEnabled() {
  * @see MPU9250_INTERRUPT_FIFO_OFLOW_BIT
  **/
 void MPU9250::setIntFIFOBufferOverflowEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_FIFO_OFLOW_BIT, enabled);
+    writeRegBit(MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_FIFO_OFLOW_BIT, enabled);
 }
 /** Get I2C Master interrupt enabled status.
  * This enables any of the I2C Master interrupt sources to generate an
@@ -1593,7 +1820,7 @@ boolean MPU9250::getIntI2CMasterEnabled() {
  * @see MPU9250_INTERRUPT_I2C_MST_INT_BIT
  **/
 void MPU9250::setIntI2CMasterEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_I2C_MST_INT_BIT, enabled);
+    writeRegBit(MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_I2C_MST_INT_BIT, enabled);
 }
 /** Get Data Ready interrupt enabled setting.
  * This event occurs each time a write operation to all of the sensor registers
@@ -1613,7 +1840,7 @@ boolean MPU9250::getIntDataReadyEnabled() {
  * @see MPU9250_INTERRUPT_DATA_RDY_BIT
  */
 void MPU9250::setIntDataReadyEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_DATA_RDY_BIT, enabled);
+    writeRegBit(MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_DATA_RDY_BIT, enabled);
 }
 
 // INT_STATUS register
@@ -1699,8 +1926,70 @@ boolean MPU9250::getIntDataReadyStatus() {
 
 // ACCEL_*OUT_* registers
 
+/** Switch the AK8963 operating mode through the I2C bypass.
+ * The AK8963 must pass through power-down, and stay there at least
+ * MPU9250_MAG_MODE_DELAY, before it enters any other mode, so this always
+ * writes power-down first. The bypass must be enabled.
+ * @param mode New CNTL1 value (MPU9250_MAG_MODE_*)
+ * @return Status of operation (true = success)
+ */
+boolean MPU9250::setMagMode(uint8 mode) {
+    if (!I2Cdev::writeByte(MPU9150_RA_MAG_ADDRESS, MPU9150_RA_MAG_CNTL, MPU9250_MAG_MODE_POWER_DOWN)) return false;
+    if (mode == MPU9250_MAG_MODE_POWER_DOWN) return true;
+    delayMicroseconds(MPU9250_MAG_MODE_DELAY);
+    return I2Cdev::writeByte(MPU9150_RA_MAG_ADDRESS, MPU9150_RA_MAG_CNTL, mode);
+}
+
+/** Let the internal I2C master fetch the magnetometer on every sample.
+ * When enabled, the AK8963 is put into 100 Hz continuous measurement mode
+ * through the bypass, then the bypass is closed and I2C_SLV0 is set up to
+ * read its ST1..ST2 registers (8 bytes) into EXT_SENS_DATA_00..07 at the
+ * sample rate. Reading ST2 last releases the AK8963 data lock, and the data
+ * ready interrupt waits for the fetch to finish. getMotion9() then needs a
+ * single 22-byte burst from ACCEL_XOUT_H and no delays.
+ * When disabled, I2C_SLV0 and the I2C master are switched off again and the
+ * AK8963 is powered down.
+ * @param enabled New auto-fetch mode
+ * @return Status of operation (true = success)
+ * @see getMotion9()
+ * @see MPU9250_RA_EXT_SENS_DATA_00
+ */
+boolean MPU9250::setMagAutoFetchEnabled(boolean enabled) {
+    magAutoFetch = false;
+    setSlaveEnabled(0, false);
+    setI2CMasterModeEnabled(false);
+
+    setI2CBypassEnabled(true);
+    boolean ok = setMagMode(enabled ? MPU9250_MAG_MODE_CONT2_16BIT : MPU9250_MAG_MODE_POWER_DOWN);
+    setI2CBypassEnabled(false);
+    if (!ok || !enabled) return ok;
+
+    setSlaveAddress(0, 0x80 | MPU9150_RA_MAG_ADDRESS); // read
+    setSlaveRegister(0, MPU9150_RA_MAG_ST1);
+    beginConfig();
+    setMasterClockSpeed(13); // 400 kHz
+    setWaitForExternalSensorEnabled(true);
+    writeRegByte(MPU9250_RA_I2C_SLV0_CTRL, (1 << MPU9250_I2C_SLV_EN_BIT) | MPU9250_MAG_FETCH_LENGTH);
+    setI2CMasterModeEnabled(true);
+    if (!commitConfig()) return false;
+    magAutoFetch = true;
+    return true;
+}
+
+/** Get magnetometer auto-fetch mode.
+ * @return Current auto-fetch mode
+ * @see setMagAutoFetchEnabled()
+ */
+boolean MPU9250::getMagAutoFetchEnabled() {
+    return magAutoFetch;
+}
+
 /** Get raw 9-axis motion sensor readings (accel/gyro/compass).
- * FUNCTION NOT FULLY IMPLEMENTED YET.
+ * With setMagAutoFetchEnabled(true) this is one 22-byte burst read covering
+ * ACCEL_XOUT_H..EXT_SENS_DATA_07. Otherwise it falls back to switching the
+ * bypass on and triggering a single AK8963 measurement, which takes ~20ms.
+ * Either way the AK8963's ST1 and ST2 come along with the data; see
+ * getMagStatus().
  * @param ax 16-bit signed integer container for accelerometer X-axis value
  * @param ay 16-bit signed integer container for accelerometer Y-axis value
  * @param az 16-bit signed integer container for accelerometer Z-axis value
@@ -1710,25 +1999,66 @@ boolean MPU9250::getIntDataReadyStatus() {
  * @param mx 16-bit signed integer container for magnetometer X-axis value
  * @param my 16-bit signed integer container for magnetometer Y-axis value
  * @param mz 16-bit signed integer container for magnetometer Z-axis value
+ * @return True if mx/my/mz hold a new measurement without overflow (ST1 DRDY
+ *         set, ST2 HOFL clear), false if they repeat the last one, are
+ *         invalid or could not be read
+ * @see getMagStatus()
  * @see getMotion6()
  * @see getAcceleration()
  * @see getRotation()
  * @see MPU9250_RA_ACCEL_XOUT_H
  */
-void MPU9250::getMotion9(int16* ax, int16* ay, int16* az, int16* gx, int16* gy, int16* gz, int16* mx, int16* my, int16* mz) {
-    
+boolean MPU9250::getMotion9(int16* ax, int16* ay, int16* az, int16* gx, int16* gy, int16* gz, int16* mx, int16* my, int16* mz) {
+    if (magAutoFetch) {
+        // accel (6), temp (2), gyro (6), then ST1, HXL..HZH, ST2 from EXT_SENS_DATA
+        if (I2Cdev::readBytes(devAddr, MPU9250_RA_ACCEL_XOUT_H, 14 + MPU9250_MAG_FETCH_LENGTH, buffer) < 0) {
+            magStatus = 0;
+            return false;
+        }
+        *ax = (((int16)buffer[0]) << 8) | buffer[1];
+        *ay = (((int16)buffer[2]) << 8) | buffer[3];
+        *az = (((int16)buffer[4]) << 8) | buffer[5];
+        *gx = (((int16)buffer[8]) << 8) | buffer[9];
+        *gy = (((int16)buffer[10]) << 8) | buffer[11];
+        *gz = (((int16)buffer[12]) << 8) | buffer[13];
+        *mx = (((int16)buffer[16]) << 8) | buffer[15];
+        *my = (((int16)buffer[18]) << 8) | buffer[17];
+        *mz = (((int16)buffer[20]) << 8) | buffer[19];
+        magStatus = (buffer[14] & MPU9250_MAG_STATUS_DRDY) | (buffer[21] & MPU9250_MAG_STATUS_HOFL);
+        return magStatus == MPU9250_MAG_STATUS_DRDY;
+    }
+
 	//get accel and gyro
 	getMotion6(ax, ay, az, gx, gy, gz);
 	
 	//read mag
-	I2Cdev::writeByte(devAddr, MPU9250_RA_INT_PIN_CFG, 0x02); //set i2c bypass enable pin to true to access magnetometer
+	writeRegByte(MPU9250_RA_INT_PIN_CFG, 0x02); //set i2c bypass enable pin to true to access magnetometer
 	delay(10);
-	I2Cdev::writeByte(MPU9150_RA_MAG_ADDRESS, 0x0A, 0x01); //enable the magnetometer
+	setMagMode(MPU9250_MAG_MODE_SINGLE); //enable the magnetometer (via power-down, it may be in continuous mode)
 	delay(10);
-	I2Cdev::readBytes(MPU9150_RA_MAG_ADDRESS, MPU9150_RA_MAG_XOUT_L, 6, buffer);
-	*mx = (((int16)buffer[1]) << 8) | buffer[0];
-    *my = (((int16)buffer[3]) << 8) | buffer[2];
-    *mz = (((int16)buffer[5]) << 8) | buffer[4];		
+	// ST1, HXL..HZH, ST2; reading ST2 ends the measurement's data read
+	if (I2Cdev::readBytes(MPU9150_RA_MAG_ADDRESS, MPU9150_RA_MAG_ST1, MPU9250_MAG_FETCH_LENGTH, buffer) < 0) {
+		magStatus = 0;
+		return false;
+	}
+	*mx = (((int16)buffer[2]) << 8) | buffer[1];
+    *my = (((int16)buffer[4]) << 8) | buffer[3];
+    *mz = (((int16)buffer[6]) << 8) | buffer[5];
+    magStatus = (buffer[0] & MPU9250_MAG_STATUS_DRDY) | (buffer[7] & MPU9250_MAG_STATUS_HOFL);
+    return magStatus == MPU9250_MAG_STATUS_DRDY;
+}
+
+/** Get the magnetometer status seen by the last getMotion9().
+ * With auto-fetch the status bytes are those of the internal I2C master's
+ * fetch for the current sample, so DRDY is set for one sample period after
+ * each new AK8963 measurement: read every sample to see each one.
+ * @return MPU9250_MAG_STATUS_DRDY if that call read a new measurement, plus
+ *         MPU9250_MAG_STATUS_HOFL if the AK8963 flagged it as overflowed
+ *         (0 if the read failed)
+ * @see getMotion9()
+ */
+uint8 MPU9250::getMagStatus() {
+    return magStatus;
 }
 /** Get raw 6-axis motion sensor readings (accel/gyro).
  * Retrieves all currently available motion sensor values.
@@ -2101,7 +2431,7 @@ boolean MPU9250::getExternalShadowDelayEnabled() {
  * @see MPU9250_DELAYCTRL_DELAY_ES_SHADOW_BIT
  */
 void MPU9250::setExternalShadowDelayEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_I2C_MST_DELAY_CTRL, MPU9250_DELAYCTRL_DELAY_ES_SHADOW_BIT, enabled);
+    writeRegBit(MPU9250_RA_I2C_MST_DELAY_CTRL, MPU9250_DELAYCTRL_DELAY_ES_SHADOW_BIT, enabled);
 }
 /** Get slave delay enabled status.
  * When a particular slave delay is enabled, the rate of access for the that
@@ -2134,7 +2464,7 @@ boolean MPU9250::getSlaveDelayEnabled(uint8 num) {
  * @see MPU9250_DELAYCTRL_I2C_SLV0_DLY_EN_BIT
  */
 void MPU9250::setSlaveDelayEnabled(uint8 num, boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_I2C_MST_DELAY_CTRL, num, enabled);
+    writeRegBit(MPU9250_RA_I2C_MST_DELAY_CTRL, num, enabled);
 }
 
 // SIGNAL_PATH_RESET register
@@ -2146,7 +2476,7 @@ void MPU9250::setSlaveDelayEnabled(uint8 num, boolean enabled) {
  * @see MPU9250_PATHRESET_GYRO_RESET_BIT
  */
 void MPU9250::resetGyroscopePath() {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_SIGNAL_PATH_RESET, MPU9250_PATHRESET_GYRO_RESET_BIT, true);
+    writeRegBit(MPU9250_RA_SIGNAL_PATH_RESET, MPU9250_PATHRESET_GYRO_RESET_BIT, true);
 }
 /** Reset accelerometer signal path.
  * The reset will revert the signal path analog to digital converters and
@@ -2155,7 +2485,7 @@ void MPU9250::resetGyroscopePath() {
  * @see MPU9250_PATHRESET_ACCEL_RESET_BIT
  */
 void MPU9250::resetAccelerometerPath() {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_SIGNAL_PATH_RESET, MPU9250_PATHRESET_ACCEL_RESET_BIT, true);
+    writeRegBit(MPU9250_RA_SIGNAL_PATH_RESET, MPU9250_PATHRESET_ACCEL_RESET_BIT, true);
 }
 /** Reset temperature sensor signal path.
  * The reset will revert the signal path analog to digital converters and
@@ -2164,7 +2494,7 @@ void MPU9250::resetAccelerometerPath() {
  * @see MPU9250_PATHRESET_TEMP_RESET_BIT
  */
 void MPU9250::resetTemperaturePath() {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_SIGNAL_PATH_RESET, MPU9250_PATHRESET_TEMP_RESET_BIT, true);
+    writeRegBit(MPU9250_RA_SIGNAL_PATH_RESET, MPU9250_PATHRESET_TEMP_RESET_BIT, true);
 }
 
 // MOT_DETECT_CTRL register
@@ -2194,7 +2524,7 @@ uint8 MPU9250::getAccelerometerPowerOnDelay() {
  * @see MPU9250_DETECT_ACCEL_ON_DELAY_BIT
  */
 void MPU9250::setAccelerometerPowerOnDelay(uint8 delay) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_MOT_DETECT_CTRL, MPU9250_DETECT_ACCEL_ON_DELAY_BIT, MPU9250_DETECT_ACCEL_ON_DELAY_LENGTH, delay);
+    writeRegBits(MPU9250_RA_MOT_DETECT_CTRL, MPU9250_DETECT_ACCEL_ON_DELAY_BIT, MPU9250_DETECT_ACCEL_ON_DELAY_LENGTH, delay);
 }
 /** Get Free Fall detection counter decrement configuration.
  * Detection is registered by the Free Fall detection module after accelerometer
@@ -2233,7 +2563,7 @@ uint8 MPU9250::getFreefallDetectionCounterDecrement() {
  * @see MPU9250_DETECT_FF_COUNT_BIT
  */
 void MPU9250::setFreefallDetectionCounterDecrement(uint8 decrement) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_MOT_DETECT_CTRL, MPU9250_DETECT_FF_COUNT_BIT, MPU9250_DETECT_FF_COUNT_LENGTH, decrement);
+    writeRegBits(MPU9250_RA_MOT_DETECT_CTRL, MPU9250_DETECT_FF_COUNT_BIT, MPU9250_DETECT_FF_COUNT_LENGTH, decrement);
 }
 /** Get Motion detection counter decrement configuration.
  * Detection is registered by the Motion detection module after accelerometer
@@ -2269,7 +2599,7 @@ uint8 MPU9250::getMotionDetectionCounterDecrement() {
  * @see MPU9250_DETECT_MOT_COUNT_BIT
  */
 void MPU9250::setMotionDetectionCounterDecrement(uint8 decrement) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_MOT_DETECT_CTRL, MPU9250_DETECT_MOT_COUNT_BIT, MPU9250_DETECT_MOT_COUNT_LENGTH, decrement);
+    writeRegBits(MPU9250_RA_MOT_DETECT_CTRL, MPU9250_DETECT_MOT_COUNT_BIT, MPU9250_DETECT_MOT_COUNT_LENGTH, decrement);
 }
 
 // USER_CTRL register
@@ -2293,7 +2623,7 @@ boolean MPU9250::getFIFOEnabled() {
  * @see MPU9250_USERCTRL_FIFO_EN_BIT
  */
 void MPU9250::setFIFOEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_FIFO_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_FIFO_EN_BIT, enabled);
 }
 /** Get I2C Master Mode enabled status.
  * When this mode is enabled, the MPU-60X0 acts as the I2C Master to the
@@ -2317,14 +2647,14 @@ boolean MPU9250::getI2CMasterModeEnabled() {
  * @see MPU9250_USERCTRL_I2C_MST_EN_BIT
  */
 void MPU9250::setI2CMasterModeEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_I2C_MST_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_I2C_MST_EN_BIT, enabled);
 }
 /** Switch from I2C to SPI mode (MPU-6000 only)
  * If this is set, the primary SPI interface will be enabled in place of the
  * disabled primary I2C interface.
  */
 void MPU9250::switchSPIEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_I2C_IF_DIS_BIT, enabled);
+    writeRegBit(MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_I2C_IF_DIS_BIT, enabled);
 }
 /** Reset the FIFO.
  * This bit resets the FIFO buffer when set to 1 while FIFO_EN equals 0. This
@@ -2333,7 +2663,7 @@ void MPU9250::switchSPIEnabled(boolean enabled) {
  * @see MPU9250_USERCTRL_FIFO_RESET_BIT
  */
 void MPU9250::resetFIFO() {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_FIFO_RESET_BIT, true);
+    writeRegBit(MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_FIFO_RESET_BIT, true);
 }
 /** Reset the I2C Master.
  * This bit resets the I2C Master when set to 1 while I2C_MST_EN equals 0.
@@ -2342,7 +2672,7 @@ void MPU9250::resetFIFO() {
  * @see MPU9250_USERCTRL_I2C_MST_RESET_BIT
  */
 void MPU9250::resetI2CMaster() {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_I2C_MST_RESET_BIT, true);
+    writeRegBit(MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_I2C_MST_RESET_BIT, true);
 }
 /** Reset all sensor registers and signal paths.
  * When set to 1, this bit resets the signal paths for all sensors (gyroscopes,
@@ -2357,7 +2687,7 @@ void MPU9250::resetI2CMaster() {
  * @see MPU9250_USERCTRL_SIG_COND_RESET_BIT
  */
 void MPU9250::resetSensors() {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_SIG_COND_RESET_BIT, true);
+    writeRegBit(MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_SIG_COND_RESET_BIT, true);
 }
 
 // PWR_MGMT_1 register
@@ -2368,7 +2698,8 @@ void MPU9250::resetSensors() {
  * @see MPU9250_PWR1_DEVICE_RESET_BIT
  */
 void MPU9250::reset() {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_PWR_MGMT_1, MPU9250_PWR1_DEVICE_RESET_BIT, true);
+    magAutoFetch = false;
+    writeRegBit(MPU9250_RA_PWR_MGMT_1, MPU9250_PWR1_DEVICE_RESET_BIT, true);
 }
 /** Get sleep mode status.
  * Setting the SLEEP bit in the register puts the device into very low power
@@ -2392,7 +2723,7 @@ boolean MPU9250::getSleepEnabled() {
  * @see MPU9250_PWR1_SLEEP_BIT
  */
 void MPU9250::setSleepEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_PWR_MGMT_1, MPU9250_PWR1_SLEEP_BIT, enabled);
+    writeRegBit(MPU9250_RA_PWR_MGMT_1, MPU9250_PWR1_SLEEP_BIT, enabled);
 }
 /** Get wake cycle enabled status.
  * When this bit is set to 1 and SLEEP is disabled, the MPU-60X0 will cycle
@@ -2413,7 +2744,7 @@ boolean MPU9250::getWakeCycleEnabled() {
  * @see MPU9250_PWR1_CYCLE_BIT
  */
 void MPU9250::setWakeCycleEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_PWR_MGMT_1, MPU9250_PWR1_CYCLE_BIT, enabled);
+    writeRegBit(MPU9250_RA_PWR_MGMT_1, MPU9250_PWR1_CYCLE_BIT, enabled);
 }
 /** Get temperature sensor enabled status.
  * Control the usage of the internal temperature sensor.
@@ -2442,7 +2773,7 @@ boolean MPU9250::getTempSensorEnabled() {
  */
 void MPU9250::setTempSensorEnabled(boolean enabled) {
     // 1 is actually disabled here
-    I2Cdev::writeBit(devAddr, MPU9250_RA_PWR_MGMT_1, MPU9250_PWR1_TEMP_DIS_BIT, !enabled);
+    writeRegBit(MPU9250_RA_PWR_MGMT_1, MPU9250_PWR1_TEMP_DIS_BIT, !enabled);
 }
 /** Get clock source setting.
  * @return Current clock source setting
@@ -2485,7 +2816,7 @@ uint8 MPU9250::getClockSource() {
  * @see MPU9250_PWR1_CLKSEL_LENGTH
  */
 void MPU9250::setClockSource(uint8 source) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_PWR_MGMT_1, MPU9250_PWR1_CLKSEL_BIT, MPU9250_PWR1_CLKSEL_LENGTH, source);
+    writeRegBits(MPU9250_RA_PWR_MGMT_1, MPU9250_PWR1_CLKSEL_BIT, MPU9250_PWR1_CLKSEL_LENGTH, source);
 }
 
 // PWR_MGMT_2 register
@@ -2522,7 +2853,7 @@ uint8 MPU9250::getWakeFrequency() {
  * @see MPU9250_RA_PWR_MGMT_2
  */
 void MPU9250::setWakeFrequency(uint8 frequency) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_LP_WAKE_CTRL_BIT, MPU9250_PWR2_LP_WAKE_CTRL_LENGTH, frequency);
+    writeRegBits(MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_LP_WAKE_CTRL_BIT, MPU9250_PWR2_LP_WAKE_CTRL_LENGTH, frequency);
 }
 
 /** Get X-axis accelerometer standby enabled status.
@@ -2542,7 +2873,7 @@ boolean MPU9250::getStandbyXAccelEnabled() {
  * @see MPU9250_PWR2_STBY_XA_BIT
  */
 void MPU9250::setStandbyXAccelEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_STBY_XA_BIT, enabled);
+    writeRegBit(MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_STBY_XA_BIT, enabled);
 }
 /** Get Y-axis accelerometer standby enabled status.
  * If enabled, the Y-axis will not gather or report data (or use power).
@@ -2561,7 +2892,7 @@ boolean MPU9250::getStandbyYAccelEnabled() {
  * @see MPU9250_PWR2_STBY_YA_BIT
  */
 void MPU9250::setStandbyYAccelEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_STBY_YA_BIT, enabled);
+    writeRegBit(MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_STBY_YA_BIT, enabled);
 }
 /** Get Z-axis accelerometer standby enabled status.
  * If enabled, the Z-axis will not gather or report data (or use power).
@@ -2580,7 +2911,7 @@ boolean MPU9250::getStandbyZAccelEnabled() {
  * @see MPU9250_PWR2_STBY_ZA_BIT
  */
 void MPU9250::setStandbyZAccelEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_STBY_ZA_BIT, enabled);
+    writeRegBit(MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_STBY_ZA_BIT, enabled);
 }
 /** Get X-axis gyroscope standby enabled status.
  * If enabled, the X-axis will not gather or report data (or use power).
@@ -2599,7 +2930,7 @@ boolean MPU9250::getStandbyXGyroEnabled() {
  * @see MPU9250_PWR2_STBY_XG_BIT
  */
 void MPU9250::setStandbyXGyroEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_STBY_XG_BIT, enabled);
+    writeRegBit(MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_STBY_XG_BIT, enabled);
 }
 /** Get Y-axis gyroscope standby enabled status.
  * If enabled, the Y-axis will not gather or report data (or use power).
@@ -2618,7 +2949,7 @@ boolean MPU9250::getStandbyYGyroEnabled() {
  * @see MPU9250_PWR2_STBY_YG_BIT
  */
 void MPU9250::setStandbyYGyroEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_STBY_YG_BIT, enabled);
+    writeRegBit(MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_STBY_YG_BIT, enabled);
 }
 /** Get Z-axis gyroscope standby enabled status.
  * If enabled, the Z-axis will not gather or report data (or use power).
@@ -2637,7 +2968,7 @@ boolean MPU9250::getStandbyZGyroEnabled() {
  * @see MPU9250_PWR2_STBY_ZG_BIT
  */
 void MPU9250::setStandbyZGyroEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_STBY_ZG_BIT, enabled);
+    writeRegBit(MPU9250_RA_PWR_MGMT_2, MPU9250_PWR2_STBY_ZG_BIT, enabled);
 }
 
 // FIFO_COUNT* registers
@@ -2688,6 +3019,30 @@ uint8 MPU9250::getFIFOByte() {
 void MPU9250::getFIFOBytes(uint8 *data, uint8 length) {
     I2Cdev::readBytes(devAddr, MPU9250_RA_FIFO_R_W, length, data);
 }
+/** Read a block of any size from the FIFO buffer in one logical call.
+ * The whole block is streamed through FIFO_R_W in BUFFER_LENGTH chunks with a
+ * single register address write, so draining a full 512-byte FIFO costs one
+ * call instead of one call per packet.
+ * @param data Buffer to store the bytes in (at least length bytes)
+ * @param length Number of bytes to read (normally up to getFIFOCount())
+ * @return Number of bytes read (-1 indicates failure)
+ * @see getFIFOCount()
+ * @see I2Cdev::readBurst()
+ */
+int16 MPU9250::getFIFOBurst(uint8 *data, uint16 length) {
+    return I2Cdev::readBurst(devAddr, MPU9250_RA_FIFO_R_W, length, data);
+}
+/** Queue a FIFO read to run in the background of I2Cdev::poll().
+ * @param data Buffer to store the bytes in (must stay valid until completion)
+ * @param length Number of bytes to read
+ * @param callback Optional completion callback (bytes read, or -1 on failure)
+ * @param context Passed through to the callback
+ * @return True if the read was queued
+ * @see I2Cdev::submitRead()
+ */
+boolean MPU9250::getFIFOBurstAsync(uint8 *data, uint16 length, I2CdevCallback callback, void *context) {
+    return I2Cdev::submitRead(devAddr, MPU9250_RA_FIFO_R_W, length, data, callback, context);
+}
 /** Write byte to FIFO buffer.
  * @see getFIFOByte()
  * @see MPU9250_RA_FIFO_R_W
@@ -2719,7 +3074,7 @@ uint8 MPU9250::getDeviceID() {
  * @see MPU9250_WHO_AM_I_LENGTH
  */
 void MPU9250::setDeviceID(uint8 id) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_WHO_AM_I, MPU9250_WHO_AM_I_BIT, MPU9250_WHO_AM_I_LENGTH, id);
+    writeRegBits(MPU9250_RA_WHO_AM_I, MPU9250_WHO_AM_I_BIT, MPU9250_WHO_AM_I_LENGTH, id);
 }
 
 // ======== UNDOCUMENTED/DMP REGISTERS/METHODS ========
@@ -2731,14 +3086,14 @@ uint8 MPU9250::getOTPBankValid() {
     return buffer[0];
 }
 void MPU9250::setOTPBankValid(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_XG_OFFS_TC, MPU9250_TC_OTP_BNK_VLD_BIT, enabled);
+    writeRegBit(MPU9250_RA_XG_OFFS_TC, MPU9250_TC_OTP_BNK_VLD_BIT, enabled);
 }
 int8 MPU9250::getXGyroOffset() {
     I2Cdev::readBits(devAddr, MPU9250_RA_XG_OFFS_TC, MPU9250_TC_OFFSET_BIT, MPU9250_TC_OFFSET_LENGTH, buffer);
     return buffer[0];
 }
 void MPU9250::setXGyroOffset(int8 offset) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_XG_OFFS_TC, MPU9250_TC_OFFSET_BIT, MPU9250_TC_OFFSET_LENGTH, offset);
+    writeRegBits(MPU9250_RA_XG_OFFS_TC, MPU9250_TC_OFFSET_BIT, MPU9250_TC_OFFSET_LENGTH, offset);
 }
 
 // YG_OFFS_TC register
@@ -2748,7 +3103,7 @@ int8 MPU9250::getYGyroOffset() {
     return buffer[0];
 }
 void MPU9250::setYGyroOffset(int8 offset) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_YG_OFFS_TC, MPU9250_TC_OFFSET_BIT, MPU9250_TC_OFFSET_LENGTH, offset);
+    writeRegBits(MPU9250_RA_YG_OFFS_TC, MPU9250_TC_OFFSET_BIT, MPU9250_TC_OFFSET_LENGTH, offset);
 }
 
 // ZG_OFFS_TC register
@@ -2758,7 +3113,7 @@ int8 MPU9250::getZGyroOffset() {
     return buffer[0];
 }
 void MPU9250::setZGyroOffset(int8 offset) {
-    I2Cdev::writeBits(devAddr, MPU9250_RA_ZG_OFFS_TC, MPU9250_TC_OFFSET_BIT, MPU9250_TC_OFFSET_LENGTH, offset);
+    writeRegBits(MPU9250_RA_ZG_OFFS_TC, MPU9250_TC_OFFSET_BIT, MPU9250_TC_OFFSET_LENGTH, offset);
 }
 
 // X_FINE_GAIN register
@@ -2858,14 +3213,14 @@ boolean MPU9250::getIntPLLReadyEnabled() {
     return buffer[0];
 }
 void MPU9250::setIntPLLReadyEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_PLL_RDY_INT_BIT, enabled);
+    writeRegBit(MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_PLL_RDY_INT_BIT, enabled);
 }
 boolean MPU9250::getIntDMPEnabled() {
     I2Cdev::readBit(devAddr, MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_DMP_INT_BIT, buffer);
     return buffer[0];
 }
 void MPU9250::setIntDMPEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_DMP_INT_BIT, enabled);
+    writeRegBit(MPU9250_RA_INT_ENABLE, MPU9250_INTERRUPT_DMP_INT_BIT, enabled);
 }
 
 // DMP_INT_STATUS
@@ -2913,10 +3268,10 @@ boolean MPU9250::getDMPEnabled() {
     return buffer[0];
 }
 void MPU9250::setDMPEnabled(boolean enabled) {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_DMP_EN_BIT, enabled);
+    writeRegBit(MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_DMP_EN_BIT, enabled);
 }
 void MPU9250::resetDMP() {
-    I2Cdev::writeBit(devAddr, MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_DMP_RESET_BIT, true);
+    writeRegBit(MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_DMP_RESET_BIT, true);
 }
 
 // BANK_SEL register
@@ -2979,12 +3334,11 @@ boolean MPU9250::writeMemoryBlock(const uint8 *data, uint16 dataSize, uint8 bank
     setMemoryBank(bank);
     setMemoryStartAddress(address);
     uint8 chunkSize;
-    uint8 *verifyBuffer;
+    uint8 verifyBuffer[MPU9250_DMP_MEMORY_CHUNK_SIZE];
+    uint8 progChunk[MPU9250_DMP_MEMORY_CHUNK_SIZE];
     uint8 *progBuffer;
     uint16 i;
     uint8 j;
-    if (verify) verifyBuffer = (uint8 *)malloc(MPU9250_DMP_MEMORY_CHUNK_SIZE);
-    if (useProgMem) progBuffer = (uint8 *)malloc(MPU9250_DMP_MEMORY_CHUNK_SIZE);
     for (i = 0; i < dataSize;) {
         // determine correct chunk size according to bank position and data size
         chunkSize = MPU9250_DMP_MEMORY_CHUNK_SIZE;
@@ -2997,7 +3351,8 @@ boolean MPU9250::writeMemoryBlock(const uint8 *data, uint16 dataSize, uint8 bank
         
         if (useProgMem) {
             // write the chunk of data as specified
-            for (j = 0; j < chunkSize; j++) progBuffer[j] = (*( const unsigned char*) (data + i + j));
+            for (j = 0; j < chunkSize; j++) progChunk[j] = (*( const unsigned char*) (data + i + j));
+            progBuffer = progChunk;
         } else {
             // write the chunk of data as specified
             progBuffer = (uint8 *)data + i;
@@ -3006,7 +3361,7 @@ boolean MPU9250::writeMemoryBlock(const uint8 *data, uint16 dataSize, uint8 bank
         I2Cdev::writeBytes(devAddr, MPU9250_RA_MEM_R_W, chunkSize, progBuffer);
 
         // verify data if needed
-        if (verify && verifyBuffer) {
+        if (verify) {
             setMemoryBank(bank);
             setMemoryStartAddress(address);
             I2Cdev::readBytes(devAddr, MPU9250_RA_MEM_R_W, chunkSize, verifyBuffer);
@@ -3028,8 +3383,6 @@ boolean MPU9250::writeMemoryBlock(const uint8 *data, uint16 dataSize, uint8 bank
                     Serial.print(verifyBuffer[i + j], HEX);
                 }
                 Serial.print("\n");*/
-                free(verifyBuffer);
-                if (useProgMem) free(progBuffer);
                 return false; // uh oh.
             }
         }
@@ -3047,19 +3400,86 @@ boolean MPU9250::writeMemoryBlock(const uint8 *data, uint16 dataSize, uint8 bank
             setMemoryStartAddress(address);
         }
     }
-    if (verify) free(verifyBuffer);
-    if (useProgMem) free(progBuffer);
     return true;
 }
 boolean MPU9250::writeProgMemoryBlock(const uint8 *data, uint16 dataSize, uint8 bank, uint8 address, boolean verify) {
     return writeMemoryBlock(data, dataSize, bank, address, verify, true);
 }
-boolean MPU9250::writeDMPConfigurationSet(const uint8 *data, uint16 dataSize, boolean useProgMem) {
-    uint8 *progBuffer, success, special;
-    uint16 i, j;
-    if (useProgMem) {
-        progBuffer = (uint8 *)malloc(8); // assume 8-byte blocks, realloc later if necessary
+/** Load a large block (e.g. the DMP firmware) into DMP memory quickly.
+ * writeMemoryBlock() with verify re-addresses the bank and reads back every
+ * 16-byte chunk as it goes, which doubles the bus traffic of a full image load.
+ * Here each bank is addressed once and streamed in MPU9250_DMP_MEMORY_BURST_SIZE
+ * writes (MEM_START_ADDR auto-increments across them), then the whole image is
+ * read back in one sequential pass per bank. Only a bank that fails that
+ * comparison is rewritten, chunk by chunk with writeMemoryBlock()'s verify, up
+ * to MPU9250_DMP_LOAD_RETRIES times.
+ * @param data Block to write
+ * @param dataSize Number of bytes to write
+ * @param bank Starting DMP memory bank
+ * @param address Starting address within the bank
+ * @param useProgMem True if data is in program memory
+ * @return True if the whole block reads back correctly
+ * @see writeMemoryBlock()
+ */
+boolean MPU9250::writeMemoryImage(const uint8 *data, uint16 dataSize, uint8 bank, uint8 address, boolean useProgMem) {
+    uint8 chunk[BUFFER_LENGTH];
+    uint16 i, start, length, k;
+    uint8 b, a, j, chunkSize;
+    uint32 badBanks = 0;
+
+    // pass 1: stream every bank without readback
+    for (i = 0, b = bank, a = address; i < dataSize; b++, a = 0) {
+        length = min(dataSize - i, MPU9250_DMP_MEMORY_BANK_SIZE - a);
+        setMemoryBank(b);
+        setMemoryStartAddress(a);
+        for (k = 0; k < length; k += chunkSize) {
+            chunkSize = min(length - k, MPU9250_DMP_MEMORY_BURST_SIZE);
+            for (j = 0; j < chunkSize; j++) chunk[j] = useProgMem ? (*(const unsigned char *)(data + i + k + j)) : data[i + k + j];
+            I2Cdev::writeBytes(devAddr, MPU9250_RA_MEM_R_W, chunkSize, chunk);
+        }
+        i += length;
+    }
+
+    // pass 2: one sequential readback per bank, note the banks that differ
+    for (i = 0, b = bank, a = address; i < dataSize; b++, a = 0) {
+        length = min(dataSize - i, MPU9250_DMP_MEMORY_BANK_SIZE - a);
+        setMemoryBank(b);
+        setMemoryStartAddress(a);
+        for (k = 0; k < length; k += chunkSize) {
+            chunkSize = min(length - k, BUFFER_LENGTH);
+            boolean match = I2Cdev::readBytes(devAddr, MPU9250_RA_MEM_R_W, chunkSize, chunk) == chunkSize;
+            // expected bytes through the same program memory path as pass 1
+            for (j = 0; match && j < chunkSize; j++) {
+                match = chunk[j] == (useProgMem ? (*(const unsigned char *)(data + i + k + j)) : data[i + k + j]);
+            }
+            if (!match) {
+                badBanks |= (uint32)1 << (b - bank);
+                break;
+            }
+        }
+        i += length;
+    }
+
+    // fall back to verified chunk writes for the failing banks only
+    for (i = 0, b = bank, a = address; badBanks != 0 && i < dataSize; b++, a = 0) {
+        start = i;
+        length = min(dataSize - i, MPU9250_DMP_MEMORY_BANK_SIZE - a);
+        i += length;
+        if (!(badBanks & ((uint32)1 << (b - bank)))) continue;
+        for (j = 0; j < MPU9250_DMP_LOAD_RETRIES; j++) {
+            if (writeMemoryBlock(data + start, length, b, a, true, useProgMem)) break;
+        }
+        if (j == MPU9250_DMP_LOAD_RETRIES) return false; // uh oh.
+        badBanks &= ~((uint32)1 << (b - bank));
     }
+    return true;
+}
+boolean MPU9250::writeProgMemoryImage(const uint8 *data, uint16 dataSize, uint8 bank, uint8 address) {
+    return writeMemoryImage(data, dataSize, bank, address, true);
+}
+boolean MPU9250::writeDMPConfigurationSet(const uint8 *data, uint16 dataSize, boolean useProgMem) {
+    uint8 success, special;
+    uint16 i;
 
     // config set data is a long string of blocks with the following structure:
     // [bank] [offset] [length] [byte[0], byte[1], ..., byte[length]]
@@ -3084,13 +3504,8 @@ boolean MPU9250::writeDMPConfigurationSet(const uint8 *data, uint16 dataSize, bo
             Serial.print(offset);
             Serial.print(", length=");
             Serial.println(length);*/
-            if (useProgMem) {
-                if (sizeof(progBuffer) < length) progBuffer = (uint8 *)realloc(progBuffer, length);
-                for (j = 0; j < length; j++) progBuffer[j] = (*( const unsigned char*)(data + i + j));
-            } else {
-                progBuffer = (uint8 *)data + i;
-            }
-            success = writeMemoryBlock(progBuffer, length, bank, offset, true);
+            // writeMemoryBlock() copies program memory chunk by chunk itself
+            success = writeMemoryBlock(data + i, length, bank, offset, true, useProgMem);
             i += length;
         } else {
             // special instruction
@@ -3112,7 +3527,7 @@ boolean MPU9250::writeDMPConfigurationSet(const uint8 *data, uint16 dataSize, bo
                 //setIntZeroMotionEnabled(true);
                 //setIntFIFOBufferOverflowEnabled(true);
                 //setIntDMPEnabled(true);
-                I2Cdev::writeByte(devAddr, MPU9250_RA_INT_ENABLE, 0x32);  // single operation
+                writeRegByte(MPU9250_RA_INT_ENABLE, 0x32);  // single operation
 
                 success = true;
             } else {
@@ -3121,12 +3536,8 @@ boolean MPU9250::writeDMPConfigurationSet(const uint8 *data, uint16 dataSize, bo
             }
         }
         
-        if (!success) {
-            if (useProgMem) free(progBuffer);
-            return false; // uh oh
-        }
+        if (!success) return false; // uh oh
     }
-    if (useProgMem) free(progBuffer);
     return true;
 }
 boolean MPU9250::writeProgDMPConfigurationSet(const uint8 *data, uint16 dataSize) {
@@ -3154,322 +3565,436 @@ void MPU9250::setDMPConfig2(uint8 config) {
 }
 
 #ifdef MPU9250_INCLUDE_DMP_MOTIONAPPS41
-  uint8 MPU9250::dmpInitialize() {
-    // reset device
-    DEBUG_PRINTLN("\n\nResetting MPU9250...");
-    reset();
-    delay(30); // wait after reset
-
-    // disable sleep mode
-    DEBUG_PRINTLN("Disabling sleep mode...");
-    setSleepEnabled(false);
-
-    // get MPU product ID
-    DEBUG_PRINTLN("Getting product ID...");
-    uint8 productID =  getDeviceID();
-    DEBUG_PRINT("Product ID = ");
-    DEBUG_PRINTLN(productID);
-
-    // get MPU hardware revision
-    DEBUG_PRINTLN("Selecting user bank 16...");
-    setMemoryBank(0x10, true, true);
-    DEBUG_PRINTLN("Selecting memory byte 6...");
-    setMemoryStartAddress(0x06);
-    DEBUG_PRINTLN("Checking hardware revision...");
-    uint8 hwRevision = readMemoryByte();
-    DEBUG_PRINT("Revision @ user[16][6] = ");
-    DEBUG_PRINTLNF(hwRevision, HEX);
-    DEBUG_PRINTLN("Resetting memory bank selection to 0...");
+  /** Value a DMP memory byte has after dmpInitialize().
+   * That is dmpMemory[] with the dmpConfig[] blocks and the dmpUpdates[]
+   * writes laid over it in load order.
+   * @param address DMP memory address (bank * 256 + offset)
+   * @return Expected byte
+   */
+  static uint8 dmpImageByte(uint16 address) {
+    uint8 value = (*( const unsigned char*)(&dmpMemory[address]));
+    uint16 i, start;
+    uint8 length, n;
+    for (i = 0; i < MPU9250_DMP_CONFIG_SIZE;) {
+        start = ((*( const unsigned char*)(&dmpConfig[i])) << 8) | (*( const unsigned char*)(&dmpConfig[i + 1]));
+        length = (*( const unsigned char*)(&dmpConfig[i + 2]));
+        i += 3;
+        if (length == 0) {
+            i++; // special instruction
+            continue;
+        }
+        if (address >= start && address < start + length) value = (*( const unsigned char*)(&dmpConfig[i + address - start]));
+        i += length;
+    }
+    for (i = 0, n = 0; i < MPU9250_DMP_UPDATES_SIZE; n++) {
+        start = ((*( const unsigned char*)(&dmpUpdates[i])) << 8) | (*( const unsigned char*)(&dmpUpdates[i + 1]));
+        length = (*( const unsigned char*)(&dmpUpdates[i + 2]));
+        i += 3;
+        // update 12/19 is a read
+        if (n != 11 && address >= start && address < start + length) value = (*( const unsigned char*)(&dmpUpdates[i + address - start]));
+        i += length;
+    }
+    return value;
+  }
+
+  /** Compare a stretch of DMP memory with the image dmpInitialize() leaves.
+   * @param address DMP memory address (bank * 256 + offset)
+   * @param length Number of bytes, up to MPU9250_DMP_PROBE_SIZE
+   * @return True if every byte matches
+   */
+  boolean MPU9250::dmpMemoryMatches(uint16 address, uint8 length) {
+    uint8 probe[MPU9250_DMP_PROBE_SIZE];
+    readMemoryBlock(probe, length, address >> 8, address & 0xFF);
+    for (uint8 k = 0; k < length; k++) {
+        if (probe[k] != dmpImageByte(address + k)) return false;
+    }
+    return true;
+  }
+
+  /** Check whether the DMP firmware and configuration are still loaded.
+   * DMP memory only loses its contents on power loss, so after an MCU reset
+   * (brownout, watchdog, new sketch upload) the device usually still holds
+   * what the last dmpInitialize() wrote. This probes the DMP start address
+   * registers, the magnetometer read slave and, in DMP memory, the first
+   * MPU9250_DMP_PROBE_SIZE bytes of every code bank plus every dmpConfig[]
+   * block that patches code. Banks below MPU9250_DMP_CODE_START are skipped:
+   * they are data RAM that a running DMP changes, and the warm start rewrites
+   * the configuration blocks there anyway.
+   * @return True if everything matches the compiled-in image
+   * @see dmpInitialize()
+   */
+  boolean MPU9250::dmpFirmwareResident() {
+    if (getDMPConfig1() != (MPU9250_DMP_CODE_START >> 8) || getDMPConfig2() != (MPU9250_DMP_CODE_START & 0xFF)) return false;
+    I2Cdev::readByte(devAddr, MPU9250_RA_I2C_SLV0_ADDR, buffer);
+    if (buffer[0] != 0x8E) return false;
+
+    boolean match = true;
+    uint16 address, i;
+    uint8 length;
+    for (address = MPU9250_DMP_CODE_START; match && address < MPU9250_DMP_CODE_SIZE; address += MPU9250_DMP_MEMORY_BANK_SIZE) {
+        length = min(MPU9250_DMP_CODE_SIZE - address, MPU9250_DMP_PROBE_SIZE);
+        match = dmpMemoryMatches(address, length);
+    }
+    for (i = 0; match && i < MPU9250_DMP_CONFIG_SIZE;) {
+        address = ((*( const unsigned char*)(&dmpConfig[i])) << 8) | (*( const unsigned char*)(&dmpConfig[i + 1]));
+        length = (*( const unsigned char*)(&dmpConfig[i + 2]));
+        i += 3 + (length ? length : 1);
+        if (length > 0 && address >= MPU9250_DMP_CODE_START) match = dmpMemoryMatches(address, length);
+    }
     setMemoryBank(0, false, false);
-
-    // check OTP bank valid
-    DEBUG_PRINTLN("Reading OTP bank valid flag...");
-    uint8 otpValid = getOTPBankValid();
-    DEBUG_PRINT("OTP bank is ");
-//	DEBUG_PRINTLN(otpValid);
-    DEBUG_PRINTLN(otpValid ? "valid!" : "invalid!");
-
-    // get X/Y/Z gyro offsets
-    DEBUG_PRINTLN("Reading gyro offset values...");
-    int8 xgOffset = getXGyroOffset();
-    int8 ygOffset = getYGyroOffset();
-    int8 zgOffset = getZGyroOffset();
-    DEBUG_PRINT("X gyro offset = ");
-    DEBUG_PRINTLN(xgOffset);
-    DEBUG_PRINT("Y gyro offset = ");
-    DEBUG_PRINTLN(ygOffset);
-    DEBUG_PRINT("Z gyro offset = ");
-    DEBUG_PRINTLN(zgOffset);
-    
-    I2Cdev::readByte(devAddr, MPU9250_RA_USER_CTRL, buffer); // ?
-    
-    DEBUG_PRINTLN("Enabling interrupt latch, clear on any read, AUX bypass enabled");
-    I2Cdev::writeByte(devAddr, MPU9250_RA_INT_PIN_CFG, 0x32);
-
-    // enable MPU AUX I2C bypass mode
-    //DEBUG_PRINTLN("Enabling AUX I2C bypass mode...");
-    //setI2CBypassEnabled(true);
-
-    DEBUG_PRINTLN("Setting magnetometer mode to power-down...");
-    //mag -> setMode(0);
-    I2Cdev::writeByte(0x0E, 0x0A, 0x00);
-
-    DEBUG_PRINTLN("Setting magnetometer mode to fuse access...");
-    //mag -> setMode(0x0F);
-    I2Cdev::writeByte(0x0E, 0x0A, 0x0F);
-
-    DEBUG_PRINTLN("Reading mag magnetometer factory calibration...");
-    int8 asax, asay, asaz;
-    //mag -> getAdjustment(&asax, &asay, &asaz);
-    I2Cdev::readBytes(0x0E, 0x10, 3, buffer);
-    asax = (int8)buffer[0];
-    asay = (int8)buffer[1];
-    asaz = (int8)buffer[2];
-    DEBUG_PRINT("Adjustment X/Y/Z = ");
-    DEBUG_PRINT(asax);
-    DEBUG_PRINT(" / ");
-    DEBUG_PRINT(asay);
-    DEBUG_PRINT(" / ");
-    DEBUG_PRINTLN(asaz);
-
-    DEBUG_PRINTLN("Setting magnetometer mode to power-down...");
-    //mag -> setMode(0);
-    I2Cdev::writeByte(0x0E, 0x0A, 0x00);
-
-    // load DMP code into memory banks
-    DEBUG_PRINT("Writing DMP code to MPU memory banks (");
-    DEBUG_PRINT(MPU9250_DMP_CODE_SIZE);
-    DEBUG_PRINTLN(" bytes)");
-    if (writeProgMemoryBlock(dmpMemory, MPU9250_DMP_CODE_SIZE)) {
-        DEBUG_PRINTLN("Success! DMP code written and verified.");
-
-        DEBUG_PRINTLN("Configuring DMP and related settings...");
-
-        // write DMP configuration
-        DEBUG_PRINT("Writing DMP configuration to MPU memory banks (");
-        DEBUG_PRINT(MPU9250_DMP_CONFIG_SIZE);
-        DEBUG_PRINTLN(" bytes in config def)");
-        if (writeProgDMPConfigurationSet(dmpConfig, MPU9250_DMP_CONFIG_SIZE)) {
-            DEBUG_PRINTLN("Success! DMP configuration written and verified.");
-
-            DEBUG_PRINTLN("Setting DMP and FIFO_OFLOW interrupts enabled...");
-            setIntEnabled(0x12);
-
-            DEBUG_PRINTLN("Setting sample rate to 200Hz...");
-            setRate(4); // 1khz / (1 + 4) = 200 Hz
-
-            DEBUG_PRINTLN("Setting clock source to Z Gyro...");
-            setClockSource(MPU9250_CLOCK_PLL_ZGYRO);
-
-            DEBUG_PRINTLN("Setting DLPF bandwidth to 42Hz...");
-            setDLPFMode(MPU9250_DLPF_BW_42);
-
-            DEBUG_PRINTLN("Setting external frame sync to TEMP_OUT_L[0]...");
-            setExternalFrameSync(MPU9250_EXT_SYNC_TEMP_OUT_L);
-
-            DEBUG_PRINTLN("Setting gyro sensitivity to +/- 2000 deg/sec...");
-            setFullScaleGyroRange(MPU9250_GYRO_FS_2000);
-
-            DEBUG_PRINTLN("Setting DMP configuration bytes (function unknown)...");
-            setDMPConfig1(0x03);
-            setDMPConfig2(0x00);
-
-            DEBUG_PRINTLN("Clearing OTP Bank flag...");
-            setOTPBankValid(false);
-
-            DEBUG_PRINTLN("Setting X/Y/Z gyro offsets to previous values...");
-            setXGyroOffset(xgOffset);
-            setYGyroOffset(ygOffset);
-            setZGyroOffset(zgOffset);
-
-            DEBUG_PRINTLN("Setting X/Y/Z gyro user offsets to zero...");
-            setXGyroOffsetUser(0);
-            setYGyroOffsetUser(0);
-            setZGyroOffsetUser(0);
-
-            DEBUG_PRINTLN("Writing final memory update 1/19 (function unknown)...");
-            uint8 dmpUpdate[16], j;
-            uint16 pos = 0;
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-
-            DEBUG_PRINTLN("Writing final memory update 2/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-
-            DEBUG_PRINTLN("Resetting FIFO...");
-            resetFIFO();
-
-            DEBUG_PRINTLN("Reading FIFO count...");
-            uint8 fifoCount = getFIFOCount();
-
-            DEBUG_PRINT("Current FIFO count=");
-            DEBUG_PRINTLN(fifoCount);
-            uint8 fifoBuffer[128];
-            //getFIFOBytes(fifoBuffer, fifoCount);
-
-            DEBUG_PRINTLN("Writing final memory update 3/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-
-            DEBUG_PRINTLN("Writing final memory update 4/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-
-            DEBUG_PRINTLN("Disabling all standby flags...");
-            I2Cdev::writeByte(0x68, MPU9250_RA_PWR_MGMT_2, 0x00);
-
-            DEBUG_PRINTLN("Setting accelerometer sensitivity to +/- 2g...");
-            I2Cdev::writeByte(0x68, MPU9250_RA_ACCEL_CONFIG, 0x00);
-
-            DEBUG_PRINTLN("Setting motion detection threshold to 2...");
-            setMotionDetectionThreshold(2);
-
-            DEBUG_PRINTLN("Setting zero-motion detection threshold to 156...");
-            setZeroMotionDetectionThreshold(156);
-
-            DEBUG_PRINTLN("Setting motion detection duration to 80...");
-            setMotionDetectionDuration(80);
-
-            DEBUG_PRINTLN("Setting zero-motion detection duration to 0...");
-            setZeroMotionDetectionDuration(0);
-
-            DEBUG_PRINTLN("Setting AK8975 to single measurement mode...");
-            //mag -> setMode(1);
-            I2Cdev::writeByte(0x0E, 0x0A, 0x01);
-
-            // setup AK8975 (0x0E) as Slave 0 in read mode
-            DEBUG_PRINTLN("Setting up AK8975 read slave 0...");
-            I2Cdev::writeByte(0x68, MPU9250_RA_I2C_SLV0_ADDR, 0x8E);
-            I2Cdev::writeByte(0x68, MPU9250_RA_I2C_SLV0_REG,  0x01);
-            I2Cdev::writeByte(0x68, MPU9250_RA_I2C_SLV0_CTRL, 0xDA);
-
-            // setup AK8975 (0x0E) as Slave 2 in write mode
-            DEBUG_PRINTLN("Setting up AK8975 write slave 2...");
-            I2Cdev::writeByte(0x68, MPU9250_RA_I2C_SLV2_ADDR, 0x0E);
-            I2Cdev::writeByte(0x68, MPU9250_RA_I2C_SLV2_REG,  0x0A);
-            I2Cdev::writeByte(0x68, MPU9250_RA_I2C_SLV2_CTRL, 0x81);
-            I2Cdev::writeByte(0x68, MPU9250_RA_I2C_SLV2_DO,   0x01);
-
-            // setup I2C timing/delay control
-            DEBUG_PRINTLN("Setting up slave access delay...");
-            I2Cdev::writeByte(0x68, MPU9250_RA_I2C_SLV4_CTRL, 0x18);
-            I2Cdev::writeByte(0x68, MPU9250_RA_I2C_MST_DELAY_CTRL, 0x05);
-
-            // enable interrupts
-            DEBUG_PRINTLN("Enabling default interrupt behavior/no bypass...");
-            I2Cdev::writeByte(0x68, MPU9250_RA_INT_PIN_CFG, 0x00);
-
-            // enable I2C master mode and reset DMP/FIFO
-            DEBUG_PRINTLN("Enabling I2C master mode...");
-            I2Cdev::writeByte(0x68, MPU9250_RA_USER_CTRL, 0x20);
-            DEBUG_PRINTLN("Resetting FIFO...");
-            I2Cdev::writeByte(0x68, MPU9250_RA_USER_CTRL, 0x24);
-            DEBUG_PRINTLN("Rewriting I2C master mode enabled because...I don't know");
-            I2Cdev::writeByte(0x68, MPU9250_RA_USER_CTRL, 0x20);
-            DEBUG_PRINTLN("Enabling and resetting DMP/FIFO...");
-            I2Cdev::writeByte(0x68, MPU9250_RA_USER_CTRL, 0xE8);
-
-            DEBUG_PRINTLN("Writing final memory update 5/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-            DEBUG_PRINTLN("Writing final memory update 6/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-            DEBUG_PRINTLN("Writing final memory update 7/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-            DEBUG_PRINTLN("Writing final memory update 8/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-            DEBUG_PRINTLN("Writing final memory update 9/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-            DEBUG_PRINTLN("Writing final memory update 10/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-            DEBUG_PRINTLN("Writing final memory update 11/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-            
-            DEBUG_PRINTLN("Reading final memory update 12/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            readMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-            #ifdef DEBUG
-                DEBUG_PRINT("Read bytes: ");
-                for (j = 0; j < 4; j++) {
-                    DEBUG_PRINTF(dmpUpdate[3 + j], HEX);
-                    DEBUG_PRINT(" ");
+    return match;
+  }
+
+  // dmpInitialize() sequence, as observed from InvenSense's own driver. Most of
+  // it (in particular the dmpUpdates[] blocks and the FIFO reads between them)
+  // is undocumented; the order is what matters.
+  #define DMP_RESET()                 { MPU9250_DMP_STEP_RESET, 0, 0, 0 }
+  #define DMP_DELAY(ms)               { MPU9250_DMP_STEP_DELAY, 0, 0, ms }
+  #define DMP_WRITE(reg, v)           { MPU9250_DMP_STEP_WRITE, reg, 0, v }
+  #define DMP_BITS(reg, bit, len, v)  { MPU9250_DMP_STEP_WRITE_BITS, reg, (bit << 4) | len, v }
+  #define DMP_WORD(reg, v)            { MPU9250_DMP_STEP_WRITE_WORD, reg, 0, v }
+  #define DMP_READ(reg)               { MPU9250_DMP_STEP_READ, reg, 0, 0 }
+  #define DMP_MAG(reg, v)             { MPU9250_DMP_STEP_MAG_WRITE, reg, 0, v }
+  #define DMP_STEP(op)                { op, 0, 0, 0 }
+  #define DMP_WAIT_FIFO(n)            { MPU9250_DMP_STEP_WAIT_FIFO, 0, 0, n }
+  static const MPU9250DMPStep dmpInitSteps[] = {
+    DMP_RESET(),
+    DMP_DELAY(30),
+    DMP_BITS(MPU9250_RA_PWR_MGMT_1, MPU9250_PWR1_SLEEP_BIT, 1, 0),
+    DMP_WRITE(MPU9250_RA_INT_PIN_CFG, 0x32),            // latch, clear on any read, bypass
+    DMP_MAG(0x0A, 0x00),                                // magnetometer power-down
+
+    DMP_STEP(MPU9250_DMP_STEP_LOAD_CODE),
+    DMP_STEP(MPU9250_DMP_STEP_VERIFY_CODE),
+    DMP_STEP(MPU9250_DMP_STEP_LOAD_CONFIG),
+
+    DMP_WRITE(MPU9250_RA_INT_ENABLE, 0x12),             // DMP and FIFO_OFLOW interrupts
+    DMP_WRITE(MPU9250_RA_SMPLRT_DIV, 4),                // 1khz / (1 + 4) = 200 Hz
+    DMP_BITS(MPU9250_RA_PWR_MGMT_1, MPU9250_PWR1_CLKSEL_BIT, MPU9250_PWR1_CLKSEL_LENGTH, MPU9250_CLOCK_PLL_ZGYRO),
+    DMP_BITS(MPU9250_RA_CONFIG, MPU9250_CFG_DLPF_CFG_BIT, MPU9250_CFG_DLPF_CFG_LENGTH, MPU9250_DLPF_BW_42),
+    DMP_BITS(MPU9250_RA_CONFIG, MPU9250_CFG_EXT_SYNC_SET_BIT, MPU9250_CFG_EXT_SYNC_SET_LENGTH, MPU9250_EXT_SYNC_TEMP_OUT_L),
+    DMP_BITS(MPU9250_RA_GYRO_CONFIG, MPU9250_GCONFIG_FS_SEL_BIT, MPU9250_GCONFIG_FS_SEL_LENGTH, MPU9250_GYRO_FS_2000),
+    DMP_WRITE(MPU9250_RA_DMP_CFG_1, MPU9250_DMP_CODE_START >> 8),
+    DMP_WRITE(MPU9250_RA_DMP_CFG_2, MPU9250_DMP_CODE_START & 0xFF),
+    DMP_BITS(MPU9250_RA_XG_OFFS_TC, MPU9250_TC_OTP_BNK_VLD_BIT, 1, 0),
+    DMP_WORD(MPU9250_RA_XG_OFFS_USRH, 0),
+    DMP_WORD(MPU9250_RA_YG_OFFS_USRH, 0),
+    DMP_WORD(MPU9250_RA_ZG_OFFS_USRH, 0),
+
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),                  // 1/19
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),
+    DMP_BITS(MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_FIFO_RESET_BIT, 1, 1),
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),                  // 4/19
+
+    DMP_WRITE(MPU9250_RA_PWR_MGMT_2, 0x00),             // no standby
+    DMP_WRITE(MPU9250_RA_ACCEL_CONFIG, 0x00),           // +/- 2g
+    DMP_WRITE(MPU9250_RA_MOT_THR, 2),
+    DMP_WRITE(MPU9250_RA_ZRMOT_THR, 156),
+    DMP_WRITE(MPU9250_RA_MOT_DUR, 80),
+    DMP_WRITE(MPU9250_RA_ZRMOT_DUR, 0),
+    DMP_MAG(0x0A, 0x01),                                // magnetometer single measurement
+    DMP_WRITE(MPU9250_RA_I2C_SLV0_ADDR, 0x8E),          // slave 0 reads the magnetometer
+    DMP_WRITE(MPU9250_RA_I2C_SLV0_REG, 0x01),
+    DMP_WRITE(MPU9250_RA_I2C_SLV0_CTRL, 0xDA),
+    DMP_WRITE(MPU9250_RA_I2C_SLV2_ADDR, 0x0E),          // slave 2 re-triggers it
+    DMP_WRITE(MPU9250_RA_I2C_SLV2_REG, 0x0A),
+    DMP_WRITE(MPU9250_RA_I2C_SLV2_CTRL, 0x81),
+    DMP_WRITE(MPU9250_RA_I2C_SLV2_DO, 0x01),
+    DMP_WRITE(MPU9250_RA_I2C_SLV4_CTRL, 0x18),          // slave access delay
+    DMP_WRITE(MPU9250_RA_I2C_MST_DELAY_CTRL, 0x05),
+    DMP_WRITE(MPU9250_RA_INT_PIN_CFG, 0x00),            // default interrupts, no bypass
+    DMP_WRITE(MPU9250_RA_USER_CTRL, 0x20),              // I2C master
+    DMP_WRITE(MPU9250_RA_USER_CTRL, 0x24),              // reset FIFO
+    DMP_WRITE(MPU9250_RA_USER_CTRL, 0x20),
+    DMP_WRITE(MPU9250_RA_USER_CTRL, 0xE8),              // enable and reset DMP/FIFO
+
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),                  // 5/19
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),                  // 11/19
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE_READ),             // 12/19
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),                  // 17/19
+
+    DMP_WAIT_FIFO(46),
+    DMP_STEP(MPU9250_DMP_STEP_READ_FIFO),
+    DMP_READ(MPU9250_RA_INT_STATUS),
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),                  // 18/19
+    DMP_WAIT_FIFO(48),
+    DMP_STEP(MPU9250_DMP_STEP_READ_FIFO),
+    DMP_READ(MPU9250_RA_INT_STATUS),
+    DMP_WAIT_FIFO(48),
+    DMP_STEP(MPU9250_DMP_STEP_READ_FIFO),
+    DMP_READ(MPU9250_RA_INT_STATUS),
+    DMP_STEP(MPU9250_DMP_STEP_UPDATE),                  // 19/19
+
+    DMP_BITS(MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_DMP_EN_BIT, 1, 0), // you turn it on later
+    DMP_BITS(MPU9250_RA_USER_CTRL, MPU9250_USERCTRL_FIFO_RESET_BIT, 1, 1),
+    DMP_READ(MPU9250_RA_INT_STATUS)
+  };
+  #undef DMP_RESET
+  #undef DMP_DELAY
+  #undef DMP_WRITE
+  #undef DMP_BITS
+  #undef DMP_WORD
+  #undef DMP_READ
+  #undef DMP_MAG
+  #undef DMP_STEP
+  #undef DMP_WAIT_FIFO
+
+  // warm start on a device that still holds the firmware: set back what
+  // initialize() or the application may have changed (registers and the
+  // configuration in DMP data RAM), reset DMP and FIFO
+  static const MPU9250DMPStep dmpWarmSteps[] = {
+    { MPU9250_DMP_STEP_WRITE_BITS, MPU9250_RA_PWR_MGMT_1, (MPU9250_PWR1_SLEEP_BIT << 4) | 1, 0 },
+    { MPU9250_DMP_STEP_WRITE, MPU9250_RA_INT_ENABLE, 0, 0x12 },
+    { MPU9250_DMP_STEP_WRITE, MPU9250_RA_SMPLRT_DIV, 0, 4 },
+    { MPU9250_DMP_STEP_WRITE_BITS, MPU9250_RA_PWR_MGMT_1, (MPU9250_PWR1_CLKSEL_BIT << 4) | MPU9250_PWR1_CLKSEL_LENGTH, MPU9250_CLOCK_PLL_ZGYRO },
+    { MPU9250_DMP_STEP_WRITE_BITS, MPU9250_RA_CONFIG, (MPU9250_CFG_DLPF_CFG_BIT << 4) | MPU9250_CFG_DLPF_CFG_LENGTH, MPU9250_DLPF_BW_42 },
+    { MPU9250_DMP_STEP_WRITE_BITS, MPU9250_RA_CONFIG, (MPU9250_CFG_EXT_SYNC_SET_BIT << 4) | MPU9250_CFG_EXT_SYNC_SET_LENGTH, MPU9250_EXT_SYNC_TEMP_OUT_L },
+    { MPU9250_DMP_STEP_WRITE_BITS, MPU9250_RA_GYRO_CONFIG, (MPU9250_GCONFIG_FS_SEL_BIT << 4) | MPU9250_GCONFIG_FS_SEL_LENGTH, MPU9250_GYRO_FS_2000 },
+    { MPU9250_DMP_STEP_WRITE_BITS, MPU9250_RA_ACCEL_CONFIG, (MPU9250_ACONFIG_AFS_SEL_BIT << 4) | MPU9250_ACONFIG_AFS_SEL_LENGTH, MPU9250_ACCEL_FS_2 },
+    { MPU9250_DMP_STEP_WRITE, MPU9250_RA_PWR_MGMT_2, 0, 0x00 },
+    { MPU9250_DMP_STEP_WRITE, MPU9250_RA_INT_PIN_CFG, 0, 0x00 },
+    { MPU9250_DMP_STEP_WRITE_BITS, MPU9250_RA_USER_CTRL, (MPU9250_USERCTRL_DMP_EN_BIT << 4) | 1, 0 },
+    { MPU9250_DMP_STEP_LOAD_DATA, 0, 0, 0 },
+    { MPU9250_DMP_STEP_WRITE_BITS, MPU9250_RA_USER_CTRL, (MPU9250_USERCTRL_DMP_RESET_BIT << 4) | 1, 1 },
+    { MPU9250_DMP_STEP_WRITE_BITS, MPU9250_RA_USER_CTRL, (MPU9250_USERCTRL_FIFO_RESET_BIT << 4) | 1, 1 },
+    { MPU9250_DMP_STEP_READ, MPU9250_RA_INT_STATUS, 0, 0 }
+  };
+
+  /** Run (or poll) the current step of the init sequence.
+   * @return MPU9250_DMP_INIT_BUSY while steps remain, MPU9250_DMP_INIT_OK at
+   * the end, or an MPU9250_DMP_INIT_* error code
+   * @see dmpInitStep()
+   */
+  uint8 MPU9250::dmpInitRunStep() {
+    if (dmpInitIndex >= dmpInitLength) return MPU9250_DMP_INIT_OK;
+    const MPU9250DMPStep *step = &dmpInitTable[dmpInitIndex];
+    uint8 header[3];
+    uint8 block[BUFFER_LENGTH];
+    uint16 k, length, address;
+    boolean ok;
+    switch (step->op) {
+        case MPU9250_DMP_STEP_RESET:
+            reset();
+            break;
+        case MPU9250_DMP_STEP_DELAY:
+            if (millis() - dmpInitStepStart < step->value) {
+                dmpInitWaiting = true;
+                return MPU9250_DMP_INIT_BUSY;
+            }
+            break;
+        case MPU9250_DMP_STEP_WRITE:
+            writeRegByte(step->reg, step->value);
+            break;
+        case MPU9250_DMP_STEP_WRITE_BITS:
+            writeRegBits(step->reg, step->field >> 4, step->field & 0x0F, step->value);
+            break;
+        case MPU9250_DMP_STEP_WRITE_WORD:
+            I2Cdev::writeWord(devAddr, step->reg, step->value);
+            break;
+        case MPU9250_DMP_STEP_READ:
+            I2Cdev::readByte(devAddr, step->reg, buffer);
+            break;
+        case MPU9250_DMP_STEP_MAG_WRITE:
+            I2Cdev::writeByte(MPU9250_DMP_MAG_ADDRESS, step->reg, step->value);
+            break;
+        case MPU9250_DMP_STEP_LOAD_CODE:
+            // one MEM_R_W burst per call, within a bank; no readback here
+            address = dmpInitOffset;
+            length = min(MPU9250_DMP_CODE_SIZE - address, MPU9250_DMP_MEMORY_BANK_SIZE - (address & 0xFF));
+            length = min(length, MPU9250_DMP_MEMORY_BURST_SIZE);
+            for (k = 0; k < length; k++) block[k] = (*( const unsigned char*)(&dmpMemory[address + k]));
+            setMemoryBank(address >> 8);
+            setMemoryStartAddress(address & 0xFF);
+            I2Cdev::writeBytes(devAddr, MPU9250_RA_MEM_R_W, length, block);
+            dmpInitOffset += length;
+            if (dmpInitOffset < MPU9250_DMP_CODE_SIZE) return MPU9250_DMP_INIT_BUSY;
+            dmpInitOffset = 0;
+            break;
+        case MPU9250_DMP_STEP_VERIFY_CODE:
+            // one MEM_R_W read per call; a bank that differs is rewritten
+            // chunk by chunk with writeMemoryBlock()'s verify (one long call,
+            // only after a bus error)
+            address = dmpInitOffset;
+            length = min(MPU9250_DMP_CODE_SIZE - address, MPU9250_DMP_MEMORY_BANK_SIZE - (address & 0xFF));
+            length = min(length, BUFFER_LENGTH);
+            setMemoryBank(address >> 8);
+            setMemoryStartAddress(address & 0xFF);
+            ok = I2Cdev::readBytes(devAddr, MPU9250_RA_MEM_R_W, length, block) == length;
+            for (k = 0; ok && k < length; k++) ok = block[k] == (*( const unsigned char*)(&dmpMemory[address + k]));
+            dmpInitOffset += length;
+            if (!ok) {
+                address &= 0xFF00;
+                length = min(MPU9250_DMP_CODE_SIZE - address, MPU9250_DMP_MEMORY_BANK_SIZE);
+                for (k = 0; k < MPU9250_DMP_LOAD_RETRIES; k++) {
+                    if (writeMemoryBlock(dmpMemory + address, length, address >> 8, 0, true, true)) break;
+                }
+                if (k == MPU9250_DMP_LOAD_RETRIES) {
+                    DEBUG_PRINTLN("ERROR! DMP code verification failed.");
+                    return MPU9250_DMP_INIT_CODE_FAILED;
                 }
-                DEBUG_PRINTLN("");
-            #endif
-
-            DEBUG_PRINTLN("Writing final memory update 13/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-            DEBUG_PRINTLN("Writing final memory update 14/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-            DEBUG_PRINTLN("Writing final memory update 15/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-            DEBUG_PRINTLN("Writing final memory update 16/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-            DEBUG_PRINTLN("Writing final memory update 17/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-
-            DEBUG_PRINTLN("Waiting for FIRO count >= 46...");
-            while ((fifoCount = getFIFOCount()) < 46);
-            DEBUG_PRINTLN("Reading FIFO...");
-            getFIFOBytes(fifoBuffer, min(fifoCount, 128)); // safeguard only 128 bytes
-            DEBUG_PRINTLN("Reading interrupt status...");
-            getIntStatus();
-
-            DEBUG_PRINTLN("Writing final memory update 18/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-
-            DEBUG_PRINTLN("Waiting for FIRO count >= 48...");
-            while ((fifoCount = getFIFOCount()) < 48);
-            DEBUG_PRINTLN("Reading FIFO...");
-            getFIFOBytes(fifoBuffer, min(fifoCount, 128)); // safeguard only 128 bytes
-            DEBUG_PRINTLN("Reading interrupt status...");
-            getIntStatus();
-            DEBUG_PRINTLN("Waiting for FIRO count >= 48...");
-            while ((fifoCount = getFIFOCount()) < 48);
-            DEBUG_PRINTLN("Reading FIFO...");
-            getFIFOBytes(fifoBuffer, min(fifoCount, 128)); // safeguard only 128 bytes
-            DEBUG_PRINTLN("Reading interrupt status...");
-            getIntStatus();
-
-            DEBUG_PRINTLN("Writing final memory update 19/19 (function unknown)...");
-            for (j = 0; j < 4 || j < dmpUpdate[2] + 3; j++, pos++) dmpUpdate[j] = (*( const unsigned char*)(&dmpUpdates[pos]));
-            writeMemoryBlock(dmpUpdate + 3, dmpUpdate[2], dmpUpdate[0], dmpUpdate[1]);
-
-            DEBUG_PRINTLN("Disabling DMP (you turn it on later)...");
-            setDMPEnabled(false);
-
-            DEBUG_PRINTLN("Setting up internal 48-byte (default) DMP packet buffer...");
-            dmpPacketSize = 48;
-            /*if ((dmpPacketBuffer = (uint8 *)malloc(42)) == 0) {
-                return 3; // TODO: proper error code for no memory
-            }*/
-
-            DEBUG_PRINTLN("Resetting FIFO and clearing INT status one last time...");
-            resetFIFO();
-            getIntStatus();
-           // DEBUG_PRINTLN(getIntStatus());
+                dmpInitOffset = address + length; // whole bank verified
+            }
+            if (dmpInitOffset < MPU9250_DMP_CODE_SIZE) return MPU9250_DMP_INIT_BUSY;
+            dmpInitOffset = 0;
+            break;
+        case MPU9250_DMP_STEP_LOAD_CONFIG:
+            // one block (or special instruction) per call
+            length = (*( const unsigned char*)(&dmpConfig[dmpInitOffset + 2]));
+            length = 3 + (length ? length : 1);
+            if (!writeProgDMPConfigurationSet(dmpConfig + dmpInitOffset, length)) {
+                DEBUG_PRINTLN("ERROR! DMP configuration verification failed.");
+                return MPU9250_DMP_INIT_CONFIG_FAILED;
+            }
+            dmpInitOffset += length;
+            if (dmpInitOffset < MPU9250_DMP_CONFIG_SIZE) return MPU9250_DMP_INIT_BUSY;
+            dmpInitOffset = 0;
+            break;
+        case MPU9250_DMP_STEP_UPDATE:
+        case MPU9250_DMP_STEP_UPDATE_READ:
+            for (k = 0; k < 3; k++) header[k] = (*( const unsigned char*)(&dmpUpdates[dmpInitUpdate + k]));
+            for (k = 0; k < header[2]; k++) block[k] = (*( const unsigned char*)(&dmpUpdates[dmpInitUpdate + 3 + k]));
+            dmpInitUpdate += 3 + header[2];
+            if (step->op == MPU9250_DMP_STEP_UPDATE) writeMemoryBlock(block, header[2], header[0], header[1]);
+            else readMemoryBlock(block, header[2], header[0], header[1]);
+            break;
+        case MPU9250_DMP_STEP_WAIT_FIFO:
+            dmpInitFIFOCount = getFIFOCount();
+            if (dmpInitFIFOCount < step->value) {
+                if (millis() - dmpInitStepStart < MPU9250_DMP_FIFO_TIMEOUT) {
+                    dmpInitWaiting = true;
+                    return MPU9250_DMP_INIT_BUSY;
+                }
+                DEBUG_PRINTLN("ERROR! Timed out waiting for DMP FIFO data.");
+                return MPU9250_DMP_INIT_FIFO_TIMEOUT;
+            }
+            break;
+        case MPU9250_DMP_STEP_READ_FIFO:
+            // safeguard only 128 bytes
+            for (k = min(dmpInitFIFOCount, 128); k > 0; k -= min(k, sizeof(block))) getFIFOBytes(block, min(k, sizeof(block)));
+            break;
+        case MPU9250_DMP_STEP_LOAD_DATA:
+            // one dmpConfig[] block, then one dmpUpdates[] block, per call;
+            // only those in data RAM (code is checked by dmpFirmwareResident()),
+            // with the value the full load leaves there
+            if (dmpInitOffset < MPU9250_DMP_CONFIG_SIZE) {
+                for (k = 0; k < 3; k++) header[k] = (*( const unsigned char*)(&dmpConfig[dmpInitOffset + k]));
+                dmpInitOffset += 3 + (header[2] ? header[2] : 1);
+            } else {
+                for (k = 0; k < 3; k++) header[k] = (*( const unsigned char*)(&dmpUpdates[dmpInitUpdate + k]));
+                dmpInitUpdate += 3 + header[2];
+            }
+            address = (header[0] << 8) | header[1];
+            if (header[2] > 0 && address < MPU9250_DMP_CODE_START) {
+                for (k = 0; k < header[2]; k++) block[k] = dmpImageByte(address + k);
+                if (!writeMemoryBlock(block, header[2], header[0], header[1])) {
+                    DEBUG_PRINTLN("ERROR! DMP configuration verification failed.");
+                    return MPU9250_DMP_INIT_CONFIG_FAILED;
+                }
+            }
+            if (dmpInitUpdate < MPU9250_DMP_UPDATES_SIZE) return MPU9250_DMP_INIT_BUSY;
+            dmpInitOffset = 0;
+            dmpInitUpdate = 0;
+            break;
+    }
+    dmpInitIndex++;
+    dmpInitStepStart = millis();
+    if (dmpInitIndex < dmpInitLength) return MPU9250_DMP_INIT_BUSY;
+    dmpPacketSize = 48;
+    return MPU9250_DMP_INIT_OK;
+  }
+
+  /** Start loading and configuring the DMP without blocking.
+   * Call dmpInitStep() repeatedly (e.g. once per loop()) until it returns
+   * something other than MPU9250_DMP_INIT_BUSY. dmpInitialize() does the same
+   * in one blocking call.
+   * @param warmStart False to always reset the device and reload everything
+   * @see dmpInitStep()
+   * @see dmpInitialize()
+   */
+  void MPU9250::dmpInitBegin(boolean warmStart) {
+    dmpInitTable = warmStart ? 0 : dmpInitSteps; // 0: probe on the first step
+    dmpInitLength = warmStart ? 0 : sizeof(dmpInitSteps) / sizeof(dmpInitSteps[0]);
+    dmpInitIndex = 0;
+    dmpInitUpdate = 0;
+    dmpInitOffset = 0;
+    dmpInitStepStart = millis();
+    dmpInitStatus = MPU9250_DMP_INIT_BUSY;
+    dmpInitWaiting = false;
+  }
+
+  /** Advance the DMP init sequence started by dmpInitBegin().
+   * Each call does one bus operation: a register access, one MEM_R_W burst
+   * of firmware (written, then read back in a separate pass) or one
+   * configuration block with its readback (under 2 ms at 400 kHz). Only the
+   * warm start probe on the first call and the rewrite of a firmware bank
+   * that failed to read back take longer. Delays and FIFO waits return at once while they are
+   * pending, and a FIFO wait fails after MPU9250_DMP_FIFO_TIMEOUT.
+   * @return MPU9250_DMP_INIT_BUSY while in progress, then MPU9250_DMP_INIT_OK
+   * or an error code (the same on every later call)
+   * @see dmpInitProgress()
+   */
+  uint8 MPU9250::dmpInitStep() {
+    if (dmpInitStatus != MPU9250_DMP_INIT_BUSY) return dmpInitStatus;
+    dmpInitWaiting = false;
+    if (dmpInitTable == 0) {
+        DEBUG_PRINTLN("\n\nProbing for resident DMP firmware...");
+        if (dmpFirmwareResident()) {
+            DEBUG_PRINTLN("DMP firmware resident, skipping reload.");
+            dmpInitTable = dmpWarmSteps;
+            dmpInitLength = sizeof(dmpWarmSteps) / sizeof(dmpWarmSteps[0]);
         } else {
-            DEBUG_PRINTLN("ERROR! DMP configuration verification failed.");
-            return 2; // configuration block loading failed
+            DEBUG_PRINTLN("Loading DMP...");
+            dmpInitTable = dmpInitSteps;
+            dmpInitLength = sizeof(dmpInitSteps) / sizeof(dmpInitSteps[0]);
         }
-    } else {
-        DEBUG_PRINTLN("ERROR! DMP code verification failed.");
-        return 1; // main binary block loading failed
+        dmpInitStepStart = millis();
+        return MPU9250_DMP_INIT_BUSY;
+    }
+    dmpInitStatus = dmpInitRunStep();
+    return dmpInitStatus;
+  }
+
+  /** Get how far the DMP init sequence has come.
+   * @return 0 to 100 [%], 100 only once dmpInitStep() has returned MPU9250_DMP_INIT_OK
+   */
+  uint8 MPU9250::dmpInitProgress() {
+    if (dmpInitStatus == MPU9250_DMP_INIT_OK) return 100;
+    if (dmpInitLength == 0) return 0;
+    return (uint16)dmpInitIndex * 99 / dmpInitLength;
+  }
+
+  /** Load and configure the DMP (MotionApps 4.1).
+   * With warmStart, a device that still holds the firmware (see
+   * dmpFirmwareResident()) is not reset or reloaded: only the registers and
+   * the dmpConfig[]/dmpUpdates[] blocks in DMP data RAM that initialize() or
+   * the application may have changed are set back, and the DMP, FIFO and
+   * interrupt status are reset, leaving the same state as a full load in
+   * tens of milliseconds instead of several hundred. The rest of data RAM is the
+   * DMP's own working state and is left alone.
+   * The full load runs the dmpInitSteps[] table; its FIFO waits give up after
+   * MPU9250_DMP_FIFO_TIMEOUT instead of hanging when the DMP produces no data.
+   * This blocks until done; see dmpInitBegin() to run it from a loop instead.
+   * @param warmStart False to always reset the device and reload everything
+   * @return 0 on success, 1 if the firmware load failed, 2 if the configuration
+   * failed, 3 if the DMP never filled the FIFO (MPU9250_DMP_INIT_*)
+   */
+  uint8 MPU9250::dmpInitialize(boolean warmStart) {
+    dmpInitBegin(warmStart);
+    uint8 status;
+    while ((status = dmpInitStep()) == MPU9250_DMP_INIT_BUSY) {
+        if (dmpInitWaiting) delay(1); // don't flood the bus
     }
-    return 0; // success
+    return status;
 }
 
 boolean MPU9250::dmpPacketAvailable() {
@@ -3570,8 +4095,8 @@ uint8 MPU9250::dmpGetLinearAccel(VectorInt16 *v, VectorInt16 *vRaw, VectorFloat
 uint8 MPU9250::dmpGetLinearAccelInWorld(VectorInt16 *v, VectorInt16 *vReal, Quaternion *q) {
     // rotate measured 3D acceleration vector into original state
     // frame of reference based on orientation quaternion
-    memcpy(v, vReal, sizeof(VectorInt16));
-    v -> rotate(q);
+    // (unit quaternion, so the 15-multiply Quat::rotate() form is exact)
+    *v = vReal -> getRotated(q);
     return 0;
 }
 
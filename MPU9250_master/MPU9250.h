@@ -64,12 +64,23 @@ THE SOFTWARE.
 
 //Magnetometer Registers
 #define MPU9150_RA_MAG_ADDRESS		0x0C
+#define MPU9150_RA_MAG_ST1		0x02
 #define MPU9150_RA_MAG_XOUT_L		0x03
 #define MPU9150_RA_MAG_XOUT_H		0x04
 #define MPU9150_RA_MAG_YOUT_L		0x05
 #define MPU9150_RA_MAG_YOUT_H		0x06
 #define MPU9150_RA_MAG_ZOUT_L		0x07
 #define MPU9150_RA_MAG_ZOUT_H		0x08
+#define MPU9150_RA_MAG_ST2		0x09
+#define MPU9150_RA_MAG_CNTL		0x0A
+
+#define MPU9250_MAG_MODE_POWER_DOWN	0x00 // AK8963 power-down, required between any two other modes
+#define MPU9250_MAG_MODE_SINGLE	0x01 // AK8963 single measurement, back to power-down when done
+#define MPU9250_MAG_MODE_CONT2_16BIT	0x16 // AK8963 continuous measurement mode 2 (100 Hz), 16-bit output
+#define MPU9250_MAG_MODE_DELAY	100  // [us] after power-down before the next mode (AK8963 datasheet)
+#define MPU9250_MAG_FETCH_LENGTH	8    // ST1, HXL..HZH, ST2
+#define MPU9250_MAG_STATUS_DRDY	0x01 // ST1 DRDY: new measurement since the last read
+#define MPU9250_MAG_STATUS_HOFL	0x08 // ST2 HOFL: magnetic sensor overflow, data invalid
 
 #define MPU9250_ADDRESS_AD0_LOW     0x68 // address pin low (GND), default for InvenSense evaluation board
 #define MPU9250_ADDRESS_AD0_HIGH    0x69 // address pin high (VCC)
@@ -424,7 +435,44 @@ THE SOFTWARE.
 #define MPU9250_DMP_MEMORY_BANKS        8
 #define MPU9250_DMP_MEMORY_BANK_SIZE    256
 #define MPU9250_DMP_MEMORY_CHUNK_SIZE   16
+#define MPU9250_DMP_MEMORY_BURST_SIZE   (BUFFER_LENGTH - 1)    // MEM_R_W address + data in one Wire buffer
+#define MPU9250_DMP_LOAD_RETRIES        3
+#define MPU9250_DMP_CODE_START          0x0300  // DMP_CFG_1/DMP_CFG_2, banks below are DMP data RAM
+#define MPU9250_DMP_PROBE_SIZE          16
+#define MPU9250_DMP_FIFO_TIMEOUT        500     // [ms] per FIFO wait in the init sequence
+#define MPU9250_DMP_MAG_ADDRESS         0x0E    // magnetometer address used by the init sequence
+
+// dmpInitialize() step operations, see MPU9250DMPStep
+#define MPU9250_DMP_STEP_RESET          0   // reset()
+#define MPU9250_DMP_STEP_DELAY          1   // wait value ms
+#define MPU9250_DMP_STEP_WRITE          2   // write value to reg
+#define MPU9250_DMP_STEP_WRITE_BITS     3   // write value to bits (field >> 4 = start, field & 0x0F = length) of reg
+#define MPU9250_DMP_STEP_WRITE_WORD     4   // write 16-bit value to reg, reg + 1
+#define MPU9250_DMP_STEP_READ           5   // read reg and discard (INT_STATUS clears on read)
+#define MPU9250_DMP_STEP_MAG_WRITE      6   // write value to reg of MPU9250_DMP_MAG_ADDRESS
+#define MPU9250_DMP_STEP_LOAD_CODE      7   // dmpMemory[] into DMP memory, one MEM_R_W burst per call
+#define MPU9250_DMP_STEP_LOAD_CONFIG    8   // dmpConfig[] into DMP memory
+#define MPU9250_DMP_STEP_UPDATE         9   // write the next dmpUpdates[] block
+#define MPU9250_DMP_STEP_UPDATE_READ    10  // read the next dmpUpdates[] block (skips it)
+#define MPU9250_DMP_STEP_WAIT_FIFO      11  // wait for value FIFO bytes, MPU9250_DMP_FIFO_TIMEOUT
+#define MPU9250_DMP_STEP_READ_FIFO      12  // drain the bytes the last wait saw (up to 128)
+#define MPU9250_DMP_STEP_LOAD_DATA      13  // dmpConfig[]/dmpUpdates[] blocks below MPU9250_DMP_CODE_START (warm start)
+#define MPU9250_DMP_STEP_VERIFY_CODE    14  // read dmpMemory[] back, one MEM_R_W read per call; rewrite a bank that differs
+
+#define MPU9250_DMP_INIT_OK             0
+#define MPU9250_DMP_INIT_CODE_FAILED    1
+#define MPU9250_DMP_INIT_CONFIG_FAILED  2
+#define MPU9250_DMP_INIT_FIFO_TIMEOUT   3
+#define MPU9250_DMP_INIT_BUSY           0xFF
+
+struct MPU9250DMPStep {
+    uint8 op;
+    uint8 reg;
+    uint8 field;
+    uint16 value;
+};
 
+#define MPU9250_SHADOW_SIZE             21  // configuration registers in the shadow (at most 32, one bit each)
 
 // note: DMP code memory blocks defined at end of header file
 
@@ -436,6 +484,9 @@ class MPU9250 {
         void initialize();
         boolean testConnection();
 
+        void beginConfig();
+        boolean commitConfig();
+
         // AUX_VDDIO register
         uint8 getAuxVDDIOLevel();
         void setAuxVDDIOLevel(uint8 level);
@@ -606,7 +657,10 @@ class MPU9250 {
         boolean getIntDataReadyStatus();
 
         // ACCEL_*OUT_* registers
-        void getMotion9(int16* ax, int16* ay, int16* az, int16* gx, int16* gy, int16* gz, int16* mx, int16* my, int16* mz);
+        boolean setMagAutoFetchEnabled(boolean enabled);
+        boolean getMagAutoFetchEnabled();
+        boolean getMotion9(int16* ax, int16* ay, int16* az, int16* gx, int16* gy, int16* gz, int16* mx, int16* my, int16* mz);
+        uint8 getMagStatus();
         void getMotion6(int16* ax, int16* ay, int16* az, int16* gx, int16* gy, int16* gz);
         void getAcceleration(int16* x, int16* y, int16* z);
         int16 getAccelerationX();
@@ -670,6 +724,7 @@ class MPU9250 {
 
         // PWR_MGMT_1 register
         void reset();
+        void invalidateShadow();
         boolean getSleepEnabled();
         void setSleepEnabled(boolean enabled);
         boolean getWakeCycleEnabled();
@@ -702,6 +757,8 @@ class MPU9250 {
         uint8 getFIFOByte();
         void setFIFOByte(uint8 data);
         void getFIFOBytes(uint8 *data, uint8 length);
+        int16 getFIFOBurst(uint8 *data, uint16 length);
+        boolean getFIFOBurstAsync(uint8 *data, uint16 length, I2CdevCallback callback=0, void *context=0);
 
         // WHO_AM_I register
         uint8 getDeviceID();
@@ -794,6 +851,8 @@ class MPU9250 {
         void readMemoryBlock(uint8 *data, uint16 dataSize, uint8 bank=0, uint8 address=0);
         boolean writeMemoryBlock(const uint8 *data, uint16 dataSize, uint8 bank=0, uint8 address=0, boolean verify=true, boolean useProgMem=false);
         boolean writeProgMemoryBlock(const uint8 *data, uint16 dataSize, uint8 bank=0, uint8 address=0, boolean verify=true);
+        boolean writeMemoryImage(const uint8 *data, uint16 dataSize, uint8 bank=0, uint8 address=0, boolean useProgMem=false);
+        boolean writeProgMemoryImage(const uint8 *data, uint16 dataSize, uint8 bank=0, uint8 address=0);
 
         boolean writeDMPConfigurationSet(const uint8 *data, uint16 dataSize, boolean useProgMem=false);
         boolean writeProgDMPConfigurationSet(const uint8 *data, uint16 dataSize);
@@ -811,7 +870,11 @@ class MPU9250 {
             uint8 *dmpPacketBuffer;
             uint16 dmpPacketSize;
 
-            uint8 dmpInitialize();
+            uint8 dmpInitialize(boolean warmStart=true);
+            void dmpInitBegin(boolean warmStart=true);
+            uint8 dmpInitStep();
+            uint8 dmpInitProgress();
+            boolean dmpFirmwareResident();
             boolean dmpPacketAvailable();
 
             uint8 dmpSetFIFORate(uint8 fifoRate);
@@ -910,7 +973,34 @@ class MPU9250 {
 
     private:
         uint8 devAddr;
-        uint8 buffer[14];
+        uint8 buffer[24];
+        boolean magAutoFetch;   // I2C_SLV0 copies AK8963 ST1..ST2 to EXT_SENS_DATA_00..07
+        uint8 magStatus;        // ST1 DRDY and ST2 HOFL seen by the last getMotion9()
+        uint8 shadow[MPU9250_SHADOW_SIZE];  // last value written to each shadowed register
+        uint32 shadowValid;     // one bit per shadow[] slot, set when it is current
+        uint32 shadowDirty;     // one bit per shadow[] slot written since beginConfig()
+        boolean configuring;
+
+        boolean readShadow(uint8 regAddr, uint8 *data);
+        boolean setMagMode(uint8 mode);
+        boolean writeRegBit(uint8 regAddr, uint8 bitNum, uint8 data);
+        boolean writeRegBits(uint8 regAddr, uint8 bitStart, uint8 length, uint8 data);
+        boolean writeRegByte(uint8 regAddr, uint8 data);
+
+        #ifdef MPU9250_INCLUDE_DMP_MOTIONAPPS41
+            boolean dmpMemoryMatches(uint16 address, uint8 length);
+            uint8 dmpInitRunStep();
+
+            const MPU9250DMPStep *dmpInitTable;   // 0 until the warm start probe has run
+            uint8 dmpInitLength;
+            uint8 dmpInitIndex;         // current step of the init sequence
+            uint8 dmpInitStatus;        // MPU9250_DMP_INIT_*
+            boolean dmpInitWaiting;     // last step is waiting (delay or FIFO)
+            uint16 dmpInitUpdate;       // read position in dmpUpdates[]
+            uint16 dmpInitOffset;       // position in dmpMemory[]/dmpConfig[] while loading
+            uint32 dmpInitStepStart;    // millis() when the current step began
+            uint16 dmpInitFIFOCount;    // FIFO count seen by the last wait
+        #endif
 };
 
 #ifdef MPU9250_INCLUDE_DMP_MOTIONAPPS41
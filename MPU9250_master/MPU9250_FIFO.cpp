@@ -0,0 +1,484 @@
+// I2Cdev library collection - MPU9250 FIFO stream reader
+// See MPU9250_FIFO.h for the frame layout and a usage example.
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2012 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#include "MPU9250_FIFO.h"
+#include <string.h>
+
+/** Create a reader on top of an MPU9250 and a caller-owned ring buffer.
+ * @param mpu Device to read from (must outlive the reader)
+ * @param ring Storage for frames (must outlive the reader)
+ * @param size Size of ring in bytes; only a whole number of frames is used
+ */
+MPU9250FIFOReader::MPU9250FIFOReader(MPU9250 *mpu, uint8 *ring, uint16 size) {
+    this->mpu = mpu;
+    this->ring = ring;
+    this->size = size;
+    capacity = 0;
+    sources = 0;
+    frameSize = 0;
+    validator = 0;
+    validatorContext = 0;
+    framePeriod = 0;
+    learnPeriod = true;
+    pending = false;
+    overflows = 0;
+    resyncs = 0;
+    dropped = 0;
+    reset();
+}
+
+/** Route the selected sensors into the FIFO and start streaming.
+ * Slave data lengths are taken from the current I2C_SLVx_CTRL settings, so
+ * configure the slaves first. The frame period is derived from SMPLRT_DIV
+ * and DLPF_CFG. The FIFO and the ring are emptied.
+ * @param sources Any combination of the MPU9250_FIFO_* source flags
+ * @return True if the frame fits in the ring and the FIFO was set up
+ */
+boolean MPU9250FIFOReader::begin(uint16 sources) {
+    uint8 frame = 0;
+    if (sources & MPU9250_FIFO_ACCEL) frame += 6;
+    if (sources & MPU9250_FIFO_TEMP) frame += 2;
+    if (sources & MPU9250_FIFO_XGYRO) frame += 2;
+    if (sources & MPU9250_FIFO_YGYRO) frame += 2;
+    if (sources & MPU9250_FIFO_ZGYRO) frame += 2;
+    if (sources & MPU9250_FIFO_SLV0) frame += mpu->getSlaveDataLength(0);
+    if (sources & MPU9250_FIFO_SLV1) frame += mpu->getSlaveDataLength(1);
+    if (sources & MPU9250_FIFO_SLV2) frame += mpu->getSlaveDataLength(2);
+    if (sources & MPU9250_FIFO_SLV3) frame += mpu->getSlaveDataLength(3);
+    if (frame == 0 || frame > size || pending) return false;
+
+    this->sources = sources;
+    frameSize = frame;
+    capacity = size - size % frameSize;
+
+    // internal sample rate is 8 kHz with the DLPF off, 1 kHz otherwise
+    uint8 dlpf = mpu->getDLPFMode();
+    uint32 base = (dlpf == 0 || dlpf == 7) ? 125 : 1000;
+    setFramePeriod(base * (1 + mpu->getRate()));
+
+    mpu->beginConfig();
+    mpu->setTempFIFOEnabled(sources & MPU9250_FIFO_TEMP);
+    mpu->setXGyroFIFOEnabled(sources & MPU9250_FIFO_XGYRO);
+    mpu->setYGyroFIFOEnabled(sources & MPU9250_FIFO_YGYRO);
+    mpu->setZGyroFIFOEnabled(sources & MPU9250_FIFO_ZGYRO);
+    mpu->setAccelFIFOEnabled(sources & MPU9250_FIFO_ACCEL);
+    mpu->setSlave0FIFOEnabled(sources & MPU9250_FIFO_SLV0);
+    mpu->setSlave1FIFOEnabled(sources & MPU9250_FIFO_SLV1);
+    mpu->setSlave2FIFOEnabled(sources & MPU9250_FIFO_SLV2);
+    mpu->setSlave3FIFOEnabled(sources & MPU9250_FIFO_SLV3);
+    mpu->setFIFOEnabled(true);
+    if (!mpu->commitConfig()) return false;
+    mpu->resetFIFO();
+
+    reset();
+    return true;
+}
+
+/** Stream fixed-size frames from a FIFO that is configured elsewhere.
+ * Use this for DMP packets after dmpInitialize(); the FIFO itself is left
+ * alone and the first drain() aligns to it.
+ * @param frameSize Bytes per frame (e.g. dmpGetFIFOPacketSize())
+ * @param framePeriod Microseconds per frame, or 0 to estimate it from the
+ *        observed data rate
+ * @return True if the frame fits in the ring
+ */
+boolean MPU9250FIFOReader::beginPackets(uint8 frameSize, uint32 framePeriod) {
+    if (frameSize == 0 || frameSize > size || pending) return false;
+    sources = 0;
+    this->frameSize = frameSize;
+    capacity = size - size % frameSize;
+    setFramePeriod(framePeriod);
+    reset();
+    return true;
+}
+
+/** Stop routing sensors into the FIFO and disable it.
+ * Does nothing to the FIFO for a reader started with beginPackets().
+ */
+void MPU9250FIFOReader::end() {
+    if (sources != 0) {
+        mpu->beginConfig();
+        mpu->setTempFIFOEnabled(false);
+        mpu->setXGyroFIFOEnabled(false);
+        mpu->setYGyroFIFOEnabled(false);
+        mpu->setZGyroFIFOEnabled(false);
+        mpu->setAccelFIFOEnabled(false);
+        mpu->setSlave0FIFOEnabled(false);
+        mpu->setSlave1FIFOEnabled(false);
+        mpu->setSlave2FIFOEnabled(false);
+        mpu->setSlave3FIFOEnabled(false);
+        mpu->setFIFOEnabled(false);
+        mpu->commitConfig();
+    }
+    sources = 0;
+    frameSize = 0;
+}
+
+/** Set a check that every frame must pass before it is handed out.
+ * @param validator Frame check, or 0 to accept every aligned frame
+ * @param context Passed through to the validator
+ * @see isDMPPacket()
+ */
+void MPU9250FIFOReader::setValidator(MPU9250FrameValidator validator, void *context) {
+    this->validator = validator;
+    validatorContext = context;
+}
+
+/** Set the time between frames, used to estimate samples lost to an overflow.
+ * @param framePeriod Microseconds per frame, or 0 to estimate it from the
+ *        observed data rate
+ */
+void MPU9250FIFOReader::setFramePeriod(uint32 framePeriod) {
+    this->framePeriod = framePeriod;
+    learnPeriod = framePeriod == 0;
+}
+
+/** Get the time between frames.
+ * @return Microseconds per frame (0 while still unknown)
+ */
+uint32 MPU9250FIFOReader::getFramePeriod() {
+    return framePeriod;
+}
+
+/** Get the sources passed to begin().
+ * @return MPU9250_FIFO_* source flags (0 after beginPackets())
+ */
+uint16 MPU9250FIFOReader::getSources() {
+    return sources;
+}
+
+/** Get the size of one frame.
+ * @return Bytes per frame (0 before begin())
+ */
+uint8 MPU9250FIFOReader::getFrameSize() {
+    return frameSize;
+}
+
+/** Get where a source starts within a frame.
+ * @param source One MPU9250_FIFO_* flag (MPU9250_FIFO_GYRO gives GYRO_XOUT)
+ * @return Byte offset into the frame, or -1 if the source is not streamed
+ */
+int8 MPU9250FIFOReader::getOffset(uint16 source) {
+    // FIFO order, which is register order rather than FIFO_EN bit order
+    static const uint16 order[] = {
+        MPU9250_FIFO_ACCEL, MPU9250_FIFO_TEMP,
+        MPU9250_FIFO_XGYRO, MPU9250_FIFO_YGYRO, MPU9250_FIFO_ZGYRO,
+        MPU9250_FIFO_SLV0, MPU9250_FIFO_SLV1, MPU9250_FIFO_SLV2, MPU9250_FIFO_SLV3
+    };
+    if (source == MPU9250_FIFO_GYRO) source = MPU9250_FIFO_XGYRO;
+    if (!(sources & source)) return -1;
+    int8 offset = 0;
+    for (uint8 i = 0; i < sizeof(order) / sizeof(order[0]) && order[i] != source; i++) {
+        if (!(sources & order[i])) continue;
+        if (i == 0) offset += 6;                            // accel
+        else if (i < 5) offset += 2;                        // temp, gyro axes
+        else offset += mpu->getSlaveDataLength(i - 5);      // slaves 0-3
+    }
+    return offset;
+}
+
+/** Move every complete frame from the FIFO into the ring.
+ * Realigns first if the FIFO does not hold a whole number of frames, then
+ * reads as many whole frames as the free ring space allows as one burst, or
+ * two when the ring wraps.
+ * @return Number of frames added (-1 on bus failure or while an async drain
+ *         is in flight)
+ * @see drainAsync()
+ */
+int16 MPU9250FIFOReader::drain() {
+    if (frameSize == 0 || pending) return -1;
+    uint16 bytes = prepare();
+    if (bytes == 0) return 0;
+    uint16 first = min(bytes, capacity - head);
+    if (mpu->getFIFOBurst(ring + head, first) != (int16)first
+            || (bytes > first && mpu->getFIFOBurst(ring, bytes - first) != (int16)(bytes - first))) {
+        // the next drain realigns on whatever is left of the last frame
+        readFailed = true;
+        lose(bytes / frameSize);
+        return -1;
+    }
+    return commit(bytes);
+}
+
+/** Start moving every complete frame from the FIFO into the ring.
+ * The FIFO count (and any realignment) is read right away; the frame data
+ * is queued on the I2Cdev job queue and arrives while I2Cdev::poll() runs.
+ * New frames become visible to available()/peek() once isDraining() turns
+ * false.
+ * @return True if a drain was started or there was nothing to read
+ * @see drain()
+ */
+boolean MPU9250FIFOReader::drainAsync() {
+    if (frameSize == 0 || pending) return false;
+    uint16 bytes = prepare();
+    if (bytes == 0) return true;
+    uint16 first = min(bytes, capacity - head);
+    pendingBytes = bytes;
+    pendingFailed = false;
+    pendingChunks = bytes > first ? 2 : 1;
+    pending = true;
+    if (!mpu->getFIFOBurstAsync(ring + head, first, onRead, this)) {
+        // nothing has left the FIFO; try again on the next drain
+        pending = false;
+        backlog += bytes / frameSize;
+        return false;
+    }
+    if (bytes > first && !mpu->getFIFOBurstAsync(ring, bytes - first, onRead, this)) {
+        pendingBytes = first;
+        backlog += (bytes - first) / frameSize;
+        onRead(0, this);    // the second chunk will not complete
+    }
+    return true;
+}
+
+/** Check whether an async drain is still in flight.
+ * @return True until the last queued read has completed
+ */
+boolean MPU9250FIFOReader::isDraining() {
+    return pending;
+}
+
+/** Get the number of frames waiting in the ring.
+ * @return Frames available to peek()
+ */
+uint16 MPU9250FIFOReader::available() {
+    return frameSize ? used / frameSize : 0;
+}
+
+/** Look at a frame without removing it.
+ * Frames never straddle the end of the ring, so the pointer covers the
+ * whole frame. It stays valid until the frame is released.
+ * @param index 0 for the oldest frame
+ * @return Pointer to the frame, or 0 if there is no such frame
+ */
+const uint8 *MPU9250FIFOReader::peek(uint16 index) {
+    if (index >= available()) return 0;
+    return ring + (tail + (uint32)index * frameSize) % capacity;
+}
+
+/** Get the sample sequence number of a frame.
+ * Numbers start at 0 and grow by one per sample produced by the chip, so
+ * the difference between two frames tells how many samples apart they
+ * were, including samples that were lost.
+ * @param index 0 for the oldest frame
+ * @return Sequence number
+ */
+uint32 MPU9250FIFOReader::getSequence(uint16 index) {
+    uint32 frame = released + index;
+    uint32 sequence = frame + sequenceBase;
+    for (uint8 i = 0; i < gapCount && gaps[i].frame <= frame; i++) sequence += gaps[i].missing;
+    return sequence;
+}
+
+/** Remove the oldest frames from the ring.
+ * @param frames Number of frames to drop
+ */
+void MPU9250FIFOReader::release(uint16 frames) {
+    if (frames > available()) frames = available();
+    tail = (tail + (uint32)frames * frameSize) % capacity;
+    used -= frames * frameSize;
+    released += frames;
+
+    // fold gaps that are now behind the oldest frame into the base
+    uint8 n = 0;
+    while (n < gapCount && gaps[n].frame <= released) sequenceBase += gaps[n++].missing;
+    if (n > 0) {
+        gapCount -= n;
+        memmove(gaps, gaps + n, gapCount * sizeof(Gap));
+    }
+    if (unplaced > 0 && gapCount < MPU9250_FIFO_MAX_GAPS) {
+        gaps[gapCount].frame = added;
+        gaps[gapCount].missing = unplaced;
+        gapCount++;
+        unplaced = 0;
+    }
+}
+
+/** Get the number of FIFO overflows seen.
+ * @return Overflow count since construction
+ */
+uint32 MPU9250FIFOReader::getOverflowCount() {
+    return overflows;
+}
+
+/** Get the number of times the stream had to be realigned.
+ * @return Resync count since construction
+ */
+uint32 MPU9250FIFOReader::getResyncCount() {
+    return resyncs;
+}
+
+/** Get the number of samples lost to overflows, partial frames, failed
+ * reads and rejected frames. Overflow losses are estimated from the frame
+ * period.
+ * @return Dropped sample count since construction
+ */
+uint32 MPU9250FIFOReader::getDroppedCount() {
+    return dropped;
+}
+
+/** Validator for MotionApps DMP packets.
+ * A packet starts with the orientation quaternion as four big-endian q30
+ * values, whose norm must be close to 1. Bytes from the wrong offset almost
+ * never pass.
+ * @param frame Packet to check
+ * @param context Unused
+ * @return True if the packet looks valid
+ */
+boolean MPU9250FIFOReader::isDMPPacket(const uint8 *frame, void *context) {
+    uint32 norm = 0;
+    for (uint8 i = 0; i < 4; i++) {
+        int32 q = ((int32)frame[i*4] << 24) | ((int32)frame[i*4 + 1] << 16)
+                | ((int32)frame[i*4 + 2] << 8) | frame[i*4 + 3];
+        int32 q13 = q >> 17;    // q30 -> q13, so the sum of squares fits in 32 bits
+        norm += (uint32)(q13 * q13);
+    }
+    // 1.0 is 2^26 in q26; accept 0.875..1.125
+    return norm > (7UL << 23) && norm < (9UL << 23);
+}
+
+// empty the ring and restart sequence numbering
+void MPU9250FIFOReader::reset() {
+    head = 0;
+    tail = 0;
+    used = 0;
+    lastDrain = micros();
+    lastProduced = lastDrain;
+    backlog = 0;
+    readFailed = false;
+    added = 0;
+    released = 0;
+    sequenceBase = 0;
+    gapCount = 0;
+    unplaced = 0;
+}
+
+// read the FIFO count, account for overflows, realign on a frame boundary
+// and work out how many bytes the next read may take
+uint16 MPU9250FIFOReader::prepare() {
+    uint32 now = micros();
+    uint16 count = mpu->getFIFOCount();
+    uint16 frames = count / frameSize;
+    uint32 elapsed = now - lastDrain;
+    lastDrain = now;
+    boolean estimated = false;  // the loss estimate covers the partial frame
+
+    if (count >= MPU9250_FIFO_SIZE) {
+        overflows++;
+        if (framePeriod != 0) {
+            // samples produced since the last drain, less the whole frames
+            // still held; the partial oldest frame is one of them
+            uint32 produced = backlog + (elapsed + framePeriod / 2) / framePeriod;
+            if (produced > frames) lose(produced - frames);
+            estimated = true;
+        }
+        lastProduced = now;
+    } else if (frames > backlog) {
+        if (learnPeriod) {
+            uint32 period = (now - lastProduced) / (frames - backlog);
+            framePeriod = framePeriod == 0 ? period : (framePeriod * 3 + period) / 4;
+        }
+        lastProduced = now;
+    }
+
+    uint16 skip = count % frameSize;
+    if (skip > 0) {
+        // the oldest frame is partial; only whole frames ever get appended
+        uint8 scratch[16];
+        resyncs++;
+        if (!readFailed && !estimated) lose(1);
+        for (uint16 n = skip; n > 0; ) {
+            uint8 chunk = min(n, (uint16)sizeof(scratch));
+            if (mpu->getFIFOBurst(scratch, chunk) != chunk) break;
+            n -= chunk;
+        }
+    }
+    readFailed = false;
+
+    uint16 space = (capacity - used) / frameSize;
+    backlog = frames > space ? frames - space : 0;
+    return (frames - backlog) * frameSize;
+}
+
+// hand out frames just read into [head, head + bytes), dropping any that
+// fail the validator and closing the holes they leave
+uint16 MPU9250FIFOReader::commit(uint16 bytes) {
+    uint16 r = head;
+    uint16 w = head;
+    uint16 kept = 0;
+    for (uint16 i = 0; i < bytes / frameSize; i++) {
+        if (unplaced > 0) {
+            // the loss before this frame has no gap slot yet; numbering it
+            // would be wrong, so drop it too until release() frees a slot
+            lose(1);
+        } else if (validator == 0 || validator(ring + r, validatorContext)) {
+            if (w != r) memcpy(ring + w, ring + r, frameSize);
+            w = (w + frameSize) % capacity;
+            used += frameSize;
+            added++;
+            kept++;
+        } else {
+            lose(1);
+        }
+        r = (r + frameSize) % capacity;
+    }
+    head = w;
+    return kept;
+}
+
+// record samples that will never be handed out, just before the next frame
+void MPU9250FIFOReader::lose(uint32 samples) {
+    dropped += samples;
+    if (gapCount > 0 && gaps[gapCount - 1].frame == added) {
+        gaps[gapCount - 1].missing += samples;
+        return;
+    }
+    if (gapCount == MPU9250_FIFO_MAX_GAPS) {
+        // out of slots: growing an older gap would renumber the frames
+        // after it, so hold the samples (and commit no frames) until
+        // release() frees a slot
+        unplaced += samples;
+        return;
+    }
+    gaps[gapCount].frame = added;
+    gaps[gapCount].missing = samples;
+    gapCount++;
+}
+
+// I2Cdev job completion for drainAsync()
+void MPU9250FIFOReader::onRead(int16 result, void *context) {
+    MPU9250FIFOReader *reader = (MPU9250FIFOReader *)context;
+    if (result < 0) reader->pendingFailed = true;
+    if (--reader->pendingChunks > 0) return;
+    if (reader->pendingFailed) {
+        reader->readFailed = true;
+        reader->lose(reader->pendingBytes / reader->frameSize);
+    } else {
+        reader->commit(reader->pendingBytes);
+    }
+    reader->pending = false;
+}
@@ -0,0 +1,168 @@
+// I2Cdev library collection - MPU9250 FIFO stream reader header file
+// Streams raw (non-DMP) sensor frames out of the MPU9250 FIFO into a ring
+// buffer owned by the caller. Each drain() reads everything the FIFO holds
+// in at most two burst reads (one if the ring does not wrap) and frames are
+// handed out as pointers into the ring, so nothing is copied twice.
+//
+// Frames are laid out in register order: ACCEL_XOUT_H..ACCEL_ZOUT_L (6),
+// TEMP_OUT (2), GYRO_XOUT, GYRO_YOUT, GYRO_ZOUT (2 each), then the
+// EXT_SENS_DATA bytes of I2C slaves 0-3, each present only if enabled.
+// Use getOffset() rather than hard-coding positions. beginPackets() reads
+// fixed-size frames from a FIFO set up elsewhere, e.g. DMP packets.
+//
+// Recovery: the chip only ever appends whole frames, so the newest byte in
+// the FIFO always ends a frame. A byte count that is not a multiple of the
+// frame size therefore means the oldest frame is partial (an interrupted
+// read, or an overflow that overwrote its start), and discarding exactly
+// getFIFOCount() % frameSize bytes puts the stream back on a frame
+// boundary. An optional validator (e.g. isDMPPacket()) rejects frames that
+// still look wrong. Lost samples are counted, estimated from the frame
+// period after an overflow, and skipped in the sequence numbers so that
+// consumers can integrate across the gap. Up to MPU9250_FIFO_MAX_GAPS gaps
+// can sit among frames not yet released; past that, new frames are dropped
+// until release() catches up, so buffered frames are never renumbered.
+//
+// Typical use:
+//
+//     uint8 ring[512];
+//     MPU9250FIFOReader fifo(&mpu, ring, sizeof(ring));
+//     fifo.begin(MPU9250_FIFO_ACCEL | MPU9250_FIFO_GYRO);
+//     ...
+//     fifo.drain();
+//     const uint8 *frame;
+//     while ((frame = fifo.peek()) != 0) {
+//         ... use frame[0..getFrameSize()-1], fifo.getSequence() ...
+//         fifo.release();
+//     }
+//
+// 2026-10-17 - initial release
+//            - frame resync, overflow recovery, sequence numbers, async drain
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2012 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#ifndef _MPU9250_FIFO_H_
+#define _MPU9250_FIFO_H_
+
+#include "MPU9250.h"
+
+#define MPU9250_FIFO_SIZE       512
+#define MPU9250_FIFO_MAX_GAPS   8
+
+// FIFO sources, FIFO_EN bit layout plus I2C_MST_CTRL's SLV_3_FIFO_EN
+#define MPU9250_FIFO_TEMP       (1 << MPU9250_TEMP_FIFO_EN_BIT)
+#define MPU9250_FIFO_XGYRO      (1 << MPU9250_XG_FIFO_EN_BIT)
+#define MPU9250_FIFO_YGYRO      (1 << MPU9250_YG_FIFO_EN_BIT)
+#define MPU9250_FIFO_ZGYRO      (1 << MPU9250_ZG_FIFO_EN_BIT)
+#define MPU9250_FIFO_GYRO       (MPU9250_FIFO_XGYRO | MPU9250_FIFO_YGYRO | MPU9250_FIFO_ZGYRO)
+#define MPU9250_FIFO_ACCEL      (1 << MPU9250_ACCEL_FIFO_EN_BIT)
+#define MPU9250_FIFO_SLV0       (1 << MPU9250_SLV0_FIFO_EN_BIT)
+#define MPU9250_FIFO_SLV1       (1 << MPU9250_SLV1_FIFO_EN_BIT)
+#define MPU9250_FIFO_SLV2       (1 << MPU9250_SLV2_FIFO_EN_BIT)
+#define MPU9250_FIFO_SLV3       0x0100
+
+/** Frame check, returns false for a frame that must be dropped.
+ */
+typedef boolean (*MPU9250FrameValidator)(const uint8 *frame, void *context);
+
+class MPU9250FIFOReader {
+    public:
+        MPU9250FIFOReader(MPU9250 *mpu, uint8 *ring, uint16 size);
+
+        boolean begin(uint16 sources);
+        boolean beginPackets(uint8 frameSize, uint32 framePeriod=0);
+        void end();
+
+        void setValidator(MPU9250FrameValidator validator, void *context=0);
+        void setFramePeriod(uint32 framePeriod);
+        uint32 getFramePeriod();
+
+        uint16 getSources();
+        uint8 getFrameSize();
+        int8 getOffset(uint16 source);
+
+        int16 drain();
+        boolean drainAsync();
+        boolean isDraining();
+        uint16 available();
+        const uint8 *peek(uint16 index=0);
+        uint32 getSequence(uint16 index=0);
+        void release(uint16 frames=1);
+
+        uint32 getOverflowCount();
+        uint32 getResyncCount();
+        uint32 getDroppedCount();
+
+        static boolean isDMPPacket(const uint8 *frame, void *context);
+
+    private:
+        // a run of lost samples just before the given frame
+        struct Gap {
+            uint32 frame;   // number of the first frame after the gap
+            uint32 missing;
+        };
+
+        MPU9250 *mpu;
+        uint8 *ring;
+        uint16 size;
+        uint16 capacity;    // largest multiple of frameSize that fits in size
+        uint16 head;        // next byte to fill
+        uint16 tail;        // first byte of the oldest frame
+        uint16 used;
+        uint16 sources;
+        uint8 frameSize;
+
+        MPU9250FrameValidator validator;
+        void *validatorContext;
+        uint32 framePeriod;     // microseconds per frame, 0 while unknown
+        boolean learnPeriod;    // framePeriod is estimated from the data rate
+        uint32 lastDrain;       // micros() at the previous FIFO count read
+        uint32 lastProduced;    // micros() at the last count read that showed new frames
+        uint16 backlog;         // whole frames left in the FIFO by the previous drain
+        boolean readFailed;     // the previous read may have stopped mid-frame
+
+        uint32 added;           // frames ever committed to the ring
+        uint32 released;        // frames ever released
+        uint32 sequenceBase;    // missing samples before the oldest frame
+        Gap gaps[MPU9250_FIFO_MAX_GAPS];
+        uint8 gapCount;
+        uint32 unplaced;        // samples lost while every gap slot was taken
+
+        volatile boolean pending;
+        volatile uint8 pendingChunks;
+        volatile boolean pendingFailed;
+        uint16 pendingBytes;
+
+        uint32 overflows;
+        uint32 resyncs;
+        uint32 dropped;
+
+        void reset();
+        uint16 prepare();
+        uint16 commit(uint16 bytes);
+        void lose(uint32 samples);
+        static void onRead(int16 result, void *context);
+};
+
+#endif /* _MPU9250_FIFO_H_ */
@@ -0,0 +1,714 @@
+// I2Cdev library collection - MPU9250/AK8963 host simulation models
+// See MPU9250_sim.h for what is and is not modelled.
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2012 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#include "MPU9250_sim.h"
+
+#if I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIM
+
+#include "MPU9250.h"
+
+// AK8963 registers
+#define AK8963_RA_WIA       0x00
+#define AK8963_RA_INFO      0x01
+#define AK8963_RA_ST1       0x02
+#define AK8963_RA_HXL       0x03
+#define AK8963_RA_ST2       0x09
+#define AK8963_RA_CNTL1     0x0A
+#define AK8963_RA_CNTL2     0x0B
+#define AK8963_RA_ASTC      0x0C
+#define AK8963_RA_ASAX      0x10
+
+#define AK8963_ST1_DRDY     0x01
+#define AK8963_ST1_DOR      0x02
+#define AK8963_ST2_HOFL     0x08
+#define AK8963_ST2_BITM     0x10
+
+#define AK8963_MODE_POWERDOWN   0x00
+#define AK8963_MODE_SINGLE      0x01
+#define AK8963_MODE_CONT1       0x02
+#define AK8963_MODE_CONT2       0x06
+#define AK8963_MODE_FUSEROM     0x0F
+
+#define AK8963_SINGLE_NS        7200000ULL  // typical single measurement time
+
+// MPU9250 INT_STATUS / INT_ENABLE bits
+#define MPU9250_SIM_INT_RAW_RDY     0x01
+#define MPU9250_SIM_INT_DMP         0x02
+#define MPU9250_SIM_INT_FIFO_OFLOW  0x10
+
+static int16 clampCount(float value) {
+    if (value > 32767.0f) return 32767;
+    if (value < -32768.0f) return -32768;
+    return (int16)lrintf(value);
+}
+
+static void putWord(uint8 *data, int16 value) {
+    data[0] = (uint8)((uint16)value >> 8);
+    data[1] = (uint8)value;
+}
+
+static void putLong(uint8 *data, int32 value) {
+    data[0] = (uint8)((uint32)value >> 24);
+    data[1] = (uint8)((uint32)value >> 16);
+    data[2] = (uint8)((uint32)value >> 8);
+    data[3] = (uint8)value;
+}
+
+// ============================================================================
+// AK8963Sim
+// ============================================================================
+
+/** Default constructor.
+ * @param address 7-bit bus address (0x0C with CAD1/CAD0 low)
+ */
+AK8963Sim::AK8963Sim(uint8 address) {
+    devAddr = address;
+    reachable = true;
+    field[0] = 20.0f;
+    field[1] = 0.0f;
+    field[2] = -40.0f;
+    regs[AK8963_RA_ASAX] = 0x80;
+    regs[AK8963_RA_ASAX + 1] = 0x80;
+    regs[AK8963_RA_ASAX + 2] = 0x80;
+    now = 0;
+    reset();
+}
+
+/** Soft reset. Fuse ROM values are kept.
+ */
+void AK8963Sim::reset() {
+    uint8 asa[3] = { regs[AK8963_RA_ASAX], regs[AK8963_RA_ASAX + 1], regs[AK8963_RA_ASAX + 2] };
+    memset(regs, 0, sizeof(regs));
+    regs[AK8963_RA_WIA] = 0x48;
+    regs[AK8963_RA_INFO] = 0x9A;
+    memcpy(regs + AK8963_RA_ASAX, asa, 3);
+    regAddr = 0;
+    expectReg = false;
+    locked = false;
+    pending = false;
+    nextSample = 0;
+    modeReady = 0;
+}
+
+/** Set the field seen by the sensor.
+ * @param x,y,z Field in uT along the AK8963 sensor axes
+ */
+void AK8963Sim::setField(float x, float y, float z) {
+    field[0] = x;
+    field[1] = y;
+    field[2] = z;
+}
+
+/** Set the fuse ROM sensitivity adjustment values (ASAX/ASAY/ASAZ).
+ */
+void AK8963Sim::setAdjustment(uint8 x, uint8 y, uint8 z) {
+    regs[AK8963_RA_ASAX] = x;
+    regs[AK8963_RA_ASAX + 1] = y;
+    regs[AK8963_RA_ASAX + 2] = z;
+}
+
+/** Gate visibility on the main bus (driven by MPU9250Sim bypass state).
+ */
+void AK8963Sim::setReachable(boolean reachable) {
+    this->reachable = reachable;
+}
+
+uint8 AK8963Sim::getAddress() {
+    return devAddr;
+}
+
+/** Read one register as the bus (or the MPU9250 I2C master) sees it.
+ * @param regAddr Register to read
+ * @return Register value
+ */
+uint8 AK8963Sim::readRegister(uint8 regAddr) {
+    if (regAddr >= sizeof(regs)) return 0;
+    uint8 mode = regs[AK8963_RA_CNTL1] & 0x0F;
+    if (regAddr >= AK8963_RA_ASAX && mode != AK8963_MODE_FUSEROM) return 0;
+    uint8 value = regs[regAddr];
+    if (regAddr >= AK8963_RA_HXL && regAddr <= AK8963_RA_ST2) {
+        // any data or ST2 read clears DRDY and protects the data until ST2 is read
+        regs[AK8963_RA_ST1] &= ~AK8963_ST1_DRDY;
+        locked = true;
+        if (regAddr == AK8963_RA_ST2) {
+            regs[AK8963_RA_ST1] &= ~AK8963_ST1_DOR;
+            locked = false;
+            if (pending) {
+                pending = false;
+                measure();
+            }
+        }
+    }
+    return value;
+}
+
+/** Write one register as the bus (or the MPU9250 I2C master) sees it.
+ * @param regAddr Register to write
+ * @param data New value
+ * @return True if the device acknowledged the byte
+ */
+boolean AK8963Sim::writeRegister(uint8 regAddr, uint8 data) {
+    switch (regAddr) {
+        case AK8963_RA_CNTL1:
+            setMode(data);
+            break;
+        case AK8963_RA_CNTL2:
+            if (data & 0x01) reset();
+            break;
+        case AK8963_RA_ASTC:
+            regs[regAddr] = data & 0x40;
+            break;
+        default:
+            break; // read-only
+    }
+    return true;
+}
+
+boolean AK8963Sim::acknowledges(uint8 address) {
+    return reachable && address == devAddr;
+}
+
+void AK8963Sim::start(uint8 address, boolean read) {
+    expectReg = !read;
+}
+
+boolean AK8963Sim::write(uint8 address, uint8 data) {
+    if (expectReg) {
+        regAddr = data;
+        expectReg = false;
+        return true;
+    }
+    return writeRegister(regAddr++, data);
+}
+
+uint8 AK8963Sim::read(uint8 address) {
+    return readRegister(regAddr++);
+}
+
+/** Run continuous and single measurements up to the given time.
+ * @param nanos Current virtual time
+ */
+void AK8963Sim::advance(uint64 nanos) {
+    uint8 mode = regs[AK8963_RA_CNTL1] & 0x0F;
+    uint64 period = 0;
+    if (mode == AK8963_MODE_CONT1) period = 125000000ULL;
+    else if (mode == AK8963_MODE_CONT2) period = 10000000ULL;
+
+    while (nextSample != 0 && nextSample <= nanos) {
+        if (locked) {
+            pending = true;
+        } else {
+            measure();
+        }
+        if (mode == AK8963_MODE_SINGLE) {
+            regs[AK8963_RA_CNTL1] &= 0xF0; // back to power-down
+            nextSample = 0;
+        } else if (period != 0) {
+            nextSample += period;
+        } else {
+            nextSample = 0;
+        }
+    }
+    now = nanos;
+}
+
+void AK8963Sim::measure() {
+    if (regs[AK8963_RA_ST1] & AK8963_ST1_DRDY) regs[AK8963_RA_ST1] |= AK8963_ST1_DOR;
+    boolean bits16 = regs[AK8963_RA_CNTL1] & 0x10;
+    float resolution = bits16 ? 0.15f : 0.6f;           // uT/LSB
+    float limit = bits16 ? 32760.0f : 8190.0f;
+    boolean overflow = fabsf(field[0]) + fabsf(field[1]) + fabsf(field[2]) >= 4912.0f;
+    for (uint8 i = 0; i < 3; i++) {
+        // the fuse ROM describes how far off the sensor is; the raw count is
+        // what software divides back out with ((ASA - 128) / 256 + 1)
+        float adjust = ((float)regs[AK8963_RA_ASAX + i] - 128.0f) / 256.0f + 1.0f;
+        float count = field[i] / (resolution * adjust);
+        if (count > limit) count = limit;
+        if (count < -limit) count = -limit;
+        int16 raw = clampCount(count);
+        regs[AK8963_RA_HXL + 2*i] = (uint8)raw;             // little-endian
+        regs[AK8963_RA_HXL + 2*i + 1] = (uint8)((uint16)raw >> 8);
+    }
+    regs[AK8963_RA_ST2] = (bits16 ? AK8963_ST2_BITM : 0) | (overflow ? AK8963_ST2_HOFL : 0);
+    regs[AK8963_RA_ST1] |= AK8963_ST1_DRDY;
+}
+
+void AK8963Sim::setMode(uint8 cntl1) {
+    if ((cntl1 & 0x0F) == AK8963_MODE_POWERDOWN) {
+        modeReady = now + 100000ULL;
+    } else if ((regs[AK8963_RA_CNTL1] & 0x0F) != AK8963_MODE_POWERDOWN || now < modeReady) {
+        return; // not via power-down: undefined on the real part, ignored here
+    }
+    regs[AK8963_RA_CNTL1] = cntl1 & 0x1F;
+    switch (cntl1 & 0x0F) {
+        case AK8963_MODE_SINGLE:
+            nextSample = now + AK8963_SINGLE_NS;
+            break;
+        case AK8963_MODE_CONT1:
+            nextSample = now + 125000000ULL;
+            break;
+        case AK8963_MODE_CONT2:
+            nextSample = now + 10000000ULL;
+            break;
+        default:
+            nextSample = 0;
+            break;
+    }
+}
+
+// ============================================================================
+// MPU9250Sim
+// ============================================================================
+
+/** Default constructor. Starts in the power-on state with the board level
+ * and at rest.
+ * @param address 7-bit bus address (0x68 with AD0 low)
+ * @param intPin Host pin driven by the INT output
+ */
+MPU9250Sim::MPU9250Sim(uint8 address, uint8 intPin) {
+    devAddr = address;
+    this->intPin = intPin;
+    mag = 0;
+    source = 0;
+    sourceContext = 0;
+    intActive = false;
+    memset(&motion, 0, sizeof(motion));
+    motion.accel[2] = 1.0f;
+    motion.mag[0] = 20.0f;
+    motion.mag[2] = -40.0f;
+    motion.quat[0] = 1.0f;
+    motion.temperature = 25.0f;
+    now = 0;
+    reset();
+}
+
+/** Power-on reset: clears registers, FIFO and DMP memory.
+ */
+void MPU9250Sim::reset() {
+    memset(mem, 0, sizeof(mem));
+    deviceReset();
+}
+
+/** Connect the AK8963 behind the auxiliary I2C bus. The magnetometer is only
+ * visible on the main bus while bypass is enabled and the I2C master is off.
+ * @param mag Magnetometer model (not owned)
+ */
+void MPU9250Sim::attachMag(AK8963Sim *mag) {
+    this->mag = mag;
+    updateBypass();
+}
+
+/** Set a constant physical state used while no motion source is installed.
+ */
+void MPU9250Sim::setMotion(const MPU9250SimMotion *motion) {
+    this->motion = *motion;
+}
+
+/** Install a trajectory callback, called once per internal sample.
+ * @param source Callback (0 to go back to the constant state)
+ * @param context Passed through to the callback
+ */
+void MPU9250Sim::setMotionSource(MPU9250SimMotionSource source, void *context) {
+    this->source = source;
+    sourceContext = context;
+}
+
+/** Back-door register read (no side effects).
+ */
+uint8 MPU9250Sim::getRegister(uint8 regAddr) {
+    return regs[regAddr & 0x7F];
+}
+
+/** Back-door register write (no side effects).
+ */
+void MPU9250Sim::setRegister(uint8 regAddr, uint8 data) {
+    regs[regAddr & 0x7F] = data;
+}
+
+/** Back-door DMP memory read.
+ */
+uint8 MPU9250Sim::getMemory(uint8 bank, uint8 address) {
+    if (bank >= MPU9250_SIM_DMP_BANKS) return 0;
+    return mem[bank][address];
+}
+
+uint16 MPU9250Sim::getFIFOCount() {
+    return fifoCount;
+}
+
+/** Get number of internal samples taken since reset.
+ */
+uint32 MPU9250Sim::getSampleCount() {
+    return samples;
+}
+
+/** Get number of bytes dropped from the FIFO since reset.
+ */
+uint32 MPU9250Sim::getOverflowCount() {
+    return overflows;
+}
+
+boolean MPU9250Sim::acknowledges(uint8 address) {
+    return address == devAddr;
+}
+
+void MPU9250Sim::start(uint8 address, boolean read) {
+    expectReg = !read;
+    if (read) readSeen = true;
+}
+
+boolean MPU9250Sim::write(uint8 address, uint8 data) {
+    if (expectReg) {
+        regAddr = data & 0x7F;
+        expectReg = false;
+        return true;
+    }
+    writeRegister(regAddr, data);
+    if (regAddr != MPU9250_RA_MEM_R_W && regAddr != MPU9250_RA_FIFO_R_W) regAddr = (regAddr + 1) & 0x7F;
+    return true;
+}
+
+uint8 MPU9250Sim::read(uint8 address) {
+    uint8 value = readRegister(regAddr);
+    if (regAddr != MPU9250_RA_MEM_R_W && regAddr != MPU9250_RA_FIFO_R_W) regAddr = (regAddr + 1) & 0x7F;
+    return value;
+}
+
+/** Take every sample due up to the given time and update the INT pin.
+ * @param nanos Current virtual time
+ */
+void MPU9250Sim::advance(uint64 nanos) {
+    if (!sampling()) {
+        nextSample = 0;
+    } else if (nextSample == 0) {
+        nextSample = now + samplePeriod();
+    }
+    while (nextSample != 0 && nextSample <= nanos) {
+        uint64 at = nextSample;
+        now = at;
+        if (mag != 0) mag->advance(at);
+        sample(at);
+        nextSample = at + samplePeriod();
+        updateIntPin();
+    }
+    now = nanos;
+    if (mag != 0) mag->advance(nanos);
+    updateIntPin();
+}
+
+void MPU9250Sim::deviceReset() {
+    memset(regs, 0, sizeof(regs));
+    regs[MPU9250_RA_PWR_MGMT_1] = 0x01;
+    regs[MPU9250_RA_WHO_AM_I] = 0x71;
+    fifoHead = 0;
+    fifoCount = 0;
+    fifoCountLatched = false;
+    regAddr = 0;
+    expectReg = false;
+    readSeen = false;
+    nextSample = 0;
+    pulseEnd = 0;
+    samples = 0;
+    overflows = 0;
+    dmpDivider = 0;
+    mstDivider = 0;
+    intActive = false;
+    I2CdevSim::setPin(intPin, LOW);
+    updateBypass();
+}
+
+// internal sample period in nanoseconds
+uint64 MPU9250Sim::samplePeriod() {
+    uint8 dlpf = regs[MPU9250_RA_CONFIG] & 0x07;
+    uint8 fchoice_b = regs[MPU9250_RA_GYRO_CONFIG] & 0x03;
+    if (fchoice_b != 0) return 31250ULL;                // 32 kHz, divider ignored
+    if (dlpf == 0 || dlpf == 7) return 125000ULL;       // 8 kHz, divider ignored
+    return 1000000ULL * (1 + regs[MPU9250_RA_SMPLRT_DIV]);
+}
+
+boolean MPU9250Sim::sampling() {
+    uint8 pwr1 = regs[MPU9250_RA_PWR_MGMT_1];
+    return (pwr1 & 0x40) == 0 && (regs[MPU9250_RA_PWR_MGMT_2] & 0x3F) != 0x3F;
+}
+
+void MPU9250Sim::sample(uint64 at) {
+    if (source != 0) source(at, &motion, sourceContext);
+    if (mag != 0) mag->setField(motion.mag[0], motion.mag[1], motion.mag[2]);
+    samples++;
+
+    uint8 afs = (regs[MPU9250_RA_ACCEL_CONFIG] >> 3) & 0x03;
+    uint8 gfs = (regs[MPU9250_RA_GYRO_CONFIG] >> 3) & 0x03;
+    float accelScale = 16384.0f / (float)(1 << afs);    // LSB/g
+    float gyroScale = 131.0f / (float)(1 << gfs);       // LSB/(deg/s)
+    for (uint8 i = 0; i < 3; i++) {
+        putWord(regs + MPU9250_RA_ACCEL_XOUT_H + 2*i, clampCount(motion.accel[i] * accelScale));
+        putWord(regs + MPU9250_RA_GYRO_XOUT_H + 2*i, clampCount(motion.gyro[i] * gyroScale));
+    }
+    putWord(regs + MPU9250_RA_TEMP_OUT_H, clampCount((motion.temperature - 21.0f) * 333.87f));
+
+    uint8 userCtrl = regs[MPU9250_RA_USER_CTRL];
+    if (userCtrl & 0x20) runMaster();
+
+    if (userCtrl & 0x80) {
+        // DMP runs at the sample rate and emits one packet per (1 + D_0_22)
+        uint16 rateDiv = ((uint16)mem[2][0x16] << 8) | mem[2][0x17];
+        if (dmpDivider == 0) {
+            if (userCtrl & 0x40) pushDMPPacket();
+            raise(MPU9250_SIM_INT_DMP);
+        }
+        dmpDivider = dmpDivider >= rateDiv ? 0 : dmpDivider + 1;
+    } else if (userCtrl & 0x40) {
+        uint8 fifoEn = regs[MPU9250_RA_FIFO_EN];
+        if (fifoEn & 0x08) pushFIFO(regs + MPU9250_RA_ACCEL_XOUT_H, 6);
+        if (fifoEn & 0x80) pushFIFO(regs + MPU9250_RA_TEMP_OUT_H, 2);
+        if (fifoEn & 0x40) pushFIFO(regs + MPU9250_RA_GYRO_XOUT_H, 2);
+        if (fifoEn & 0x20) pushFIFO(regs + MPU9250_RA_GYRO_YOUT_H, 2);
+        if (fifoEn & 0x10) pushFIFO(regs + MPU9250_RA_GYRO_ZOUT_H, 2);
+        uint8 ext = MPU9250_RA_EXT_SENS_DATA_00;
+        for (uint8 slv = 0; slv < 4; slv++) {
+            uint8 ctrl = regs[MPU9250_RA_I2C_SLV0_CTRL + 3*slv];
+            uint8 len = (ctrl & 0x80) && (regs[MPU9250_RA_I2C_SLV0_ADDR + 3*slv] & 0x80) ? (ctrl & 0x0F) : 0;
+            boolean enabled = slv < 3 ? (fifoEn & (0x01 << slv)) : (regs[MPU9250_RA_I2C_MST_CTRL] & 0x20);
+            if (enabled && len > 0) pushFIFO(regs + ext, len);
+            ext += len;
+        }
+    }
+    raise(MPU9250_SIM_INT_RAW_RDY);
+}
+
+// one I2C master round: SLV0-3 then SLV4, at the reduced rate when
+// I2C_MST_DELAY_CTRL asks for it
+void MPU9250Sim::runMaster() {
+    uint8 delayCtrl = regs[MPU9250_RA_I2C_MST_DELAY_CTRL];
+    uint8 mstDelay = regs[MPU9250_RA_I2C_SLV4_CTRL] & 0x1F;
+    boolean reduced = mstDivider != 0;
+    mstDivider = mstDivider >= mstDelay ? 0 : mstDivider + 1;
+
+    uint8 ext = MPU9250_RA_EXT_SENS_DATA_00;
+    for (uint8 slv = 0; slv < 4; slv++) {
+        uint8 addr = regs[MPU9250_RA_I2C_SLV0_ADDR + 3*slv];
+        uint8 reg = regs[MPU9250_RA_I2C_SLV0_REG + 3*slv];
+        uint8 ctrl = regs[MPU9250_RA_I2C_SLV0_CTRL + 3*slv];
+        if (!(ctrl & 0x80)) continue;
+        uint8 len = ctrl & 0x0F;
+        if (addr & 0x80) {
+            if (!(reduced && (delayCtrl & (1 << slv)))) {
+                for (uint8 k = 0; k < len && ext + k <= MPU9250_RA_EXT_SENS_DATA_23; k++) {
+                    boolean present = mag != 0 && (addr & 0x7F) == mag->getAddress();
+                    regs[ext + k] = present ? mag->readRegister(reg + k) : 0;
+                }
+                if (mag == 0 || (addr & 0x7F) != mag->getAddress()) regs[MPU9250_RA_I2C_MST_STATUS] |= (1 << slv);
+            }
+            ext += len;
+        } else if (!(reduced && (delayCtrl & (1 << slv)))) {
+            if (mag != 0 && (addr & 0x7F) == mag->getAddress()) {
+                mag->writeRegister(reg, regs[MPU9250_RA_I2C_SLV0_DO + slv]);
+            } else {
+                regs[MPU9250_RA_I2C_MST_STATUS] |= (1 << slv);
+            }
+        }
+    }
+
+    uint8 slv4Ctrl = regs[MPU9250_RA_I2C_SLV4_CTRL];
+    if (slv4Ctrl & 0x80) {
+        uint8 addr = regs[MPU9250_RA_I2C_SLV4_ADDR];
+        uint8 reg = regs[MPU9250_RA_I2C_SLV4_REG];
+        boolean present = mag != 0 && (addr & 0x7F) == mag->getAddress();
+        if (present) {
+            if (addr & 0x80) regs[MPU9250_RA_I2C_SLV4_DI] = mag->readRegister(reg);
+            else mag->writeRegister(reg, regs[MPU9250_RA_I2C_SLV4_DO]);
+            regs[MPU9250_RA_I2C_MST_STATUS] |= 0x40; // I2C_SLV4_DONE
+        } else {
+            regs[MPU9250_RA_I2C_MST_STATUS] |= 0x50; // I2C_SLV4_DONE | I2C_SLV4_NACK
+        }
+        regs[MPU9250_RA_I2C_SLV4_CTRL] = slv4Ctrl & 0x7F;
+    }
+}
+
+void MPU9250Sim::pushFIFO(const uint8 *data, uint16 length) {
+    boolean fifoMode = regs[MPU9250_RA_CONFIG] & 0x40;
+    for (uint16 k = 0; k < length; k++) {
+        if (fifoCount == MPU9250_SIM_FIFO_SIZE) {
+            overflows++;
+            raise(MPU9250_SIM_INT_FIFO_OFLOW);
+            if (fifoMode) continue;     // FIFO_MODE=1: drop new data
+            fifoHead = (fifoHead + 1) % MPU9250_SIM_FIFO_SIZE;
+            fifoCount--;                // FIFO_MODE=0: replace oldest
+        }
+        fifo[(fifoHead + fifoCount) % MPU9250_SIM_FIFO_SIZE] = data[k];
+        fifoCount++;
+    }
+}
+
+// MotionApps 4.1 packet: quat (4 x Q30), gyro (3 x int32, counts << 16),
+// mag (3 x int16, AK8963 counts), accel (3 x int32, 4096/g << 16), footer
+void MPU9250Sim::pushDMPPacket() {
+    uint8 packet[48];
+    memset(packet, 0, sizeof(packet));
+    float norm = sqrtf(motion.quat[0]*motion.quat[0] + motion.quat[1]*motion.quat[1]
+                     + motion.quat[2]*motion.quat[2] + motion.quat[3]*motion.quat[3]);
+    if (norm == 0.0f) norm = 1.0f;
+    for (uint8 i = 0; i < 4; i++) {
+        putLong(packet + 4*i, (int32)lrint((double)(motion.quat[i] / norm) * 1073741823.0));
+    }
+    for (uint8 i = 0; i < 3; i++) {
+        putLong(packet + 16 + 4*i, (int32)clampCount(motion.gyro[i] * 16.4f) << 16);
+        putLong(packet + 34 + 4*i, (int32)clampCount(motion.accel[i] * 4096.0f) << 16);
+    }
+    if (mag != 0) {
+        for (uint8 i = 0; i < 3; i++) {
+            int16 m = (int16)(((uint16)mag->readRegister(AK8963_RA_HXL + 2*i + 1) << 8) | mag->readRegister(AK8963_RA_HXL + 2*i));
+            putWord(packet + 28 + 2*i, m);
+        }
+        mag->readRegister(AK8963_RA_ST2);
+    }
+    pushFIFO(packet, sizeof(packet));
+}
+
+void MPU9250Sim::raise(uint8 status) {
+    regs[MPU9250_RA_INT_STATUS] |= status;
+    if (status & regs[MPU9250_RA_INT_ENABLE]) {
+        intActive = true;
+        pulseEnd = now + MPU9250_SIM_INT_PULSE_NS;
+    }
+}
+
+void MPU9250Sim::updateIntPin() {
+    uint8 cfg = regs[MPU9250_RA_INT_PIN_CFG];
+    if (intActive) {
+        boolean latched = cfg & 0x20;
+        if (latched) {
+            if ((regs[MPU9250_RA_INT_STATUS] & regs[MPU9250_RA_INT_ENABLE]) == 0) intActive = false;
+        } else if (now >= pulseEnd) {
+            intActive = false;
+        }
+    }
+    boolean activeLow = cfg & 0x80;
+    I2CdevSim::setPin(intPin, intActive != activeLow ? HIGH : LOW);
+}
+
+void MPU9250Sim::updateBypass() {
+    if (mag == 0) return;
+    boolean bypass = (regs[MPU9250_RA_INT_PIN_CFG] & 0x02) && !(regs[MPU9250_RA_USER_CTRL] & 0x20);
+    mag->setReachable(bypass);
+}
+
+uint8 MPU9250Sim::readRegister(uint8 regAddr) {
+    uint8 value;
+    uint8 bank = regs[MPU9250_RA_BANK_SEL] & 0x1F;
+    switch (regAddr) {
+        case MPU9250_RA_INT_STATUS:
+            value = regs[regAddr];
+            regs[regAddr] = 0;
+            break;
+        case MPU9250_RA_FIFO_COUNTH:
+            fifoCountLatch = (uint8)fifoCount;
+            fifoCountLatched = true;
+            value = (uint8)(fifoCount >> 8);
+            break;
+        case MPU9250_RA_FIFO_COUNTL:
+            value = fifoCountLatched ? fifoCountLatch : (uint8)fifoCount;
+            fifoCountLatched = false;
+            break;
+        case MPU9250_RA_FIFO_R_W:
+            if (fifoCount == 0) {
+                value = 0;
+            } else {
+                value = fifo[fifoHead];
+                fifoHead = (fifoHead + 1) % MPU9250_SIM_FIFO_SIZE;
+                fifoCount--;
+            }
+            break;
+        case MPU9250_RA_MEM_R_W:
+            value = bank < MPU9250_SIM_DMP_BANKS ? mem[bank][regs[MPU9250_RA_MEM_START_ADDR]] : 0;
+            regs[MPU9250_RA_MEM_START_ADDR]++;
+            break;
+        default:
+            value = regs[regAddr];
+            break;
+    }
+    if (readSeen && (regs[MPU9250_RA_INT_PIN_CFG] & 0x10)) {
+        // INT_ANYRD_2CLEAR: the first read of any register clears INT_STATUS
+        regs[MPU9250_RA_INT_STATUS] = 0;
+    }
+    readSeen = false;
+    updateIntPin();
+    return value;
+}
+
+void MPU9250Sim::writeRegister(uint8 regAddr, uint8 data) {
+    uint8 bank = regs[MPU9250_RA_BANK_SEL] & 0x1F;
+    boolean wasSampling = sampling();
+    switch (regAddr) {
+        case MPU9250_RA_WHO_AM_I:
+        case MPU9250_RA_INT_STATUS:
+        case MPU9250_RA_FIFO_COUNTH:
+        case MPU9250_RA_FIFO_COUNTL:
+        case MPU9250_RA_I2C_MST_STATUS:
+            break; // read-only
+        case MPU9250_RA_FIFO_R_W:
+            pushFIFO(&data, 1);
+            break;
+        case MPU9250_RA_MEM_R_W:
+            if (bank < MPU9250_SIM_DMP_BANKS) mem[bank][regs[MPU9250_RA_MEM_START_ADDR]] = data;
+            regs[MPU9250_RA_MEM_START_ADDR]++;
+            break;
+        case MPU9250_RA_PWR_MGMT_1:
+            if (data & 0x80) {
+                deviceReset();  // DMP memory survives a device reset
+                return;
+            }
+            regs[regAddr] = data;
+            break;
+        case MPU9250_RA_USER_CTRL:
+            if (data & 0x04) {  // FIFO_RESET
+                fifoHead = 0;
+                fifoCount = 0;
+            }
+            if (data & 0x08) dmpDivider = 0;    // DMP_RESET
+            if (data & 0x02) mstDivider = 0;    // I2C_MST_RESET
+            regs[regAddr] = data & 0xF0;        // reset bits self-clear
+            updateBypass();
+            break;
+        case MPU9250_RA_INT_PIN_CFG:
+            regs[regAddr] = data;
+            updateBypass();
+            break;
+        case MPU9250_RA_SIGNAL_PATH_RESET:
+            break; // self-clearing
+        default:
+            regs[regAddr] = data;
+            break;
+    }
+    if (sampling() != wasSampling || regAddr == MPU9250_RA_SMPLRT_DIV
+            || regAddr == MPU9250_RA_CONFIG || regAddr == MPU9250_RA_GYRO_CONFIG) {
+        nextSample = sampling() ? now + samplePeriod() : 0;
+    }
+    updateIntPin();
+}
+
+#endif // I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIM
@@ -0,0 +1,195 @@
+// I2Cdev library collection - MPU9250/AK8963 host simulation models header file
+// Register-level models of the MPU9250 and its AK8963 magnetometer for use
+// with the I2CDEV_HOST_SIM backend (see I2Cdev_host.h). They let MPU9250.cpp
+// and the sketches run unmodified on a Linux host against deterministic,
+// virtual-time sensor data.
+//
+// Modelled:
+//   MPU9250 - register file with power-on values, auto-incrementing register
+//             pointer (except FIFO_R_W/MEM_R_W), device/FIFO/signal resets,
+//             sample rate from FCHOICE/DLPF_CFG/SMPLRT_DIV, sleep, full-scale
+//             ranges, 512-byte FIFO (FIFO_EN sources, FIFO_MODE, overflow),
+//             INT_STATUS with read or any-read clear, INT pin level/latch/
+//             pulse, I2C master SLV0-SLV4 to the attached AK8963 into
+//             EXT_SENS_DATA, bypass gating, DMP memory banks via
+//             BANK_SEL/MEM_START_ADDR/MEM_R_W and 48-byte MotionApps 4.1
+//             FIFO packets while DMP_EN is set
+//   AK8963  - WIA/INFO, ST1 DRDY/DOR, HXL..HZH, ST2 HOFL/BITM, CNTL1 power
+//             down/single/continuous 8 Hz/100 Hz/fuse ROM modes (a mode
+//             write is ignored unless the device has been in power-down for
+//             100 us, as the datasheet requires), CNTL2 soft reset, fuse ROM
+//             sensitivity adjustment values
+//
+// Not modelled: the DMP's own sensor fusion (packets carry the truth
+// quaternion), self-test responses, wake-on-motion, FSYNC and the OTP
+// contents beyond returning zeros.
+//
+// Typical harness:
+//
+//     MPU9250Sim imu;
+//     AK8963Sim mag;
+//     imu.attachMag(&mag);
+//     Wire.attach(&imu);
+//     Wire.attach(&mag);
+//     imu.setMotionSource(myTrajectory, 0);
+//
+// 2026-10-17 - initial release
+
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2012 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#ifndef _MPU9250_SIM_H_
+#define _MPU9250_SIM_H_
+
+#include "I2Cdev.h"
+
+#if I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIM
+
+#define MPU9250_SIM_DMP_BANKS       12
+#define MPU9250_SIM_BANK_SIZE       256
+#define MPU9250_SIM_FIFO_SIZE       512
+#define MPU9250_SIM_INT_PULSE_NS    50000ULL
+
+#define AK8963_SIM_DEFAULT_ADDRESS  0x0C
+
+/** Physical state of the board at one instant.
+ * accel in g, gyro in deg/s, mag in uT (AK8963 sensor axes), quat is the
+ * orientation reported in DMP packets (w, x, y, z), temperature in deg C.
+ */
+struct MPU9250SimMotion {
+    float accel[3];
+    float gyro[3];
+    float mag[3];
+    float quat[4];
+    float temperature;
+};
+
+/** Trajectory callback, called once per internal sample with the sample time.
+ */
+typedef void (*MPU9250SimMotionSource)(uint64 nanos, MPU9250SimMotion *motion, void *context);
+
+class AK8963Sim : public I2CdevSimDevice {
+    public:
+        AK8963Sim(uint8 address=AK8963_SIM_DEFAULT_ADDRESS);
+
+        void reset();
+        void setField(float x, float y, float z);
+        void setAdjustment(uint8 x, uint8 y, uint8 z);
+        void setReachable(boolean reachable);
+        uint8 getAddress();
+
+        uint8 readRegister(uint8 regAddr);
+        boolean writeRegister(uint8 regAddr, uint8 data);
+
+        boolean acknowledges(uint8 address);
+        void start(uint8 address, boolean read);
+        boolean write(uint8 address, uint8 data);
+        uint8 read(uint8 address);
+        void advance(uint64 nanos);
+
+    private:
+        uint8 devAddr;
+        boolean reachable;
+        uint8 regs[0x13];
+        uint8 regAddr;
+        boolean expectReg;
+        boolean locked;         // data read in progress, new samples held back
+        boolean pending;        // sample completed while locked
+        float field[3];
+        uint64 now;
+        uint64 nextSample;
+        uint64 modeReady;       // earliest time a mode other than power-down is accepted
+
+        void measure();
+        void setMode(uint8 cntl1);
+};
+
+class MPU9250Sim : public I2CdevSimDevice {
+    public:
+        MPU9250Sim(uint8 address=0x68, uint8 intPin=3);
+
+        void reset();
+        void attachMag(AK8963Sim *mag);
+        void setMotion(const MPU9250SimMotion *motion);
+        void setMotionSource(MPU9250SimMotionSource source, void *context);
+
+        uint8 getRegister(uint8 regAddr);
+        void setRegister(uint8 regAddr, uint8 data);
+        uint8 getMemory(uint8 bank, uint8 address);
+        uint16 getFIFOCount();
+        uint32 getSampleCount();
+        uint32 getOverflowCount();
+
+        boolean acknowledges(uint8 address);
+        void start(uint8 address, boolean read);
+        boolean write(uint8 address, uint8 data);
+        uint8 read(uint8 address);
+        void advance(uint64 nanos);
+
+    private:
+        uint8 devAddr;
+        uint8 intPin;
+        AK8963Sim *mag;
+        MPU9250SimMotionSource source;
+        void *sourceContext;
+        MPU9250SimMotion motion;
+
+        uint8 regs[128];
+        uint8 mem[MPU9250_SIM_DMP_BANKS][MPU9250_SIM_BANK_SIZE];
+        uint8 fifo[MPU9250_SIM_FIFO_SIZE];
+        uint16 fifoHead;
+        uint16 fifoCount;
+        uint8 fifoCountLatch;
+        boolean fifoCountLatched;
+
+        uint8 regAddr;
+        boolean expectReg;
+        boolean readSeen;
+
+        uint64 now;
+        uint64 nextSample;
+        uint64 pulseEnd;
+        boolean intActive;
+        uint32 samples;
+        uint32 overflows;
+        uint16 dmpDivider;
+        uint16 mstDivider;
+
+        void deviceReset();
+        uint64 samplePeriod();
+        boolean sampling();
+        void sample(uint64 at);
+        void runMaster();
+        void pushFIFO(const uint8 *data, uint16 length);
+        void pushDMPPacket();
+        void raise(uint8 status);
+        void updateIntPin();
+        void updateBypass();
+        uint8 readRegister(uint8 regAddr);
+        void writeRegister(uint8 regAddr, uint8 data);
+};
+
+#endif // I2CDEV_IMPLEMENTATION == I2CDEV_HOST_SIM
+
+#endif /* _MPU9250_SIM_H_ */
@@ -3,6 +3,10 @@
 // Updates should (hopefully) always be available at https://github.com/jrowberg/i2cdevlib
 //
 // Changelog:
+//      2026-10-17 - drain DMP packets through MPU9250FIFOReader, which realigns after
+//                   overflows and short reads instead of resetting the FIFO
+//      2026-10-17 - read DMP packets through the I2Cdev job queue and keep serving
+//                   the RC-100 while the transfer is in flight
 //      2013-05-08 - added seamless Fastwire support
 //                 - added note about gyro calibration
 //      2012-06-21 - added note about Arduino 1.0.1 + Leonardo compatibility error
@@ -53,6 +57,7 @@ THE SOFTWARE.
 #include <I2Cdev.h>
 #include <helper_3dmath.h>
 #include <MPU9250.h>
+#include <MPU9250_FIFO.h>
 // class default I2C address is 0x68
 // specific I2C addresses may be passed as a parameter here
 // AD0 low = 0x68 (default for SparkFun breakout and InvenSense evaluation board)
@@ -149,8 +154,10 @@ boolean dmpReady = false;  // set true if DMP init was successful
 uint8 mpuIntStatus;   // holds actual interrupt status byte from MPU
 uint8 devStatus;      // return status after each device operation (0 = success, !0 = error)
 uint16 packetSize;    // expected DMP packet size (default is 42 bytes)
-uint16 fifoCount;     // count of all bytes currently in FIFO
-uint8 fifoBuffer[64]; // FIFO storage buffer
+uint8 fifoRing[4 * 48]; // room for four DMP packets
+MPU9250FIFOReader fifo(&mpu, fifoRing, sizeof(fifoRing));
+const uint8 *fifoBuffer; // newest packet, points into fifoRing
+uint32 fifoOverflows;   // overflow count already reported
 
 // orientation/motion vars
 Quaternion q;           // [w, x, y, z]         quaternion container
@@ -235,8 +242,19 @@ while(!SerialUSB.available());
     // load and configure the DMP
     SerialUSB.println("Initializing DMP...");
 #endif   
-    devStatus = mpu.dmpInitialize();
+    // the DMP is loaded from loop(), one step per pass, so the RC-100 and
+    // the servos are served meanwhile (see dmpInitDone())
+    mpu.dmpInitBegin();
+    devStatus = MPU9250_DMP_INIT_BUSY;
 
+    // configure LED for output
+    pinMode(BOARD_LED_PIN, OUTPUT);
+    pinMode(R_LED1,OUTPUT);
+   digitalWrite(R_LED1,over_flow);
+}
+
+// called once when mpu.dmpInitStep() has finished with devStatus
+void dmpInitDone() {
     // supply your own gyro offsets here, scaled for min sensitivity
     mpu.setXGyroOffset(220);
     mpu.setYGyroOffset(76);
@@ -266,10 +284,13 @@ while(!SerialUSB.available());
 
         // get expected DMP packet size for later comparison
         packetSize = mpu.dmpGetFIFOPacketSize();
+        fifo.beginPackets(packetSize);
+        fifo.setValidator(MPU9250FIFOReader::isDMPPacket);
     } else {
         // ERROR!
         // 1 = initial memory load failed
         // 2 = DMP configuration updates failed
+        // 3 = DMP never produced FIFO data
         // (if it's going to break, usually the code will be 1)
 #ifdef Debug
         SerialUSB.print("DMP Initialization failed (code ");
@@ -277,10 +298,6 @@ while(!SerialUSB.available());
         SerialUSB.println(")");
 #endif        
     }
-    // configure LED for output
-    pinMode(BOARD_LED_PIN, OUTPUT);
-    pinMode(R_LED1,OUTPUT);
-   digitalWrite(R_LED1,over_flow);
 }
 
 
@@ -290,68 +307,52 @@ while(!SerialUSB.available());
 // ================================================================
 
 void loop() {
+    // DMP still loading: one init step per pass
+    if (devStatus == MPU9250_DMP_INIT_BUSY) {
+        handleController();
+        devStatus = mpu.dmpInitStep();
+        if (devStatus != MPU9250_DMP_INIT_BUSY) dmpInitDone();
+        return;
+    }
+
     // if programming failed, don't try to do anything
     if (!dmpReady) return;
 
-    // wait for MPU interrupt or extra packet(s) available
-    while (!mpuInterrupt && fifoCount < packetSize) { //SerialUSB.println("WHAT");
-        // other program behavior stuff here
-        // .
-  if(Controller.available())
-  {
-    switch(Controller.readData())
-    {
-      case RC100_BTN_U: {forward(); break;  }
-      case RC100_BTN_D: {backward(); break;  }
-      case RC100_BTN_L: {leftward(); break;  }
-      case RC100_BTN_R: {rightward(); break;  } 
-      case RC100_BTN_6: {turnleft(); break;  }  
-      case RC100_BTN_5: {turnright(); break;  }
-      case RC100_BTN_1: { zeropoint[0] = yaw;  break;  }
-      case RC100_BTN_2: { zeropoint[0]=yaw; zeropoint[1] = pitch; zeropoint[2] = roll; break;  }
-      case ((RC100_BTN_3)+(RC100_BTN_4)): {   motor=!motor; break;  }
-      case ((RC100_BTN_U)+(RC100_BTN_L)): {forleftward(); break;  }
-      case ((RC100_BTN_U)+(RC100_BTN_R)): {forrightward(); break;  }
-      case ((RC100_BTN_D)+(RC100_BTN_L)): {backleftward(); break;  }
-      case ((RC100_BTN_D)+(RC100_BTN_R)): {backrightward(); break;  }
-      default: {stop(); break;}
-    }
-  } 
-        // if you are really paranoid you can frequently test in between other
-        // stuff to see if mpuInterrupt is true, and if so, "break;" from the
-        // while() loop to immediately process the MPU data
-        // .
-        // .
-        // .
-    }
+    // other program behavior stuff here
+    handleController();
+
+    if (fifo.isDraining()) {
+        // one bus chunk of the background FIFO read per pass; the packets
+        // are used once the whole read has completed
+        I2Cdev::poll();
+        if (fifo.isDraining()) return;
+    } else {
+        // wait for MPU interrupt or extra packet(s) available
+        if (!mpuInterrupt) return;
 
-    // reset interrupt flag and get INT_STATUS byte
-    mpuInterrupt = false;
-    mpuIntStatus = mpu.getIntStatus();
+        // reset interrupt flag and get INT_STATUS byte
+        mpuInterrupt = false;
+        mpuIntStatus = mpu.getIntStatus();
 
-    // get current FIFO count
-    fifoCount = mpu.getFIFOCount();
+        // read every whole packet from the FIFO in the background, so loop()
+        // keeps serving the RC-100 meanwhile. After an overflow or a short
+        // read the reader drops only the partial packet and keeps going
+        // instead of resetting the FIFO.
+        if (!fifo.drainAsync() || fifo.isDraining()) return;
+    }
 
-    // check for overflow (this should never happen unless our code is too inefficient)
-    if ((mpuIntStatus & 0x10) || fifoCount == 1024) {
-        // reset so we can continue cleanly
-        mpu.resetFIFO();
+    if (fifo.getOverflowCount() != fifoOverflows) {
+        fifoOverflows = fifo.getOverflowCount();
         digitalWrite(R_LED1,!over_flow);
 #ifdef Debug        
-        SerialUSB.println("FIFO overflow!");
+        SerialUSB.print("FIFO overflow! dropped ");
+        SerialUSB.println(fifo.getDroppedCount());
 #endif        
+    }
 
-    // otherwise, check for DMP data ready interrupt (this should happen frequently)
-    } else if (mpuIntStatus & 0x02) {
-        // wait for correct available data length, should be a VERY short wait
-        while (fifoCount < packetSize) fifoCount = mpu.getFIFOCount();
-
-        // read a packet from FIFO
-        mpu.getFIFOBytes(fifoBuffer, packetSize);
-        
-        // track FIFO count here in case there is > 1 packet available
-        // (this lets us immediately read more without waiting for an interrupt)
-        fifoCount -= packetSize;
+    // only the newest packet matters for pointing the motors
+    if (fifo.available() > 0) {
+        fifoBuffer = fifo.peek(fifo.available() - 1);
 
     mpu.dmpGetQuaternion(&q, fifoBuffer);
 yaw=atan2(2.0f*(q.x*q.y+q.w*q.z),1-2.0f*(q.y*q.y+q.z*q.z))* 180/M_PI;
@@ -491,6 +492,8 @@ AX.goalPosition(ROLLmotor,motormap(motorangle[2]));
         blinkState = !blinkState;
         digitalWrite(BOARD_LED_PIN, blinkState);
 
+        // done with fifoBuffer; hand the ring space back
+        fifo.release(fifo.available());
     }
 }
 
@@ -500,6 +503,30 @@ AX.goalPosition(ROLLmotor,motormap(motorangle[2]));
 
 
 
+void handleController()
+{
+  if(Controller.available())
+  {
+    switch(Controller.readData())
+    {
+      case RC100_BTN_U: {forward(); break;  }
+      case RC100_BTN_D: {backward(); break;  }
+      case RC100_BTN_L: {leftward(); break;  }
+      case RC100_BTN_R: {rightward(); break;  } 
+      case RC100_BTN_6: {turnleft(); break;  }  
+      case RC100_BTN_5: {turnright(); break;  }
+      case RC100_BTN_1: { zeropoint[0] = yaw;  break;  }
+      case RC100_BTN_2: { zeropoint[0]=yaw; zeropoint[1] = pitch; zeropoint[2] = roll; break;  }
+      case ((RC100_BTN_3)+(RC100_BTN_4)): {   motor=!motor; break;  }
+      case ((RC100_BTN_U)+(RC100_BTN_L)): {forleftward(); break;  }
+      case ((RC100_BTN_U)+(RC100_BTN_R)): {forrightward(); break;  }
+      case ((RC100_BTN_D)+(RC100_BTN_L)): {backleftward(); break;  }
+      case ((RC100_BTN_D)+(RC100_BTN_R)): {backrightward(); break;  }
+      default: {stop(); break;}
+    }
+  } 
+}
+
 void stop()
 {
     AX.goalSpeed(FL, 0);          
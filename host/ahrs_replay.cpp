@@ -0,0 +1,142 @@
+// openCM_AHRS offline replay on a Linux host
+//
+// Runs a recorded sensor stream (raw counts + capture timestamps, as written
+// by openCM_AHRS with SerialRecord defined) through the sketch's own
+// Madgwick/Mahony code in quaternionFilters.ino and writes the orientation
+// trace, so beta/Kp/Ki can be tuned without re-flashing the board.
+//
+//     g++ -O2 -DI2CDEV_IMPLEMENTATION=I2CDEV_HOST_SIM -II2Cdev -IMPU9250_master
+//         host/ahrs_replay.cpp -o ahrs_replay -lm
+//     ./ahrs_replay -f mahony -p 5 -i 0.01 capture.txt > trace.csv
+//
+// Options:
+//     -f madgwick|mahony   filter (default madgwick)
+//     -b beta              Madgwick gain (default sqrt(3/4) * 40 deg/s, as the sketch)
+//     -p Kp -i Ki          Mahony gains (default 10, 0, as the sketch)
+//     -n N                 replay the sketch's multi-rate scheme: gyro propagation
+//                          every sample, accel/mag correction every N samples
+//                          (default 0: full QuaternionUpdate on every sample)
+//     -d D                 write every D-th orientation (default 1)
+//     -q                   no trace, only the timing summary on stderr
+//     -r R                 replay the stream R times (for timing)
+//
+// Input is the binary log (openCM_AHRS/sensorLog.h, memory-mapped through
+// host/sensor_log.h), or text with one sample per line:
+//
+//     index captureMicros ax ay az gx gy gz mx my mz magFresh
+//
+// plus one "# scale aRes gRes mRes cx cy cz bx by bz" line giving the sensor
+// resolutions and the sketch's magCalibration/magBias. Any other line (debug
+// output interleaved on the same port) is skipped. The trace is CSV:
+// captureMicros,q0,q1,q2,q3,yaw,pitch,roll.
+//
+// All unit conversion is done once while loading, so the replay loop is the
+// filter arithmetic alone.
+//
+// 2026-10-17 - read the binary sensor log
+// 2026-10-17 - initial release
+
+// standard headers first: I2Cdev_host.h defines Arduino-style min()/max() macros
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "I2Cdev.h"
+#include "helper_3dmath.h"
+#include "replay_stream.h"
+
+// free parameters read by quaternionFilters.ino (macros/globals in the sketch)
+float beta = sqrt(3.0f / 4.0f) * PI * (40.0f / 180.0f);
+float Kp = 2.0f * 5.0f;
+float Ki = 0.0f;
+float eInt[3] = { 0.0f, 0.0f, 0.0f };
+
+#include "../openCM_AHRS/quaternionFilters.ino"
+
+static void writeOrientation(uint32 micros, const float *q) {
+    float yaw = (atan2(2.0f * (q[1] * q[2] + q[0] * q[3]), q[0] * q[0] + q[1] * q[1] - q[2] * q[2] - q[3] * q[3]))*180.0f/PI;
+    float pitch = (asin(2.0f * (q[0] * q[2]-q[1] * q[3])))*180.0f/PI;
+    float roll = (atan2(2.0f * (q[0] * q[1] + q[2] * q[3]), q[0] * q[0] -q[1] * q[1] - q[2] * q[2] + q[3] * q[3]))*180.0f/PI;
+    printf("%u,%.6f,%.6f,%.6f,%.6f,%.3f,%.3f,%.3f\n", micros, q[0], q[1], q[2], q[3], yaw, pitch, roll);
+}
+
+/** Run the whole stream through one filter from the identity orientation.
+ * Magnetometer axes are swapped (my, mx, mz) exactly as in the sketch.
+ * @param s Stream
+ * @param mahony Mahony instead of Madgwick
+ * @param divider 0 for a full update per sample, else corrections every divider samples
+ * @param decimate Write every decimate-th orientation, 0 for none
+ */
+static void replay(const ReplayStream *s, boolean mahony, uint32 divider, uint32 decimate) {
+    float q[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    float correctionDeltat = 0.0f;
+    uint32 correctionIndex = 0;     // the sketch counts samples from 0 after setup()
+    eInt[0] = eInt[1] = eInt[2] = 0.0f;
+
+    size_t n = s->micros.size();
+    for (size_t k = 1; k < n; k++) {
+        float deltat = (s->micros[k] - s->micros[k - 1]) / 1000000.0f;
+        float ax = s->a[0][k], ay = s->a[1][k], az = s->a[2][k];
+        float gx = s->g[0][k], gy = s->g[1][k], gz = s->g[2][k];
+        float mx = s->m[0][k], my = s->m[1][k], mz = s->m[2][k];
+
+        if (divider == 0) {
+            if (mahony) MahonyQuaternionUpdate(ax, ay, az, gx, gy, gz, my, mx, mz, deltat, q);
+            else MadgwickQuaternionUpdate(ax, ay, az, gx, gy, gz, my, mx, mz, deltat, q);
+        } else {
+            gyroQuaternionUpdate(gx, gy, gz, deltat, q);
+            correctionDeltat += deltat;
+            if (s->index[k] - correctionIndex < divider) continue;
+            correctionIndex = s->index[k];
+            if (mahony) MahonyCorrection(ax, ay, az, my, mx, mz, s->magFresh[k], correctionDeltat, q);
+            else MadgwickCorrection(ax, ay, az, my, mx, mz, s->magFresh[k], correctionDeltat, q);
+            correctionDeltat = 0.0f;
+        }
+        if (decimate && k % decimate == 0) writeOrientation(s->micros[k], q);
+    }
+}
+
+int main(int argc, char **argv) {
+    boolean mahony = false;
+    uint32 divider = 0, decimate = 1, repeat = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:b:p:i:n:d:qr:")) != -1) {
+        switch (opt) {
+            case 'f': mahony = strcmp(optarg, "mahony") == 0; break;
+            case 'b': beta = atof(optarg); break;
+            case 'p': Kp = atof(optarg); break;
+            case 'i': Ki = atof(optarg); break;
+            case 'n': divider = atoi(optarg); break;
+            case 'd': decimate = atoi(optarg); break;
+            case 'q': decimate = 0; break;
+            case 'r': repeat = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-f madgwick|mahony] [-b beta] [-p Kp] [-i Ki] [-n N] [-d D] [-q] [-r R] [file]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    ReplayStream s;
+    if (!loadStream(optind < argc ? argv[optind] : 0, &s)) return 1;
+    if (s.micros.size() < 2) {
+        fprintf(stderr, "no samples\n");
+        return 1;
+    }
+
+    static char out[1 << 16];
+    setvbuf(stdout, out, _IOFBF, sizeof(out));
+    if (decimate) printf("captureMicros,q0,q1,q2,q3,yaw,pitch,roll\n");
+
+    uint64 t0 = nowNanos();
+    for (uint32 r = 0; r < repeat; r++) replay(&s, mahony, divider, r == 0 ? decimate : 0);
+    uint64 t1 = nowNanos();
+
+    double samples = (double)(s.micros.size() - 1) * repeat;
+    double seconds = (t1 - t0) / 1e9;
+    fprintf(stderr, "%s%s: %.0f samples (%.1f s of data) in %.3f s, %.2f Msamples/s\n",
+        mahony ? "mahony" : "madgwick", divider ? " multi-rate" : "", samples,
+        (s.micros.back() - s.micros.front()) / 1e6, seconds, samples / seconds / 1e6);
+    return 0;
+}
@@ -0,0 +1,279 @@
+// openCM_AHRS filter gain sweep on a Linux host
+//
+// Replays one recorded stream (see host/ahrs_replay.cpp) through a grid of
+// Madgwick beta or Mahony Kp/Ki values. Configurations are packed
+// FILTER_LANES to a SIMD block (host/filter_lanes.h) and the blocks are
+// shared out over worker threads, so thousands of gain sets over a long
+// capture take seconds to minutes.
+//
+//     g++ -O2 -march=native -ffp-contract=off -pthread -DI2CDEV_IMPLEMENTATION=I2CDEV_HOST_SIM
+//         -II2Cdev -IMPU9250_master host/ahrs_sweep.cpp -o ahrs_sweep -lm
+//     ./ahrs_sweep -f mahony -p 0.5:20:40 -i 0:0.1:11 -R truth.csv capture.txt > sweep.csv
+//
+// Options:
+//     -f madgwick|mahony   filter (default madgwick)
+//     -b from:to:count     beta values (default the sketch's beta only)
+//     -p from:to:count     Kp values (default 10)
+//     -i from:to:count     Ki values (default 0)
+//     -n N                 the sketch's multi-rate scheme, as ahrs_replay -n:
+//                          gyro propagation every sample, accel/mag
+//                          correction every N samples (default 0: full update)
+//     -R trace.csv         reference orientation in ahrs_replay's CSV format
+//                          (e.g. a motion-capture run or a trusted filter),
+//                          matched to samples by captureMicros
+//     -s seconds           ignore the first seconds when scoring (default 0)
+//     -t threads           worker threads (default: all cores)
+//
+// Output is one CSV row per configuration: the gains, the final quaternion
+// and, with -R, the RMS and worst attitude error against the reference in
+// degrees. The RMS is taken over sin(angle/2), the length of the vector part
+// of conj(qref) * q, so that no acos() is needed per sample and lane (and
+// 1 - dot^2 would lose everything below ~0.3 deg to float rounding).
+//
+// Every lane is a copy of the scalar MadgwickQuaternionUpdate() /
+// MahonyQuaternionUpdate(), or with -n of gyroQuaternionUpdate() plus
+// MadgwickCorrection() / MahonyCorrection() on the same schedule as
+// ahrs_replay, so a lane with the sketch's gains ends on the same quaternion
+// as ahrs_replay with the same -n (host/filter_lanes_test.cpp checks this;
+// -ffp-contract=off keeps the compiler from fusing multiply-adds that the
+// scalar build and the board do not).
+// zeta is not swept: the sketch's Madgwick filter has no gyro bias term.
+//
+// 2026-10-17 - initial release
+
+// standard headers first: I2Cdev_host.h defines Arduino-style min()/max() macros
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "I2Cdev.h"
+#include "helper_3dmath.h"
+#include "replay_stream.h"
+#include "filter_lanes.h"
+
+struct SweepRange {
+    float from, to;
+    uint32 count;
+};
+
+struct SweepResult {
+    float gain[2];          // beta, or Kp and Ki
+    float q[4];
+    double errorSum;        // sum of sin^2(angle/2) over scored samples
+    float errorMax;
+    uint32 scored;
+};
+
+static std::vector<FilterLanesInput> inputs;
+static std::vector<float> reference;            // 4 floats per input sample, w = 2 where there is no reference
+static std::vector<SweepResult> results;
+static std::atomic<uint32> nextBlock(0);
+static boolean mahony = false;
+static uint32 divider = 0;
+static uint32 scoreFrom = 1;
+
+static boolean parseRange(const char *s, SweepRange *r) {
+    if (sscanf(s, "%f:%f:%u", &r->from, &r->to, &r->count) == 3 && r->count > 0) return true;
+    if (sscanf(s, "%f", &r->from) == 1) {
+        r->to = r->from;
+        r->count = 1;
+        return true;
+    }
+    return false;
+}
+
+static float rangeValue(const SweepRange *r, uint32 k) {
+    return r->count > 1 ? r->from + (r->to - r->from) * k / (r->count - 1) : r->from;
+}
+
+// reference rows "micros,q0,q1,q2,q3,..." matched to stream samples by time
+static boolean loadReference(const char *path, const ReplayStream *s) {
+    FILE *f = fopen(path, "rb");
+    if (f == 0) {
+        perror(path);
+        return false;
+    }
+    reference.assign(s->micros.size() * 4, 0.0f);
+    for (size_t k = 0; k < s->micros.size(); k++) reference[k * 4] = 2.0f;
+    char line[256];
+    size_t k = 0;
+    uint32 matched = 0;
+    while (fgets(line, sizeof(line), f) != 0) {
+        uint32 micros;
+        float q[4];
+        if (sscanf(line, "%u,%f,%f,%f,%f", &micros, &q[0], &q[1], &q[2], &q[3]) != 5) continue;
+        while (k < s->micros.size() && (int32)(s->micros[k] - micros) < 0) k++;
+        if (k < s->micros.size() && s->micros[k] == micros) {
+            memcpy(&reference[k * 4], q, sizeof(q));
+            matched++;
+        }
+    }
+    fclose(f);
+    fprintf(stderr, "reference: %u of %u samples\n", matched, (uint32)s->micros.size());
+    return matched > 0;
+}
+
+// accumulate sin^2(angle/2) = |vector part of conj(ref) * q|^2 for one sample
+static inline void scoreLanes(const lanef *q, const float *ref, lanef *sum, lanef *worst) {
+    lanef vx = ref[0] * q[1] - q[0] * ref[1] - (ref[2] * q[3] - ref[3] * q[2]);
+    lanef vy = ref[0] * q[2] - q[0] * ref[2] - (ref[3] * q[1] - ref[1] * q[3]);
+    lanef vz = ref[0] * q[3] - q[0] * ref[3] - (ref[1] * q[2] - ref[2] * q[1]);
+    lanef e = vx * vx + vy * vy + vz * vz;
+    *sum += e;
+    *worst = e > *worst ? e : *worst;
+}
+
+static void runBlock(uint32 block) {
+    SweepResult *r = &results[block * FILTER_LANES];
+    lanef g0, g1, sum = {}, worst = {};
+    for (uint8 l = 0; l < FILTER_LANES; l++) {
+        g0[l] = r[l].gain[0];
+        g1[l] = r[l].gain[1];
+    }
+    const boolean score = !reference.empty();
+    uint32 scored = 0;
+    size_t n = inputs.size();
+    lanef q[4];
+
+    if (mahony) {
+        MahonyLanes f;
+        mahonyLanesReset(&f, g0, g1);
+        for (size_t k = 1; k < n; k++) {
+            if (divider == 0) {
+                mahonyLanesUpdate(&f, &inputs[k]);
+            } else {
+                gyroLanesUpdate(f.q, &inputs[k]);
+                if (inputs[k].correct) mahonyLanesCorrection(&f, &inputs[k]);
+            }
+            if (score && k >= scoreFrom && reference[k * 4] < 1.5f) {
+                scoreLanes(f.q, &reference[k * 4], &sum, &worst);
+                scored++;
+            }
+        }
+        memcpy(q, f.q, sizeof(q));
+    } else {
+        MadgwickLanes f;
+        madgwickLanesReset(&f, g0);
+        for (size_t k = 1; k < n; k++) {
+            if (divider == 0) {
+                madgwickLanesUpdate(&f, &inputs[k]);
+            } else {
+                gyroLanesUpdate(f.q, &inputs[k]);
+                if (inputs[k].correct) madgwickLanesCorrection(&f, &inputs[k]);
+            }
+            if (score && k >= scoreFrom && reference[k * 4] < 1.5f) {
+                scoreLanes(f.q, &reference[k * 4], &sum, &worst);
+                scored++;
+            }
+        }
+        memcpy(q, f.q, sizeof(q));
+    }
+
+    for (uint8 l = 0; l < FILTER_LANES; l++) {
+        for (uint8 i = 0; i < 4; i++) r[l].q[i] = q[i][l];
+        r[l].errorSum = sum[l];
+        r[l].errorMax = worst[l];
+        r[l].scored = scored;
+    }
+}
+
+static void worker(uint32 blocks) {
+    uint32 block;
+    while ((block = nextBlock++) < blocks) runBlock(block);
+}
+
+static double errorDegrees(double e) {
+    if (e < 0) e = 0;
+    if (e > 1) e = 1;
+    return 2.0 * asin(sqrt(e)) * 180.0 / PI;
+}
+
+int main(int argc, char **argv) {
+    SweepRange range[2] = { { 0, 0, 1 }, { 0, 0, 1 } };
+    boolean haveBeta = false, haveKp = false, haveKi = false;
+    const char *referencePath = 0;
+    float skipSeconds = 0;
+    uint32 threads = std::thread::hardware_concurrency();
+    int opt;
+    while ((opt = getopt(argc, argv, "f:b:p:i:n:R:s:t:")) != -1) {
+        switch (opt) {
+            case 'f': mahony = strcmp(optarg, "mahony") == 0; break;
+            case 'b': haveBeta = parseRange(optarg, &range[0]); break;
+            case 'p': haveKp = parseRange(optarg, &range[0]); break;
+            case 'i': haveKi = parseRange(optarg, &range[1]); break;
+            case 'n': divider = atoi(optarg); break;
+            case 'R': referencePath = optarg; break;
+            case 's': skipSeconds = atof(optarg); break;
+            case 't': threads = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-f madgwick|mahony] [-b|-p|-i from:to:count] [-n N] [-R trace.csv] [-s seconds] [-t threads] [file]\n", argv[0]);
+                return 2;
+        }
+    }
+    // the sketch's gains where no range is given
+    if (!mahony && !haveBeta) range[0].from = range[0].to = sqrt(3.0f / 4.0f) * PI * (40.0f / 180.0f);
+    if (mahony && !haveKp) range[0].from = range[0].to = 2.0f * 5.0f;
+    if (!mahony || !haveKi) range[1].count = 1;
+    if (threads == 0) threads = 1;
+
+    ReplayStream s;
+    if (!loadStream(optind < argc ? argv[optind] : 0, &s)) return 1;
+    size_t n = s.micros.size();
+    if (n < 2) {
+        fprintf(stderr, "no samples\n");
+        return 1;
+    }
+    if (referencePath != 0 && !loadReference(referencePath, &s)) return 1;
+
+    // state-independent input, shared by every configuration
+    inputs.resize(n);
+    uint32 correctionIndex = 0;     // the sketch counts samples from 0 after setup()
+    float correctionDeltat = 0.0f;
+    for (size_t k = 1; k < n; k++) {
+        filterLanesInput(&inputs[k], s.a[0][k], s.a[1][k], s.a[2][k], s.g[0][k], s.g[1][k], s.g[2][k],
+            s.m[1][k], s.m[0][k], s.m[2][k], (s.micros[k] - s.micros[k - 1]) / 1000000.0f);
+        if (divider) filterLanesSchedule(&inputs[k], s.index[k], s.magFresh[k], divider, &correctionIndex, &correctionDeltat);
+        if (s.micros[k] - s.micros[0] < skipSeconds * 1e6f) scoreFrom = k + 1;
+    }
+
+    // configuration grid, padded to whole blocks with copies of the last one
+    uint32 configs = range[0].count * range[1].count;
+    uint32 blocks = (configs + FILTER_LANES - 1) / FILTER_LANES;
+    results.resize(blocks * FILTER_LANES);
+    for (uint32 c = 0; c < blocks * FILTER_LANES; c++) {
+        uint32 k = c < configs ? c : configs - 1;
+        results[c].gain[0] = rangeValue(&range[0], k / range[1].count);
+        results[c].gain[1] = rangeValue(&range[1], k % range[1].count);
+    }
+
+    uint64 t0 = nowNanos();
+    std::vector<std::thread> pool;
+    for (uint32 t = 0; t < threads && t < blocks; t++) pool.push_back(std::thread(worker, blocks));
+    for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+    uint64 t1 = nowNanos();
+
+    static char out[1 << 16];
+    setvbuf(stdout, out, _IOFBF, sizeof(out));
+    printf(mahony ? "kp,ki,q0,q1,q2,q3" : "beta,q0,q1,q2,q3");
+    printf(referencePath ? ",rmsDeg,maxDeg\n" : "\n");
+    for (uint32 c = 0; c < configs; c++) {
+        const SweepResult *r = &results[c];
+        if (mahony) printf("%g,%g", r->gain[0], r->gain[1]);
+        else printf("%g", r->gain[0]);
+        printf(",%.6f,%.6f,%.6f,%.6f", r->q[0], r->q[1], r->q[2], r->q[3]);
+        if (referencePath) {
+            printf(",%.4f,%.4f", r->scored ? errorDegrees(r->errorSum / r->scored) : 0.0,
+                errorDegrees(r->errorMax));
+        }
+        printf("\n");
+    }
+
+    double updates = (double)(n - 1) * blocks * FILTER_LANES;
+    double seconds = (t1 - t0) / 1e9;
+    fprintf(stderr, "%s%s: %u configurations x %u samples, %u lanes x %u threads, %.3f s, %.1f M filter updates/s\n",
+        mahony ? "mahony" : "madgwick", divider ? " multi-rate" : "", configs, (uint32)(n - 1), FILTER_LANES, (uint32)pool.size(), seconds, updates / seconds / 1e6);
+    return 0;
+}
@@ -0,0 +1,93 @@
+// MPU9250 DMP loader heap allocation check on the I2Cdev host simulation
+//
+// Links MPU9250.cpp with malloc(), calloc() and realloc() wrapped by the
+// linker and counts every call made while the DMP is loaded and configured
+// on the MPU9250Sim model:
+//
+//   - cold dmpInitialize() (firmware image, dmpConfig[], dmpUpdates[])
+//   - warm dmpInitialize() after an MCU reset (data RAM configuration only)
+//   - writeProgDMPConfigurationSet() over the whole of dmpConfig[], and
+//     writeMemoryBlock()/readMemoryBlock() with and without verify
+//
+// The loaders work from fixed scratch buffers, so a single allocation is a
+// failure: on a 20 KB RAM board it would fragment the heap during setup().
+//
+//     g++ -O2 -DI2CDEV_IMPLEMENTATION=I2CDEV_HOST_SIM -II2Cdev -IMPU9250_master
+//         -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+//         I2Cdev/*.cpp MPU9250_master/*.cpp host/dmp_alloc_test.cpp -o dmp_alloc_test
+//     ./dmp_alloc_test
+//
+// Exits non-zero if anything was allocated or a load failed.
+//
+// 2026-10-17 - initial release
+
+// standard headers first: I2Cdev_host.h defines Arduino-style min()/max() macros
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "MPU9250.h"
+#include "MPU9250_sim.h"
+
+static MPU9250Sim imu;
+static AK8963Sim mag;
+static boolean counting = false;
+static uint32 allocations = 0;
+static uint32 failures = 0;
+
+extern "C" {
+    void *__real_malloc(size_t size);
+    void *__real_calloc(size_t count, size_t size);
+    void *__real_realloc(void *p, size_t size);
+
+    void *__wrap_malloc(size_t size) {
+        if (counting) allocations++;
+        return __real_malloc(size);
+    }
+    void *__wrap_calloc(size_t count, size_t size) {
+        if (counting) allocations++;
+        return __real_calloc(count, size);
+    }
+    void *__wrap_realloc(void *p, size_t size) {
+        if (counting) allocations++;
+        return __real_realloc(p, size);
+    }
+}
+
+/** Report the allocations made since the last call.
+ * @param what Label for the report
+ * @param ok The operation itself succeeded
+ */
+static void check(const char *what, boolean ok) {
+    printf("%-36s %s, %u allocations\n", what, ok ? "ok" : "failed", allocations);
+    if (!ok || allocations != 0) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+    allocations = 0;
+}
+
+int main() {
+    imu.attachMag(&mag);
+    Wire.attach(&imu);
+    Wire.attach(&mag);
+    Wire.setClock(400000);
+
+    MPU9250 mpu;
+    mpu.initialize();
+    counting = true;
+    check("dmpInitialize (power-on)", mpu.dmpInitialize() == 0);
+    check("dmpInitialize (MCU reset)", mpu.dmpFirmwareResident() && mpu.dmpInitialize() == 0);
+    check("writeProgDMPConfigurationSet", mpu.writeProgDMPConfigurationSet(dmpConfig, MPU9250_DMP_CONFIG_SIZE));
+
+    uint8 data[40], back[40];
+    for (uint8 i = 0; i < sizeof(data); i++) data[i] = i * 7;
+    boolean ok = mpu.writeMemoryBlock(data, sizeof(data), 0x01, 0xF0);    // crosses into bank 2
+    mpu.readMemoryBlock(back, sizeof(back), 0x01, 0xF0);
+    ok = ok && memcmp(data, back, sizeof(data)) == 0;
+    ok = ok && mpu.writeMemoryBlock(data, sizeof(data), 0x01, 0xF0, false);
+    check("writeMemoryBlock/readMemoryBlock", ok);
+    counting = false;
+
+    printf(failures ? "%u failures\n" : "ok\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,442 @@
+// Structure-of-arrays Madgwick/Mahony updates for gain sweeps (Linux host)
+//
+// Advances FILTER_LANES filter instances at once: every lane sees the same
+// sensor sample but has its own quaternion and gains (beta, or Kp/Ki and the
+// integral error). The arithmetic is a lane-for-lane copy of
+// MadgwickQuaternionUpdate() and MahonyQuaternionUpdate() in
+// openCM_AHRS/quaternionFilters.ino, and of the multi-rate split
+// gyroQuaternionUpdate() / MadgwickCorrection() / MahonyCorrection(),
+// written with GCC vector extensions so
+// the compiler emits SSE/AVX on x86 and NEON on ARM without intrinsics.
+// Build with -mavx (or -march=native) for 8 lanes; SSE2/NEON give 4.
+//
+// Inputs that do not depend on the filter state (normalized accel and mag)
+// are prepared once per sample by filterLanesInput() and shared by all lanes;
+// filterLanesSchedule() adds the correction schedule of ahrs_replay -n.
+//
+// Include after I2Cdev.h and helper_3dmath.h.
+//
+// 2026-10-17 - initial release
+
+#ifndef _FILTER_LANES_H_
+#define _FILTER_LANES_H_
+
+#include <string.h>
+
+#if defined(__AVX__)
+#define FILTER_LANES 8
+#else
+#define FILTER_LANES 4
+#endif
+
+typedef float lanef __attribute__((vector_size(FILTER_LANES * sizeof(float))));
+typedef int32 lanei __attribute__((vector_size(FILTER_LANES * sizeof(int32))));
+
+/** One sensor sample in filter units, shared by every lane.
+ * Mag axes are already swapped (my, mx, mz) as the sketch passes them.
+ */
+struct FilterLanesInput {
+    float ax, ay, az;       // normalized accel
+    float gx, gy, gz;       // rad/s
+    float mx, my, mz;       // normalized mag
+    float deltat;           // s
+    boolean valid;          // false if accel or mag is zero (the scalar filters return early)
+    boolean accelValid;     // accel is not zero
+    boolean magValid;       // mag is not zero
+    // multi-rate schedule, see filterLanesSchedule()
+    boolean correct;        // apply a correction after propagating this sample
+    boolean useMag;         // the correction uses the mag (fresh and not zero)
+    float correctionDeltat; // s since the previous correction
+};
+
+struct MadgwickLanes {
+    lanef q[4];
+    lanef beta;
+};
+
+struct MahonyLanes {
+    lanef q[4];
+    lanef kp, ki;
+    lanef eInt[3];
+};
+
+/** invSqrt() from helper_3dmath.h, lane by lane (same seed and step count).
+ */
+static inline lanef invSqrtLanes(lanef x) {
+    lanei i;
+    lanef y;
+    lanef halfx = 0.5f * x;
+    memcpy(&i, &x, sizeof(i));
+    i = 0x5F375A86 - (i >> 1);
+    memcpy(&y, &i, sizeof(y));
+    for (uint8 n = 0; n < HELPER_3DMATH_RSQRT_ITERATIONS; n++) {
+        y = y * (1.5f - halfx * y * y);
+    }
+    return y;
+}
+
+/** Convert one sample (filter units, sketch axis order) into shared input.
+ */
+static inline void filterLanesInput(FilterLanesInput *in, float ax, float ay, float az, float gx, float gy, float gz,
+        float mx, float my, float mz, float deltat) {
+    float norm;
+    in->gx = gx;
+    in->gy = gy;
+    in->gz = gz;
+    in->deltat = deltat;
+    in->correct = false;
+    in->useMag = false;
+    in->correctionDeltat = 0.0f;
+
+    norm = ax * ax + ay * ay + az * az;
+    in->accelValid = norm != 0.0f;
+    if (in->accelValid) {
+        norm = invSqrt(norm);
+        in->ax = ax * norm;
+        in->ay = ay * norm;
+        in->az = az * norm;
+    }
+
+    norm = mx * mx + my * my + mz * mz;
+    in->magValid = norm != 0.0f;
+    if (in->magValid) {
+        norm = invSqrt(norm);
+        in->mx = mx * norm;
+        in->my = my * norm;
+        in->mz = mz * norm;
+    }
+    in->valid = in->accelValid && in->magValid;
+}
+
+/** Mark the samples that get a correction, as ahrs_replay's replay() with -n:
+ * the correction runs when index has advanced divider samples past the last
+ * one, over the time propagated since. Call for every sample in order with
+ * *correctionIndex and *correctionDeltat starting at 0.
+ * @param index Sample index (SensorSample::index)
+ * @param magFresh The sample carries a new magnetometer measurement
+ */
+static inline void filterLanesSchedule(FilterLanesInput *in, uint32 index, boolean magFresh, uint32 divider,
+        uint32 *correctionIndex, float *correctionDeltat) {
+    *correctionDeltat += in->deltat;
+    if (index - *correctionIndex < divider) return;
+    *correctionIndex = index;
+    in->correct = true;
+    in->useMag = magFresh && in->magValid;
+    in->correctionDeltat = *correctionDeltat;
+    *correctionDeltat = 0.0f;
+}
+
+static inline void madgwickLanesReset(MadgwickLanes *f, lanef beta) {
+    lanef zero = {};
+    f->q[0] = zero + 1.0f;
+    f->q[1] = f->q[2] = f->q[3] = zero;
+    f->beta = beta;
+}
+
+static inline void mahonyLanesReset(MahonyLanes *f, lanef kp, lanef ki) {
+    lanef zero = {};
+    f->q[0] = zero + 1.0f;
+    f->q[1] = f->q[2] = f->q[3] = zero;
+    f->eInt[0] = f->eInt[1] = f->eInt[2] = zero;
+    f->kp = kp;
+    f->ki = ki;
+}
+
+/** MadgwickQuaternionUpdate() for FILTER_LANES instances.
+ */
+static inline void madgwickLanesUpdate(MadgwickLanes *f, const FilterLanesInput *in) {
+    if (!in->valid) return;
+    const float ax = in->ax, ay = in->ay, az = in->az;
+    const float mx = in->mx, my = in->my, mz = in->mz;
+    const float gx = in->gx, gy = in->gy, gz = in->gz;
+    lanef q1 = f->q[0], q2 = f->q[1], q3 = f->q[2], q4 = f->q[3];
+
+    // Auxiliary variables to avoid repeated arithmetic
+    lanef _2q1 = 2.0f * q1;
+    lanef _2q2 = 2.0f * q2;
+    lanef _2q3 = 2.0f * q3;
+    lanef _2q4 = 2.0f * q4;
+    lanef _2q1q3 = 2.0f * q1 * q3;
+    lanef _2q3q4 = 2.0f * q3 * q4;
+    lanef q1q1 = q1 * q1;
+    lanef q1q2 = q1 * q2;
+    lanef q1q3 = q1 * q3;
+    lanef q1q4 = q1 * q4;
+    lanef q2q2 = q2 * q2;
+    lanef q2q3 = q2 * q3;
+    lanef q2q4 = q2 * q4;
+    lanef q3q3 = q3 * q3;
+    lanef q3q4 = q3 * q4;
+    lanef q4q4 = q4 * q4;
+
+    // Reference direction of Earth's magnetic field
+    lanef _2q1mx = 2.0f * q1 * mx;
+    lanef _2q1my = 2.0f * q1 * my;
+    lanef _2q1mz = 2.0f * q1 * mz;
+    lanef _2q2mx = 2.0f * q2 * mx;
+    lanef hx = mx * q1q1 - _2q1my * q4 + _2q1mz * q3 + mx * q2q2 + _2q2 * my * q3 + _2q2 * mz * q4 - mx * q3q3 - mx * q4q4;
+    lanef hy = _2q1mx * q4 + my * q1q1 - _2q1mz * q2 + _2q2mx * q3 - my * q2q2 + my * q3q3 + _2q3 * mz * q4 - my * q4q4;
+    lanef _2bx = hx * hx + hy * hy;
+    _2bx *= invSqrtLanes(_2bx);
+    lanef _2bz = -_2q1mx * q3 + _2q1my * q2 + mz * q1q1 + _2q2mx * q4 - mz * q2q2 + _2q3 * my * q4 - mz * q3q3 + mz * q4q4;
+    lanef _4bx = 2.0f * _2bx;
+    lanef _4bz = 2.0f * _2bz;
+
+    // Gradient decent algorithm corrective step
+    lanef s1 = -_2q3 * (2.0f * q2q4 - _2q1q3 - ax) + _2q2 * (2.0f * q1q2 + _2q3q4 - ay) - _2bz * q3 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (-_2bx * q4 + _2bz * q2) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + _2bx * q3 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+    lanef s2 = _2q4 * (2.0f * q2q4 - _2q1q3 - ax) + _2q1 * (2.0f * q1q2 + _2q3q4 - ay) - 4.0f * q2 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - az) + _2bz * q4 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (_2bx * q3 + _2bz * q1) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + (_2bx * q4 - _4bz * q2) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+    lanef s3 = -_2q1 * (2.0f * q2q4 - _2q1q3 - ax) + _2q4 * (2.0f * q1q2 + _2q3q4 - ay) - 4.0f * q3 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - az) + (-_4bx * q3 - _2bz * q1) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (_2bx * q2 + _2bz * q4) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + (_2bx * q1 - _4bz * q3) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+    lanef s4 = _2q2 * (2.0f * q2q4 - _2q1q3 - ax) + _2q3 * (2.0f * q1q2 + _2q3q4 - ay) + (-_4bx * q4 + _2bz * q2) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (-_2bx * q1 + _2bz * q3) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + _2bx * q2 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+    lanef norm = invSqrtLanes(s1 * s1 + s2 * s2 + s3 * s3 + s4 * s4);    // normalise step magnitude
+    s1 *= norm;
+    s2 *= norm;
+    s3 *= norm;
+    s4 *= norm;
+
+    // Compute rate of change of quaternion
+    lanef qDot1 = 0.5f * (-q2 * gx - q3 * gy - q4 * gz) - f->beta * s1;
+    lanef qDot2 = 0.5f * (q1 * gx + q3 * gz - q4 * gy) - f->beta * s2;
+    lanef qDot3 = 0.5f * (q1 * gy - q2 * gz + q4 * gx) - f->beta * s3;
+    lanef qDot4 = 0.5f * (q1 * gz + q2 * gy - q3 * gx) - f->beta * s4;
+
+    // Integrate to yield quaternion
+    q1 += qDot1 * in->deltat;
+    q2 += qDot2 * in->deltat;
+    q3 += qDot3 * in->deltat;
+    q4 += qDot4 * in->deltat;
+    norm = invSqrtLanes(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);    // normalise quaternion
+    f->q[0] = q1 * norm;
+    f->q[1] = q2 * norm;
+    f->q[2] = q3 * norm;
+    f->q[3] = q4 * norm;
+}
+
+/** MahonyQuaternionUpdate() for FILTER_LANES instances.
+ * Lanes with Ki <= 0 keep their integral error at zero, as the scalar code.
+ */
+static inline void mahonyLanesUpdate(MahonyLanes *f, const FilterLanesInput *in) {
+    if (!in->valid) return;
+    const float ax = in->ax, ay = in->ay, az = in->az;
+    const float mx = in->mx, my = in->my, mz = in->mz;
+    lanef q1 = f->q[0], q2 = f->q[1], q3 = f->q[2], q4 = f->q[3];
+
+    // Auxiliary variables to avoid repeated arithmetic
+    lanef q1q1 = q1 * q1;
+    lanef q1q2 = q1 * q2;
+    lanef q1q3 = q1 * q3;
+    lanef q1q4 = q1 * q4;
+    lanef q2q2 = q2 * q2;
+    lanef q2q3 = q2 * q3;
+    lanef q2q4 = q2 * q4;
+    lanef q3q3 = q3 * q3;
+    lanef q3q4 = q3 * q4;
+    lanef q4q4 = q4 * q4;
+
+    // Reference direction of Earth's magnetic field
+    lanef hx = 2.0f * mx * (0.5f - q3q3 - q4q4) + 2.0f * my * (q2q3 - q1q4) + 2.0f * mz * (q2q4 + q1q3);
+    lanef hy = 2.0f * mx * (q2q3 + q1q4) + 2.0f * my * (0.5f - q2q2 - q4q4) + 2.0f * mz * (q3q4 - q1q2);
+    lanef bx = hx * hx + hy * hy;
+    bx *= invSqrtLanes(bx);
+    lanef bz = 2.0f * mx * (q2q4 - q1q3) + 2.0f * my * (q3q4 + q1q2) + 2.0f * mz * (0.5f - q2q2 - q3q3);
+
+    // Estimated direction of gravity and magnetic field
+    lanef vx = 2.0f * (q2q4 - q1q3);
+    lanef vy = 2.0f * (q1q2 + q3q4);
+    lanef vz = q1q1 - q2q2 - q3q3 + q4q4;
+    lanef wx = 2.0f * bx * (0.5f - q3q3 - q4q4) + 2.0f * bz * (q2q4 - q1q3);
+    lanef wy = 2.0f * bx * (q2q3 - q1q4) + 2.0f * bz * (q1q2 + q3q4);
+    lanef wz = 2.0f * bx * (q1q3 + q2q4) + 2.0f * bz * (0.5f - q2q2 - q3q3);
+
+    // Error is cross product between estimated direction and measured direction of gravity
+    lanef ex = (ay * vz - az * vy) + (my * wz - mz * wy);
+    lanef ey = (az * vx - ax * vz) + (mz * wx - mx * wz);
+    lanef ez = (ax * vy - ay * vx) + (mx * wy - my * wx);
+    lanei integrate = f->ki > 0.0f;     // all ones where Ki > 0: accumulate, else hold at zero
+    lanei bits;
+    lanef sum;
+    sum = f->eInt[0] + ex; memcpy(&bits, &sum, sizeof(bits)); bits &= integrate; memcpy(&f->eInt[0], &bits, sizeof(bits));
+    sum = f->eInt[1] + ey; memcpy(&bits, &sum, sizeof(bits)); bits &= integrate; memcpy(&f->eInt[1], &bits, sizeof(bits));
+    sum = f->eInt[2] + ez; memcpy(&bits, &sum, sizeof(bits)); bits &= integrate; memcpy(&f->eInt[2], &bits, sizeof(bits));
+
+    // Apply feedback terms
+    lanef gx = in->gx + f->kp * ex + f->ki * f->eInt[0];
+    lanef gy = in->gy + f->kp * ey + f->ki * f->eInt[1];
+    lanef gz = in->gz + f->kp * ez + f->ki * f->eInt[2];
+
+    // Integrate rate of change of quaternion
+    lanef pa = q2;
+    lanef pb = q3;
+    lanef pc = q4;
+    q1 = q1 + (-q2 * gx - q3 * gy - q4 * gz) * (0.5f * in->deltat);
+    q2 = pa + (q1 * gx + pb * gz - pc * gy) * (0.5f * in->deltat);
+    q3 = pb + (q1 * gy - pa * gz + pc * gx) * (0.5f * in->deltat);
+    q4 = pc + (q1 * gz + pa * gy - pb * gx) * (0.5f * in->deltat);
+
+    // Normalise quaternion
+    lanef norm = invSqrtLanes(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);
+    f->q[0] = q1 * norm;
+    f->q[1] = q2 * norm;
+    f->q[2] = q3 * norm;
+    f->q[3] = q4 * norm;
+}
+
+/** gyroQuaternionUpdate() for FILTER_LANES quaternions (not normalized).
+ */
+static inline void gyroLanesUpdate(lanef *q, const FilterLanesInput *in) {
+    const float gx = in->gx, gy = in->gy, gz = in->gz;
+    const float h = 0.5f * in->deltat;
+    lanef q1 = q[0], q2 = q[1], q3 = q[2], q4 = q[3];
+
+    q[0] = q1 + (-q2 * gx - q3 * gy - q4 * gz) * h;
+    q[1] = q2 + (q1 * gx + q3 * gz - q4 * gy) * h;
+    q[2] = q3 + (q1 * gy - q2 * gz + q4 * gx) * h;
+    q[3] = q4 + (q1 * gz + q2 * gy - q3 * gx) * h;
+}
+
+/** MadgwickCorrection() for FILTER_LANES instances, over in->correctionDeltat.
+ */
+static inline void madgwickLanesCorrection(MadgwickLanes *f, const FilterLanesInput *in) {
+    if (!in->accelValid) return;
+    const float ax = in->ax, ay = in->ay, az = in->az;
+    lanef q1 = f->q[0], q2 = f->q[1], q3 = f->q[2], q4 = f->q[3];
+    lanef s1, s2, s3, s4;
+
+    lanef _2q1 = 2.0f * q1;
+    lanef _2q2 = 2.0f * q2;
+    lanef _2q3 = 2.0f * q3;
+    lanef _2q4 = 2.0f * q4;
+    lanef q1q1 = q1 * q1;
+    lanef q2q2 = q2 * q2;
+    lanef q3q3 = q3 * q3;
+    lanef q4q4 = q4 * q4;
+
+    if (in->useMag) {
+        const float mx = in->mx, my = in->my, mz = in->mz;
+        lanef _2q1q3 = 2.0f * q1 * q3;
+        lanef _2q3q4 = 2.0f * q3 * q4;
+        lanef q1q2 = q1 * q2;
+        lanef q1q3 = q1 * q3;
+        lanef q1q4 = q1 * q4;
+        lanef q2q3 = q2 * q3;
+        lanef q2q4 = q2 * q4;
+        lanef q3q4 = q3 * q4;
+
+        // Reference direction of Earth's magnetic field
+        lanef _2q1mx = 2.0f * q1 * mx;
+        lanef _2q1my = 2.0f * q1 * my;
+        lanef _2q1mz = 2.0f * q1 * mz;
+        lanef _2q2mx = 2.0f * q2 * mx;
+        lanef hx = mx * q1q1 - _2q1my * q4 + _2q1mz * q3 + mx * q2q2 + _2q2 * my * q3 + _2q2 * mz * q4 - mx * q3q3 - mx * q4q4;
+        lanef hy = _2q1mx * q4 + my * q1q1 - _2q1mz * q2 + _2q2mx * q3 - my * q2q2 + my * q3q3 + _2q3 * mz * q4 - my * q4q4;
+        lanef _2bx = hx * hx + hy * hy;
+        _2bx *= invSqrtLanes(_2bx);
+        lanef _2bz = -_2q1mx * q3 + _2q1my * q2 + mz * q1q1 + _2q2mx * q4 - mz * q2q2 + _2q3 * my * q4 - mz * q3q3 + mz * q4q4;
+        lanef _4bx = 2.0f * _2bx;
+        lanef _4bz = 2.0f * _2bz;
+
+        // Gradient decent algorithm corrective step
+        s1 = -_2q3 * (2.0f * q2q4 - _2q1q3 - ax) + _2q2 * (2.0f * q1q2 + _2q3q4 - ay) - _2bz * q3 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (-_2bx * q4 + _2bz * q2) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + _2bx * q3 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+        s2 = _2q4 * (2.0f * q2q4 - _2q1q3 - ax) + _2q1 * (2.0f * q1q2 + _2q3q4 - ay) - 4.0f * q2 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - az) + _2bz * q4 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (_2bx * q3 + _2bz * q1) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + (_2bx * q4 - _4bz * q2) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+        s3 = -_2q1 * (2.0f * q2q4 - _2q1q3 - ax) + _2q4 * (2.0f * q1q2 + _2q3q4 - ay) - 4.0f * q3 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - az) + (-_4bx * q3 - _2bz * q1) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (_2bx * q2 + _2bz * q4) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + (_2bx * q1 - _4bz * q3) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+        s4 = _2q2 * (2.0f * q2q4 - _2q1q3 - ax) + _2q3 * (2.0f * q1q2 + _2q3q4 - ay) + (-_4bx * q4 + _2bz * q2) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (-_2bx * q1 + _2bz * q3) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + _2bx * q2 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+    } else {
+        // accel-only gradient (Madgwick IMU version)
+        lanef _4q1 = 4.0f * q1;
+        lanef _4q2 = 4.0f * q2;
+        lanef _4q3 = 4.0f * q3;
+        lanef _8q2 = 8.0f * q2;
+        lanef _8q3 = 8.0f * q3;
+        s1 = _4q1 * q3q3 + _2q3 * ax + _4q1 * q2q2 - _2q2 * ay;
+        s2 = _4q2 * q4q4 - _2q4 * ax + 4.0f * q1q1 * q2 - _2q1 * ay - _4q2 + _8q2 * q2q2 + _8q2 * q3q3 + _4q2 * az;
+        s3 = 4.0f * q1q1 * q3 + _2q1 * ax + _4q3 * q4q4 - _2q4 * ay - _4q3 + _8q3 * q2q2 + _8q3 * q3q3 + _4q3 * az;
+        s4 = 4.0f * q2q2 * q4 - _2q2 * ax + 4.0f * q3q3 * q4 - _2q3 * ay;
+    }
+    lanef norm = s1 * s1 + s2 * s2 + s3 * s3 + s4 * s4;    // normalise step magnitude
+    lanef zero = {};
+    lanef step = f->beta * in->correctionDeltat * invSqrtLanes(norm);
+    step = norm > 0.0f ? step : zero;                       // no step where the gradient vanishes
+    q1 -= s1 * step;
+    q2 -= s2 * step;
+    q3 -= s3 * step;
+    q4 -= s4 * step;
+    norm = invSqrtLanes(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);    // normalise quaternion
+    f->q[0] = q1 * norm;
+    f->q[1] = q2 * norm;
+    f->q[2] = q3 * norm;
+    f->q[3] = q4 * norm;
+}
+
+/** MahonyCorrection() for FILTER_LANES instances, over in->correctionDeltat.
+ */
+static inline void mahonyLanesCorrection(MahonyLanes *f, const FilterLanesInput *in) {
+    if (!in->accelValid) return;
+    const float ax = in->ax, ay = in->ay, az = in->az;
+    lanef q1 = f->q[0], q2 = f->q[1], q3 = f->q[2], q4 = f->q[3];
+
+    // Auxiliary variables to avoid repeated arithmetic
+    lanef q1q1 = q1 * q1;
+    lanef q1q2 = q1 * q2;
+    lanef q1q3 = q1 * q3;
+    lanef q1q4 = q1 * q4;
+    lanef q2q2 = q2 * q2;
+    lanef q2q3 = q2 * q3;
+    lanef q2q4 = q2 * q4;
+    lanef q3q3 = q3 * q3;
+    lanef q3q4 = q3 * q4;
+    lanef q4q4 = q4 * q4;
+
+    // Estimated direction of gravity
+    lanef vx = 2.0f * (q2q4 - q1q3);
+    lanef vy = 2.0f * (q1q2 + q3q4);
+    lanef vz = q1q1 - q2q2 - q3q3 + q4q4;
+
+    // Error is cross product between estimated direction and measured direction of gravity
+    lanef ex = (ay * vz - az * vy);
+    lanef ey = (az * vx - ax * vz);
+    lanef ez = (ax * vy - ay * vx);
+
+    if (in->useMag) {
+        const float mx = in->mx, my = in->my, mz = in->mz;
+
+        // Reference direction of Earth's magnetic field
+        lanef hx = 2.0f * mx * (0.5f - q3q3 - q4q4) + 2.0f * my * (q2q3 - q1q4) + 2.0f * mz * (q2q4 + q1q3);
+        lanef hy = 2.0f * mx * (q2q3 + q1q4) + 2.0f * my * (0.5f - q2q2 - q4q4) + 2.0f * mz * (q3q4 - q1q2);
+        lanef bx = hx * hx + hy * hy;
+        bx *= invSqrtLanes(bx);
+        lanef bz = 2.0f * mx * (q2q4 - q1q3) + 2.0f * my * (q3q4 + q1q2) + 2.0f * mz * (0.5f - q2q2 - q3q3);
+
+        // Estimated direction of magnetic field
+        lanef wx = 2.0f * bx * (0.5f - q3q3 - q4q4) + 2.0f * bz * (q2q4 - q1q3);
+        lanef wy = 2.0f * bx * (q2q3 - q1q4) + 2.0f * bz * (q1q2 + q3q4);
+        lanef wz = 2.0f * bx * (q1q3 + q2q4) + 2.0f * bz * (0.5f - q2q2 - q3q3);
+
+        ex += (my * wz - mz * wy);
+        ey += (mz * wx - mx * wz);
+        ez += (mx * wy - my * wx);
+    }
+    lanei integrate = f->ki > 0.0f;     // all ones where Ki > 0: accumulate, else hold at zero
+    lanei bits;
+    lanef sum;
+    sum = f->eInt[0] + ex; memcpy(&bits, &sum, sizeof(bits)); bits &= integrate; memcpy(&f->eInt[0], &bits, sizeof(bits));
+    sum = f->eInt[1] + ey; memcpy(&bits, &sum, sizeof(bits)); bits &= integrate; memcpy(&f->eInt[1], &bits, sizeof(bits));
+    sum = f->eInt[2] + ez; memcpy(&bits, &sum, sizeof(bits)); bits &= integrate; memcpy(&f->eInt[2], &bits, sizeof(bits));
+
+    // Apply feedback terms as a rotation over the correction interval
+    lanef gx = f->kp * ex + f->ki * f->eInt[0];
+    lanef gy = f->kp * ey + f->ki * f->eInt[1];
+    lanef gz = f->kp * ez + f->ki * f->eInt[2];
+    const float h = 0.5f * in->correctionDeltat;
+    lanef p1 = q1 + (-q2 * gx - q3 * gy - q4 * gz) * h;
+    lanef p2 = q2 + (q1 * gx + q3 * gz - q4 * gy) * h;
+    lanef p3 = q3 + (q1 * gy - q2 * gz + q4 * gx) * h;
+    lanef p4 = q4 + (q1 * gz + q2 * gy - q3 * gx) * h;
+
+    // Normalise quaternion
+    lanef norm = invSqrtLanes(p1 * p1 + p2 * p2 + p3 * p3 + p4 * p4);
+    f->q[0] = p1 * norm;
+    f->q[1] = p2 * norm;
+    f->q[2] = p3 * norm;
+    f->q[3] = p4 * norm;
+}
+
+#endif /* _FILTER_LANES_H_ */
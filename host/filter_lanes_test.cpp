@@ -0,0 +1,212 @@
+// openCM_AHRS SIMD lane filter check on a Linux host
+//
+// Replays one stream through the scalar filters exactly as ahrs_replay's
+// replay() does and through the lane filters of host/filter_lanes.h as
+// ahrs_sweep does, with lane 0 on the same gains and the other lanes on
+// different ones, and checks lane 0 against the scalar quaternion after
+// every sample:
+//
+//   - MadgwickQuaternionUpdate() / MahonyQuaternionUpdate() on every sample
+//     (ahrs_replay and ahrs_sweep without -n)
+//   - gyroQuaternionUpdate() plus MadgwickCorrection() / MahonyCorrection()
+//     every 5 samples (-n 5), including the IMU-only corrections between
+//     magnetometer samples
+//   - Mahony with Ki = 0 and Ki > 0
+//
+// The stream is the capture given on the command line (any file ahrs_replay
+// reads), or else a synthetic one: 60 s of smooth 3-axis rotation at 1 kHz
+// with the magnetometer fresh every 10th sample, a few dropped sample
+// indices and a stretch of zero magnetometer readings.
+//
+// Lane and scalar code do the same float operations in the same order, so
+// lane 0 must match bit for bit. Build with -ffp-contract=off: otherwise
+// -march=native lets the compiler fuse multiply-adds differently in the two
+// versions, and the IMU-only Madgwick corrections amplify that to ~1e-2.
+//
+//     g++ -O2 -march=native -ffp-contract=off -DI2CDEV_IMPLEMENTATION=I2CDEV_HOST_SIM
+//         -II2Cdev -IMPU9250_master host/filter_lanes_test.cpp -o filter_lanes_test -lm
+//     ./filter_lanes_test [capture]
+//
+// Exits non-zero if lane 0 differs from the scalar quaternion anywhere.
+//
+// 2026-10-17 - initial release
+
+// standard headers first: I2Cdev_host.h defines Arduino-style min()/max() macros
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "I2Cdev.h"
+#include "helper_3dmath.h"
+#include "replay_stream.h"
+#include "filter_lanes.h"
+
+// free parameters read by quaternionFilters.ino (macros/globals in the sketch)
+float beta = sqrt(3.0f / 4.0f) * PI * (40.0f / 180.0f);
+float Kp = 2.0f * 5.0f;
+float Ki = 0.0f;
+float eInt[3] = { 0.0f, 0.0f, 0.0f };
+
+#include "../openCM_AHRS/quaternionFilters.ino"
+
+#define TEST_SAMPLES        60000
+#define TEST_DIVIDER        5           // ahrs_replay -n 5
+
+static uint32 failures = 0;
+
+// world vector into the body frame of orientation q (body to world)
+static void toBody(const double *q, const double *w, double *b) {
+    double qw = q[0], qx = q[1], qy = q[2], qz = q[3];
+    double R[3][3] = {
+        { 1 - 2 * (qy * qy + qz * qz), 2 * (qx * qy + qw * qz), 2 * (qx * qz - qw * qy) },
+        { 2 * (qx * qy - qw * qz), 1 - 2 * (qx * qx + qz * qz), 2 * (qy * qz + qw * qx) },
+        { 2 * (qx * qz + qw * qy), 2 * (qy * qz - qw * qx), 1 - 2 * (qx * qx + qy * qy) }
+    };
+    for (uint8 i = 0; i < 3; i++) b[i] = R[i][0] * w[0] + R[i][1] * w[1] + R[i][2] * w[2];
+}
+
+// synthetic stream in filter units (g, rad/s, mG), sketch axis order
+static void synthesize(ReplayStream *s) {
+    double truth[4] = { 1.0, 0.0, 0.0, 0.0 };
+    uint32 index = 0;
+    srand(1);
+    for (uint32 n = 0; n < TEST_SAMPLES; n++) {
+        double t = n * 1e-3;
+        double w[3] = { 1.5 * sin(t * 0.7), 0.8 * cos(t * 1.3), 2.0 * sin(t * 0.3) };
+        double dq[4] = {
+            0.5 * (-truth[1] * w[0] - truth[2] * w[1] - truth[3] * w[2]),
+            0.5 * (truth[0] * w[0] + truth[2] * w[2] - truth[3] * w[1]),
+            0.5 * (truth[0] * w[1] - truth[1] * w[2] + truth[3] * w[0]),
+            0.5 * (truth[0] * w[2] + truth[1] * w[1] - truth[2] * w[0])
+        };
+        double norm = 0;
+        for (uint8 i = 0; i < 4; i++) {
+            truth[i] += dq[i] * 1e-3;
+            norm += truth[i] * truth[i];
+        }
+        norm = sqrt(norm);
+        for (uint8 i = 0; i < 4; i++) truth[i] /= norm;
+
+        // every 997th sample index is lost (FIFO overflow), as in a real capture
+        if (n % 997 == 996) index++;
+        boolean fresh = n % 10 == 0;
+        boolean magMissing = n >= 30000 && n < 31000;   // zero readings, e.g. magnetometer not answering
+
+        double gravity[3] = { 0, 0, 1 }, field[3] = { 300, 0, -480 }, ab[3], mb[3];
+        toBody(truth, gravity, ab);
+        toBody(truth, field, mb);
+        s->index.push_back(index++);
+        s->micros.push_back(n * 1000 + rand() % 40);
+        for (uint8 i = 0; i < 3; i++) {
+            s->a[i].push_back((float)(ab[i] + (rand() % 21 - 10) / 16384.0));
+            s->g[i].push_back((float)w[i]);
+            s->m[i].push_back(magMissing ? 0.0f : (float)(mb[i] + (rand() % 7 - 3)));
+        }
+        s->magFresh.push_back(fresh);
+    }
+}
+
+// ahrs_replay.cpp replay() without the output
+static void replayScalar(const ReplayStream *s, boolean mahony, uint32 divider, size_t k, float *q,
+        float *correctionDeltat, uint32 *correctionIndex) {
+    float deltat = (s->micros[k] - s->micros[k - 1]) / 1000000.0f;
+    float ax = s->a[0][k], ay = s->a[1][k], az = s->a[2][k];
+    float gx = s->g[0][k], gy = s->g[1][k], gz = s->g[2][k];
+    float mx = s->m[0][k], my = s->m[1][k], mz = s->m[2][k];
+
+    if (divider == 0) {
+        if (mahony) MahonyQuaternionUpdate(ax, ay, az, gx, gy, gz, my, mx, mz, deltat, q);
+        else MadgwickQuaternionUpdate(ax, ay, az, gx, gy, gz, my, mx, mz, deltat, q);
+    } else {
+        gyroQuaternionUpdate(gx, gy, gz, deltat, q);
+        *correctionDeltat += deltat;
+        if (s->index[k] - *correctionIndex < divider) return;
+        *correctionIndex = s->index[k];
+        if (mahony) MahonyCorrection(ax, ay, az, my, mx, mz, s->magFresh[k], *correctionDeltat, q);
+        else MadgwickCorrection(ax, ay, az, my, mx, mz, s->magFresh[k], *correctionDeltat, q);
+        *correctionDeltat = 0.0f;
+    }
+}
+
+/** Run lane 0 and the scalar filter side by side over the stream.
+ * @param name Label for the report
+ * @param mahony Mahony instead of Madgwick
+ * @param ki Mahony integral gain
+ * @param divider 0 for a full update per sample, else corrections every divider samples
+ */
+static void run(const ReplayStream *s, const char *name, boolean mahony, float ki, uint32 divider) {
+    size_t n = s->micros.size();
+    std::vector<FilterLanesInput> inputs(n);
+    uint32 laneIndex = 0;
+    float laneDeltat = 0.0f;
+    for (size_t k = 1; k < n; k++) {
+        filterLanesInput(&inputs[k], s->a[0][k], s->a[1][k], s->a[2][k], s->g[0][k], s->g[1][k], s->g[2][k],
+            s->m[1][k], s->m[0][k], s->m[2][k], (s->micros[k] - s->micros[k - 1]) / 1000000.0f);
+        if (divider) filterLanesSchedule(&inputs[k], s->index[k], s->magFresh[k], divider, &laneIndex, &laneDeltat);
+    }
+
+    // lane 0 on the scalar gains, the others elsewhere so a lane mix-up shows
+    lanef g0, g1;
+    for (uint8 l = 0; l < FILTER_LANES; l++) {
+        g0[l] = (mahony ? Kp : beta) * (1.0f + 0.5f * l);
+        g1[l] = l & 1 ? 0.0f : ki * (1.0f + l);
+    }
+    MadgwickLanes madgwick;
+    MahonyLanes mahonyLanes;
+    madgwickLanesReset(&madgwick, g0);
+    mahonyLanesReset(&mahonyLanes, g0, g1);
+    lanef *laneQ = mahony ? mahonyLanes.q : madgwick.q;
+
+    float q[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    float correctionDeltat = 0.0f;
+    uint32 correctionIndex = 0;
+    Ki = ki;
+    eInt[0] = eInt[1] = eInt[2] = 0.0f;
+
+    double worst = 0, spread = 0;
+    for (size_t k = 1; k < n; k++) {
+        replayScalar(s, mahony, divider, k, q, &correctionDeltat, &correctionIndex);
+        if (divider == 0) {
+            if (mahony) mahonyLanesUpdate(&mahonyLanes, &inputs[k]);
+            else madgwickLanesUpdate(&madgwick, &inputs[k]);
+        } else {
+            gyroLanesUpdate(laneQ, &inputs[k]);
+            if (inputs[k].correct) {
+                if (mahony) mahonyLanesCorrection(&mahonyLanes, &inputs[k]);
+                else madgwickLanesCorrection(&madgwick, &inputs[k]);
+            }
+        }
+        for (uint8 i = 0; i < 4; i++) {
+            worst = fmax(worst, fabs(laneQ[i][0] - q[i]));
+            spread = fmax(spread, fabs(laneQ[i][FILTER_LANES - 1] - q[i]));
+        }
+    }
+    printf("%-24s lane 0 vs scalar %.3g, last lane vs scalar %.3g\n", name, worst, spread);
+    if (worst != 0) {
+        printf("FAIL: %s lane 0 differs from the scalar filter\n", name);
+        failures++;
+    }
+}
+
+int main(int argc, char **argv) {
+    ReplayStream s;
+    if (argc > 1) {
+        if (!loadStream(argv[1], &s)) return 1;
+    } else {
+        synthesize(&s);
+    }
+    if (s.micros.size() < 2) {
+        fprintf(stderr, "no samples\n");
+        return 1;
+    }
+
+    run(&s, "madgwick", false, 0.0f, 0);
+    run(&s, "mahony", true, 0.0f, 0);
+    run(&s, "mahony Ki 0.05", true, 0.05f, 0);
+    run(&s, "madgwick -n 5", false, 0.0f, TEST_DIVIDER);
+    run(&s, "mahony -n 5", true, 0.0f, TEST_DIVIDER);
+    run(&s, "mahony Ki 0.05 -n 5", true, 0.05f, TEST_DIVIDER);
+
+    printf(failures ? "%u failures\n" : "ok\n", failures);
+    return failures ? 1 : 0;
+}
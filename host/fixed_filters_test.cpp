@@ -0,0 +1,217 @@
+// openCM_AHRS fixed-point filter check on a Linux host
+//
+// Runs the Q30 filters in quaternionFiltersFixed.h next to the float ones in
+// quaternionFilters.ino on the same synthetic trajectory (a smooth 3-axis
+// rotation, 1 kHz gyro in raw 250 dps counts, accelerometer and
+// magnetometer as raw counts with noise) and checks the bounds the header
+// states:
+//
+//   - fixedRsqrt() relative error over its whole [1, 4) input range
+//   - MadgwickQuaternionUpdateFixed() and MahonyQuaternionUpdateFixed() on
+//     every sample, and gyroQuaternionUpdateFixed() plus
+//     MadgwickCorrectionFixed()/MahonyCorrectionFixed() every 5th sample
+//     (the sketch's multi-rate scheme, magnetometer every 10th), each
+//     against its float version and against the true orientation
+//   - Mahony with Ki > 0, and the integral saturating at FIXED_EINT_MAX
+//     instead of wrapping
+//
+// The float filters are built with a 3-step invSqrt() (float rounding
+// level) so that the comparison measures the fixed-point error; the
+// sketch's default 2 steps add up to ~1e-5 of their own. Where the gradient
+// direction is ill-conditioned near convergence (combined Mahony with its
+// in-place q1 update, IMU-only Madgwick corrections) float and double
+// versions already differ by up to 5e-3, so those cases get that bound.
+//
+//     g++ -O2 -DI2CDEV_IMPLEMENTATION=I2CDEV_HOST_SIM -II2Cdev -IMPU9250_master
+//         host/fixed_filters_test.cpp -o fixed_filters_test -lm
+//     ./fixed_filters_test
+//
+// Exits non-zero if any bound is exceeded.
+//
+// 2026-10-17 - initial release
+
+// float reference at float rounding level (see above)
+#define HELPER_3DMATH_RSQRT_ITERATIONS 3
+
+// standard headers first: I2Cdev_host.h defines Arduino-style min()/max() macros
+#include <stdio.h>
+#include <stdlib.h>
+#include "I2Cdev.h"
+#include "helper_3dmath.h"
+
+// free parameters read by quaternionFilters.ino (macros/globals in the sketch)
+float beta = sqrt(3.0f / 4.0f) * PI * (40.0f / 180.0f);
+float Kp = 2.0f * 5.0f;
+float Ki = 0.0f;
+float eInt[3] = { 0.0f, 0.0f, 0.0f };
+
+#include "../openCM_AHRS/quaternionFilters.ino"
+#include "../openCM_AHRS/quaternionFiltersFixed.h"
+
+#define TEST_SAMPLES        200000
+#define TEST_DIVIDER        5           // correction every 5th sample, as the sketch
+#define RSQRT_BOUND         3e-9
+#define TRACK_BOUND         5e-6        // |q_float - q_fixed|, well-conditioned cases
+#define ENVELOPE_BOUND      5e-3        // float vs double spread, ill-conditioned cases
+#define TRUTH_BOUND         0.999       // |dot(q, truth)| of both versions
+
+enum Mode { MADGWICK, MAHONY, MADGWICK_SPLIT, MAHONY_SPLIT };
+
+static uint32 failures = 0;
+
+static void check(boolean ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static double rsqrtError() {
+    double worst = 0;
+    for (uint64 k = 0; k < 2000000; k++) {
+        uint32 x = (uint32)(FIXED_ONE + k * ((3ULL << 30) / 2000000));
+        double r = fixedRsqrt(x) / (double)FIXED_ONE;
+        double exact = 1.0 / sqrt(x / (double)FIXED_ONE);
+        worst = fmax(worst, fabs(r / exact - 1.0));
+    }
+    return worst;
+}
+
+// world vector into the body frame of orientation q (body to world)
+static void toBody(const double *q, const double *w, double *b) {
+    double qw = q[0], qx = q[1], qy = q[2], qz = q[3];
+    double R[3][3] = {
+        { 1 - 2 * (qy * qy + qz * qz), 2 * (qx * qy + qw * qz), 2 * (qx * qz - qw * qy) },
+        { 2 * (qx * qy - qw * qz), 1 - 2 * (qx * qx + qz * qz), 2 * (qy * qz + qw * qx) },
+        { 2 * (qx * qz + qw * qy), 2 * (qy * qz - qw * qx), 1 - 2 * (qx * qx + qy * qy) }
+    };
+    for (uint8 i = 0; i < 3; i++) b[i] = R[i][0] * w[0] + R[i][1] * w[1] + R[i][2] * w[2];
+}
+
+/** Run one filter pair over the trajectory.
+ * @param name Label for the report
+ * @param mode Filter and scheme
+ * @param ki Mahony integral gain
+ * @param bound Largest allowed |q_float - q_fixed| component
+ */
+static void run(const char *name, Mode mode, float ki, double bound) {
+    const float gRes = 250.0f / 32768.0f;
+    const int32 gyroScaleFixed = (int32)(gRes * PI / 180.0f * 1099511627776.0f);  // * 2^40, as the sketch
+    const int32 betaFixed = fixedFromFloat(beta, 30);
+    const int32 kpFixed = fixedFromFloat(Kp, 16);
+    const int32 kiFixed = fixedFromFloat(ki, 16);
+    const float deltat = 0.001f;
+    const int32 deltatFixed = fixedDeltat(1000);
+
+    float q[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    int32 qFixed[4] = { FIXED_ONE, 0, 0, 0 };
+    int32 eIntFixed[3] = { 0, 0, 0 };
+    double truth[4] = { 1.0, 0.0, 0.0, 0.0 };
+    Ki = ki;
+    eInt[0] = eInt[1] = eInt[2] = 0.0f;
+    srand(1);
+
+    double worst = 0;
+    for (uint32 n = 0; n < TEST_SAMPLES; n++) {
+        double t = n * 1e-3;
+        double w[3] = { 1.5 * sin(t * 0.7), 0.8 * cos(t * 1.3), 2.0 * sin(t * 0.3) };
+        double dq[4] = {
+            0.5 * (-truth[1] * w[0] - truth[2] * w[1] - truth[3] * w[2]),
+            0.5 * (truth[0] * w[0] + truth[2] * w[2] - truth[3] * w[1]),
+            0.5 * (truth[0] * w[1] - truth[1] * w[2] + truth[3] * w[0]),
+            0.5 * (truth[0] * w[2] + truth[1] * w[1] - truth[2] * w[0])
+        };
+        double norm = 0;
+        for (uint8 i = 0; i < 4; i++) {
+            truth[i] += dq[i] * 1e-3;
+            norm += truth[i] * truth[i];
+        }
+        norm = sqrt(norm);
+        for (uint8 i = 0; i < 4; i++) truth[i] /= norm;
+
+        // raw sensor counts: 2 g accel (16384/g), ~600 count field, 250 dps gyro
+        double gravity[3] = { 0, 0, 1 }, field[3] = { 0.5, 0, -0.8 }, ab[3], mb[3];
+        toBody(truth, gravity, ab);
+        toBody(truth, field, mb);
+        int32 a[3], m[3], g[3];
+        float af[3], mf[3], gf[3];
+        for (uint8 i = 0; i < 3; i++) {
+            a[i] = (int32)lrint(ab[i] * 16384 + (rand() % 21 - 10));
+            m[i] = (int32)lrint(mb[i] * 600 + (rand() % 7 - 3));
+            int16 raw = (int16)lrint(w[i] * 180 / PI / gRes);
+            af[i] = a[i];
+            mf[i] = m[i];
+            gf[i] = raw * gRes * PI / 180.0f;
+            g[i] = (int32)(((int64)raw * gyroScaleFixed) >> 16);
+        }
+
+        if (mode == MADGWICK) {
+            MadgwickQuaternionUpdate(af[0], af[1], af[2], gf[0], gf[1], gf[2], mf[0], mf[1], mf[2], deltat, q);
+            MadgwickQuaternionUpdateFixed(a[0], a[1], a[2], g[0], g[1], g[2], m[0], m[1], m[2], deltatFixed, betaFixed, qFixed);
+        } else if (mode == MAHONY) {
+            MahonyQuaternionUpdate(af[0], af[1], af[2], gf[0], gf[1], gf[2], mf[0], mf[1], mf[2], deltat, q);
+            MahonyQuaternionUpdateFixed(a[0], a[1], a[2], g[0], g[1], g[2], m[0], m[1], m[2], deltatFixed, kpFixed, kiFixed, eIntFixed, qFixed);
+        } else {
+            gyroQuaternionUpdate(gf[0], gf[1], gf[2], deltat, q);
+            gyroQuaternionUpdateFixed(g[0], g[1], g[2], deltatFixed, qFixed);
+            if (n % TEST_DIVIDER == TEST_DIVIDER - 1) {
+                boolean useMag = n % (2 * TEST_DIVIDER) == 2 * TEST_DIVIDER - 1;
+                if (mode == MADGWICK_SPLIT) {
+                    MadgwickCorrection(af[0], af[1], af[2], mf[0], mf[1], mf[2], useMag, deltat * TEST_DIVIDER, q);
+                    MadgwickCorrectionFixed(a[0], a[1], a[2], m[0], m[1], m[2], useMag, deltatFixed * TEST_DIVIDER, betaFixed, qFixed);
+                } else {
+                    MahonyCorrection(af[0], af[1], af[2], mf[0], mf[1], mf[2], useMag, deltat * TEST_DIVIDER, q);
+                    MahonyCorrectionFixed(a[0], a[1], a[2], m[0], m[1], m[2], useMag, deltatFixed * TEST_DIVIDER, kpFixed, kiFixed, eIntFixed, qFixed);
+                }
+            }
+        }
+
+        for (uint8 i = 0; i < 4; i++) worst = fmax(worst, fabs(q[i] - fixedToFloat(qFixed[i], 30)));
+    }
+
+    double dot = 0, dotFixed = 0;
+    for (uint8 i = 0; i < 4; i++) {
+        dot += q[i] * truth[i];
+        dotFixed += fixedToFloat(qFixed[i], 30) * truth[i];
+    }
+    printf("%-24s max |q_float - q_fixed| %.3g (bound %.0e), |dot(q, truth)| float %.6f fixed %.6f\n",
+        name, worst, bound, fabs(dot), fabs(dotFixed));
+    check(worst <= bound, name);
+    check(fabs(dot) > TRUTH_BOUND && fabs(dotFixed) > TRUTH_BOUND, name);
+}
+
+// a persistent error larger than the filter can ever remove must pin the
+// integral at the limit, not wrap it to the opposite sign
+static void integralSaturation() {
+    int32 e[3] = { 2L << FIXED_GRAD_FRAC, -(2L << FIXED_GRAD_FRAC), 1L << (FIXED_GRAD_FRAC - 4) };
+    int32 eIntFixed[3] = { 0, 0, 0 };
+    int32 kpFixed = fixedFromFloat(Kp, 16), kiFixed = fixedFromFloat(0.5f, 16);
+    boolean ok = true;
+    for (uint32 n = 0; n < 100000; n++) {
+        int32 g[3] = { 0, 0, 0 };
+        mahonyFeedbackFixed(e, kpFixed, kiFixed, eIntFixed, g);
+        for (uint8 i = 0; i < 3; i++) {
+            if (eIntFixed[i] > FIXED_EINT_MAX || eIntFixed[i] < -FIXED_EINT_MAX) ok = false;
+            if ((eIntFixed[i] < 0) != (e[i] < 0)) ok = false;
+        }
+    }
+    printf("Mahony integral           %d %d %d after 100000 updates (limit %ld)\n",
+        eIntFixed[0], eIntFixed[1], eIntFixed[2], FIXED_EINT_MAX);
+    check(ok && eIntFixed[0] == FIXED_EINT_MAX && eIntFixed[1] == -FIXED_EINT_MAX, "Mahony integral saturation");
+}
+
+int main() {
+    double rsqrt = rsqrtError();
+    printf("fixedRsqrt                max relative error %.3g (bound %.0e)\n", rsqrt, RSQRT_BOUND);
+    check(rsqrt <= RSQRT_BOUND, "fixedRsqrt");
+
+    run("Madgwick", MADGWICK, 0.0f, TRACK_BOUND);
+    run("Mahony", MAHONY, 0.0f, ENVELOPE_BOUND);
+    run("Madgwick split", MADGWICK_SPLIT, 0.0f, ENVELOPE_BOUND);
+    run("Mahony split", MAHONY_SPLIT, 0.0f, TRACK_BOUND);
+    run("Mahony split, Ki 0.5", MAHONY_SPLIT, 0.5f, TRACK_BOUND);
+    integralSaturation();
+
+    printf(failures ? "%u failures\n" : "ok\n", failures);
+    return failures ? 1 : 0;
+}
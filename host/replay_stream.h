@@ -0,0 +1,168 @@
+// openCM_AHRS recorded sensor stream loader (Linux host tools)
+// Shared by host/ahrs_replay.cpp and host/ahrs_sweep.cpp. Reads the binary
+// log written by the sketch's SerialRecord option (host/sensor_log.h) and
+// the older text format described in ahrs_replay.cpp.
+//
+// Include after I2Cdev.h (libmaple integer types) and <vector>.
+//
+// 2026-10-17 - initial release
+
+#ifndef _REPLAY_STREAM_H_
+#define _REPLAY_STREAM_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sensor_log.h"
+
+/** Sensor stream converted to filter units (g, rad/s, mG), one array per
+ * quantity so the replay loop walks memory sequentially.
+ */
+struct ReplayStream {
+    std::vector<uint32> index;
+    std::vector<uint32> micros;
+    std::vector<float> a[3];
+    std::vector<float> g[3];
+    std::vector<float> m[3];
+    std::vector<uint8> magFresh;
+};
+
+struct ReplayScale {
+    float aRes, gRes, mRes;
+    float cal[3], bias[3];
+};
+
+static inline uint64 nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// whole input, NUL-terminated; 0 if memory runs out (*length = bytes read so far)
+static char *readAll(FILE *f, size_t *length) {
+    size_t size = 1 << 20, used = 0;
+    char *buf = (char *)malloc(size + 1);
+    size_t n;
+    while (buf != 0 && (n = fread(buf + used, 1, size - used, f)) > 0) {
+        used += n;
+        if (used == size) {
+            size *= 2;
+            char *grown = (char *)realloc(buf, size + 1);
+            if (grown == 0) free(buf);
+            buf = grown;
+        }
+    }
+    *length = used;
+    if (buf != 0) buf[used] = 0;
+    return buf;
+}
+
+// parse one sample line; false if it is not one
+static boolean parseSample(const char *p, int32 *field) {
+    for (uint8 k = 0; k < 12; k++) {
+        char *end;
+        field[k] = (int32)strtol(p, &end, 10);
+        if (end == p) return false;
+        p = end;
+    }
+    while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+    return *p == '\n' || *p == 0;
+}
+
+static void appendSample(ReplayStream *s, const ReplayScale *scale, const SensorSample *sample) {
+    s->index.push_back(sample->index);
+    s->micros.push_back(sample->captureMicros);
+    for (uint8 k = 0; k < 3; k++) {
+        s->a[k].push_back((float)sample->accel[k]*scale->aRes);
+        s->g[k].push_back((float)sample->gyro[k]*scale->gRes*PI/180.0f);
+        s->m[k].push_back((float)sample->mag[k]*scale->mRes*scale->cal[k] - scale->bias[k]);
+    }
+    s->magFresh.push_back(sample->magFresh);
+}
+
+// text format, from a NUL-terminated buffer
+static void loadStreamText(char *buf, size_t length, ReplayStream *s) {
+    // sketch defaults (AFS_2G, GFS_250DPS, MFS_16BITS) until a scale line is seen
+    ReplayScale scale = { 2.0f/32768.0f, 250.0f/32768.0f, 10.0f*4219.0f/32760.0f, { 1, 1, 1 }, { 0, 0, 0 } };
+    boolean haveScale = false;
+    int32 field[12];
+    SensorSample sample;
+
+    for (char *line = buf; line < buf + length; ) {
+        char *next = strchr(line, '\n');
+        next = next ? next + 1 : buf + length;
+        if (sscanf(line, "# scale %f %f %f %f %f %f %f %f %f", &scale.aRes, &scale.gRes, &scale.mRes,
+                &scale.cal[0], &scale.cal[1], &scale.cal[2], &scale.bias[0], &scale.bias[1], &scale.bias[2]) == 9) {
+            haveScale = true;
+        } else if (line[0] >= '0' && line[0] <= '9' && parseSample(line, field)) {
+            sample.index = (uint32)field[0];
+            sample.captureMicros = (uint32)field[1];
+            for (uint8 k = 0; k < 3; k++) {
+                sample.accel[k] = (int16)field[2 + k];
+                sample.gyro[k] = (int16)field[5 + k];
+                sample.mag[k] = (int16)field[8 + k];
+            }
+            sample.magFresh = field[11] != 0;
+            appendSample(s, &scale, &sample);
+        }
+        line = next;
+    }
+    if (!haveScale) fprintf(stderr, "no '# scale' line, using the sketch's default resolutions\n");
+}
+
+// binary format, through the log's (possibly mapped) iterator
+static void loadStreamLog(SensorLogReader *log, ReplayStream *s) {
+    SensorSample sample;
+    ReplayScale scale;
+    while (log->next(&sample)) {
+        const SensorLogHeader *h = log->header();
+        scale.aRes = h->aRes;
+        scale.gRes = h->gRes;
+        scale.mRes = h->mRes;
+        memcpy(scale.cal, h->magCalibration, sizeof(scale.cal));
+        memcpy(scale.bias, h->magBias, sizeof(scale.bias));
+        appendSample(s, &scale, &sample);
+    }
+    if (log->skipped() || log->bad() || log->headerCount() > 1) {
+        fprintf(stderr, "log: %u bytes skipped, %u bad frames, %u headers\n",
+            log->skipped(), log->bad(), log->headerCount());
+    }
+}
+
+/** Load a recording, binary log or text.
+ * A file is memory-mapped and read in place when it holds a binary log;
+ * stdin is read into memory first.
+ * @param path File name, or 0 / "-" for stdin
+ * @param s Stream to append to
+ * @return False if the input could not be read
+ */
+static boolean loadStream(const char *path, ReplayStream *s) {
+    SensorLogReader log;
+    FILE *f = stdin;
+    if (path != 0 && strcmp(path, "-") != 0) {
+        if (log.open(path)) {
+            loadStreamLog(&log, s);
+            return true;
+        }
+        f = fopen(path, "rb");
+        if (f == 0) {
+            perror(path);
+            return false;
+        }
+    }
+    size_t length;
+    char *buf = readAll(f, &length);
+    if (f != stdin) fclose(f);
+    if (buf == 0) {
+        fprintf(stderr, "%s: out of memory after %lu bytes\n", path ? path : "stdin", (unsigned long)length);
+        return false;
+    }
+    if (log.attach((const uint8 *)buf, length)) loadStreamLog(&log, s);
+    else loadStreamText(buf, length, s);
+    log.close();
+    free(buf);
+    return true;
+}
+
+#endif /* _REPLAY_STREAM_H_ */
@@ -0,0 +1,101 @@
+// invSqrt() accuracy and speed check on a Linux host
+//
+// Compares helper_3dmath.h's invSqrt() at 0..3 Newton-Raphson steps with
+// 1.0f/sqrtf(x) from libm: worst-case relative error against a double
+// reference over every 64th normal float, and time per call over a buffer
+// of typical normalization inputs (sums of squares of unit-ish vectors and
+// raw sensor counts).
+//
+//     g++ -O2 -DI2CDEV_IMPLEMENTATION=I2CDEV_HOST_SIM -II2Cdev -IMPU9250_master
+//         host/rsqrt_bench.cpp -o rsqrt_bench -lm
+//
+// 2026-10-17 - initial release
+
+#include "I2Cdev.h"
+#include "helper_3dmath.h"
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC
+#endif
+
+#define BENCH_SAMPLES   4096
+#define BENCH_ROUNDS    4096
+
+static float inputs[BENCH_SAMPLES];
+static volatile float sink;
+
+static double worstError(uint8 iterations) {
+    double worst = 0;
+    union { float f; uint32 i; } u;
+    // normal floats only: exponent field 1..254
+    for (uint32 bits = 0x00800000; bits < 0x7F800000; bits += 64) {
+        u.i = bits;
+        double exact = 1.0 / sqrt((double)u.f);
+        double err = fabs(invSqrt(u.f, iterations) / exact - 1.0);
+        if (err > worst) worst = err;
+    }
+    return worst;
+}
+
+static uint64 nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+template <typename F>
+static void timeKernel(const char *name, F kernel) {
+    float acc = 0;
+    uint64 t0 = nowNanos();
+#ifdef BENCH_HAVE_TSC
+    uint64 c0 = __rdtsc();
+#endif
+    for (uint32 r = 0; r < BENCH_ROUNDS; r++) {
+        for (uint32 k = 0; k < BENCH_SAMPLES; k++) acc += kernel(inputs[k]);
+    }
+#ifdef BENCH_HAVE_TSC
+    uint64 c1 = __rdtsc();
+#endif
+    uint64 t1 = nowNanos();
+    sink = acc;
+    double calls = (double)BENCH_ROUNDS * BENCH_SAMPLES;
+    printf("  %-22s %7.3f ns/call", name, (t1 - t0) / calls);
+#ifdef BENCH_HAVE_TSC
+    printf("  %7.2f TSC cycles/call", (c1 - c0) / calls);
+#endif
+    printf("\n");
+}
+
+int main() {
+    printf("worst relative error (normal floats):\n");
+    for (uint8 n = 0; n <= 3; n++) {
+        printf("  invSqrt, %u step%s        %.3g\n", n, n == 1 ? " " : "s", worstError(n));
+    }
+    printf("  1.0f/sqrtf            %.3g\n", [] {
+        double worst = 0;
+        union { float f; uint32 i; } u;
+        for (uint32 bits = 0x00800000; bits < 0x7F800000; bits += 64) {
+            u.i = bits;
+            double err = fabs((1.0f / sqrtf(u.f)) * sqrt((double)u.f) - 1.0);
+            if (err > worst) worst = err;
+        }
+        return worst;
+    }());
+
+    // unit quaternion/vector norms drift around 1; accel/mag sums of squares of raw counts
+    uint32 seed = 1;
+    for (uint32 k = 0; k < BENCH_SAMPLES; k++) {
+        seed = seed * 1664525 + 1013904223;
+        float r = (seed >> 8) / 16777216.0f;
+        inputs[k] = (k & 1) ? 0.98f + 0.04f * r : 1.0e6f + 1.0e9f * r;
+    }
+    printf("time per call (%u calls):\n", BENCH_ROUNDS * BENCH_SAMPLES);
+    timeKernel("1.0f/sqrtf", [](float x) { return 1.0f / sqrtf(x); });
+    timeKernel("invSqrt, 1 step", [](float x) { return invSqrt(x, 1); });
+    timeKernel("invSqrt, 2 steps", [](float x) { return invSqrt(x, 2); });
+    timeKernel("invSqrt, 3 steps", [](float x) { return invSqrt(x, 3); });
+    return 0;
+}
@@ -0,0 +1,137 @@
+// openCM_AHRS binary sensor log reader (Linux host)
+//
+// Memory-maps a log written by the sketch's SerialRecord option (format in
+// openCM_AHRS/sensorLog.h) and iterates over its samples without copying the
+// file. Frames are located by their sync bytes and accepted only with a good
+// CRC, so a capture with dropped bytes or interleaved text output still
+// yields every intact sample; the skipped byte and bad frame counts say how
+// much was lost.
+//
+//     SensorLogReader log;
+//     SensorSample s;
+//     if (log.open("capture.bin")) {
+//         while (log.next(&s)) use(log.header(), &s);
+//     }
+//
+// Include after I2Cdev.h (libmaple integer types).
+//
+// 2026-10-17 - initial release
+
+#ifndef _SENSOR_LOG_READER_H_
+#define _SENSOR_LOG_READER_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../openCM_AHRS/sensorLog.h"
+
+class SensorLogReader {
+    public:
+        SensorLogReader() : data(0), length(0), position(0), mapped(false), haveHeader(false),
+            skippedBytes(0), badFrames(0), headers(0) {}
+        ~SensorLogReader() { close(); }
+
+        /** Map a log file and find its first header.
+         * @param path File name
+         * @return True if the file contains at least one valid header
+         */
+        boolean open(const char *path) {
+            close();
+            int fd = ::open(path, O_RDONLY);
+            if (fd < 0) return false;
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void *p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    madvise(p, st.st_size, MADV_SEQUENTIAL);
+                    data = (const uint8 *)p;
+                    length = st.st_size;
+                    mapped = true;
+                }
+            }
+            ::close(fd);
+            return data != 0 && rewind();
+        }
+
+        /** Read from a buffer already in memory (e.g. stdin), not owned.
+         * @return True if the buffer contains at least one valid header
+         */
+        boolean attach(const uint8 *buffer, size_t size) {
+            close();
+            data = buffer;
+            length = size;
+            return rewind();
+        }
+
+        void close() {
+            if (mapped) munmap((void *)data, length);
+            data = 0;
+            length = 0;
+            mapped = false;
+            haveHeader = false;
+        }
+
+        /** Go back to the first header.
+         * @return True if there is one
+         */
+        boolean rewind() {
+            position = 0;
+            skippedBytes = badFrames = headers = 0;
+            haveHeader = false;
+            while (position + SENSOR_LOG_HEADER_SIZE <= length) {
+                if (sensorLogDecodeHeader(data + position, &current)) {
+                    position += SENSOR_LOG_HEADER_SIZE;
+                    haveHeader = true;
+                    headers = 1;
+                    return true;
+                }
+                position++;
+            }
+            return false;
+        }
+
+        /** Advance to the next intact sample.
+         * A header met on the way (sketch restarted) replaces header().
+         * @param s Decoded sample
+         * @return False at the end of the log
+         */
+        boolean next(SensorSample *s) {
+            while (position + SENSOR_LOG_RECORD_SIZE <= length) {
+                const uint8 *p = data + position;
+                if (p[0] == SENSOR_LOG_RECORD_SYNC) {
+                    if (sensorLogDecodeSample(p, s)) {
+                        position += SENSOR_LOG_RECORD_SIZE;
+                        return true;
+                    }
+                    badFrames++;
+                } else if (p[0] == 'A' && position + SENSOR_LOG_HEADER_SIZE <= length
+                        && sensorLogDecodeHeader(p, &current)) {
+                    position += SENSOR_LOG_HEADER_SIZE;
+                    headers++;
+                    continue;
+                }
+                position++;
+                skippedBytes++;
+            }
+            return false;
+        }
+
+        const SensorLogHeader *header() const { return haveHeader ? &current : 0; }
+        uint32 headerCount() const { return headers; }
+        uint32 skipped() const { return skippedBytes; }
+        uint32 bad() const { return badFrames; }
+
+    private:
+        const uint8 *data;
+        size_t length;
+        size_t position;
+        boolean mapped;
+        boolean haveHeader;
+        SensorLogHeader current;
+        uint32 skippedBytes;
+        uint32 badFrames;
+        uint32 headers;
+};
+
+#endif /* _SENSOR_LOG_READER_H_ */
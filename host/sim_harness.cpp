@@ -0,0 +1,180 @@
+// MPU9250 driver harness on the I2Cdev host simulation
+//
+// Runs MPU9250.cpp against the MPU9250Sim/AK8963Sim models (see
+// MPU9250_master/MPU9250_sim.h) on the virtual clock, so every figure it
+// prints is deterministic and repeatable on any Linux PC:
+//
+//   - getMotion9() with and without magnetometer auto-fetch, and the
+//     AK8963 status it reports; mode changes go through power-down
+//   - DMP firmware load with writeProgMemoryBlock() (per-chunk verify) and
+//     writeProgMemoryImage() (burst write, one readback per bank), checked
+//     against the model's DMP memory
+//   - cold dmpInitialize(), warm dmpInitialize() after an MCU reset (with
+//     the FIFO rate in DMP data RAM changed, as an application may), and a
+//     cold one again after a power cycle
+//   - the non-blocking dmpInitBegin()/dmpInitStep() API with other work
+//     between the calls: number of calls and longest single call
+//
+//     g++ -O2 -DI2CDEV_IMPLEMENTATION=I2CDEV_HOST_SIM -II2Cdev -IMPU9250_master
+//         I2Cdev/*.cpp MPU9250_master/*.cpp host/sim_harness.cpp -o sim_harness
+//     ./sim_harness
+//
+// Exits non-zero if any step fails.
+//
+// 2026-10-17 - initial release
+
+// standard headers first: I2Cdev_host.h defines Arduino-style min()/max() macros
+#include <stdio.h>
+#include "MPU9250.h"
+#include "MPU9250_sim.h"
+
+static MPU9250Sim imu;
+static AK8963Sim mag;
+static uint32 failures = 0;
+
+static void check(boolean ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static uint32 memoryMismatches() {
+    uint32 bad = 0;
+    for (uint16 i = 0; i < MPU9250_DMP_CODE_SIZE; i++) {
+        if (imu.getMemory(i >> 8, i & 0xFF) != dmpMemory[i]) bad++;
+    }
+    return bad;
+}
+
+// the DMP is running and its first packet decodes to a unit quaternion
+static boolean dmpStreaming(MPU9250 *mpu) {
+    mpu->setDMPEnabled(true);
+    delay(100);
+    uint16 count = mpu->getFIFOCount();
+    if (count < mpu->dmpGetFIFOPacketSize()) return false;
+    uint8 packet[48];
+    mpu->getFIFOBytes(packet, 48);
+    Quaternion q;
+    mpu->dmpGetQuaternion(&q, packet);
+    return fabs(q.getMagnitude() - 1.0f) < 0.01f;
+}
+
+static void motion9() {
+    MPU9250 mpu;
+    mpu.initialize();
+    delay(20);
+    int16 ax, ay, az, gx, gy, gz, mx, my, mz;
+    boolean fresh = mpu.getMotion9(&ax, &ay, &az, &gx, &gy, &gz, &mx, &my, &mz);
+    printf("motion9: a %d %d %d  g %d %d %d  m %d %d %d\n", ax, ay, az, gx, gy, gz, mx, my, mz);
+    check(az > 15000 && az < 17000, "getMotion9 accel z is not 1 g");
+    check(fresh && mpu.getMagStatus() == MPU9250_MAG_STATUS_DRDY, "getMotion9 single measurement status");
+
+    // auto-fetch at a 1 kHz sample rate: reading every sample for 100 ms
+    // sees each of the AK8963's 100 Hz measurements exactly once
+    mpu.setDLPFMode(MPU9250_DLPF_BW_188);
+    mpu.setRate(0);
+    check(mpu.setMagAutoFetchEnabled(true), "setMagAutoFetchEnabled");
+    delay(20);
+    uint32 fresh9 = 0;
+    for (uint8 i = 0; i < 100; i++) {
+        delay(1);
+        if (mpu.getMotion9(&ax, &ay, &az, &gx, &gy, &gz, &mx, &my, &mz)) fresh9++;
+    }
+    printf("motion9 auto-fetch: %u new magnetometer samples in 100 ms\n", fresh9);
+    check(fresh9 == 10, "getMotion9 auto-fetch status");
+
+    // disabling powers the AK8963 down, and the single measurement fallback
+    // works again from there
+    check(mpu.setMagAutoFetchEnabled(false) && mag.readRegister(0x0A) == MPU9250_MAG_MODE_POWER_DOWN,
+        "setMagAutoFetchEnabled(false) powers the magnetometer down");
+    fresh = mpu.getMotion9(&ax, &ay, &az, &gx, &gy, &gz, &mx, &my, &mz);
+    check(fresh, "getMotion9 single measurement after auto-fetch");
+}
+
+static void imageLoad() {
+    MPU9250 mpu;
+    imu.reset();
+    mpu.initialize();
+    uint32 t0 = micros();
+    boolean ok = mpu.writeProgMemoryBlock(dmpMemory, MPU9250_DMP_CODE_SIZE);
+    uint32 block = micros() - t0;
+    check(ok && memoryMismatches() == 0, "writeProgMemoryBlock");
+
+    imu.reset();
+    mpu.initialize();
+    t0 = micros();
+    ok = mpu.writeProgMemoryImage(dmpMemory, MPU9250_DMP_CODE_SIZE);
+    uint32 image = micros() - t0;
+    check(ok && memoryMismatches() == 0, "writeProgMemoryImage");
+    printf("firmware load: writeProgMemoryBlock %u us, writeProgMemoryImage %u us\n", block, image);
+}
+
+// dmpConfig[] FIFO rate block, in DMP data RAM below MPU9250_DMP_CODE_START
+#define FIFO_RATE_BANK      0x02
+#define FIFO_RATE_ADDRESS   0x16
+
+static void initialize(const char *what, boolean expectWarm) {
+    MPU9250 mpu;
+    mpu.initialize();
+    uint8 rate[2] = { imu.getMemory(FIFO_RATE_BANK, FIFO_RATE_ADDRESS), imu.getMemory(FIFO_RATE_BANK, FIFO_RATE_ADDRESS + 1) };
+    if (expectWarm) {
+        uint8 changed[2] = { 0x00, 0x09 };
+        mpu.writeMemoryBlock(changed, 2, FIFO_RATE_BANK, FIFO_RATE_ADDRESS);
+    }
+    boolean resident = mpu.dmpFirmwareResident();
+    uint32 t0 = micros();
+    uint8 status = mpu.dmpInitialize();
+    uint32 took = micros() - t0;
+    printf("dmpInitialize (%s): status %u, %s, %u us\n", what, status, resident ? "warm" : "cold", took);
+    check(status == 0, "dmpInitialize status");
+    check(resident == expectWarm, "warm start probe");
+    if (expectWarm) {
+        check(imu.getMemory(FIFO_RATE_BANK, FIFO_RATE_ADDRESS) == rate[0]
+            && imu.getMemory(FIFO_RATE_BANK, FIFO_RATE_ADDRESS + 1) == rate[1], "warm start restores DMP data RAM configuration");
+    }
+    check(dmpStreaming(&mpu), "DMP packets after dmpInitialize");
+}
+
+static void stepped(const char *what) {
+    MPU9250 mpu;
+    mpu.initialize();
+    mpu.dmpInitBegin();
+    uint32 calls = 0, worst = 0, t0 = micros();
+    uint8 status;
+    do {
+        uint32 t = micros();
+        status = mpu.dmpInitStep();
+        t = micros() - t;
+        if (t > worst) worst = t;
+        calls++;
+        delayMicroseconds(200); // rest of the control loop
+    } while (status == MPU9250_DMP_INIT_BUSY);
+    printf("dmpInitStep (%s): status %u, %u calls, longest %u us, %u us in all\n",
+        what, status, calls, worst, micros() - t0);
+    check(status == 0 && mpu.dmpInitProgress() == 100, "dmpInitStep status");
+    check(dmpStreaming(&mpu), "DMP packets after dmpInitStep");
+}
+
+int main() {
+    imu.attachMag(&mag);
+    Wire.attach(&imu);
+    Wire.attach(&mag);
+    Wire.setClock(400000);
+
+    motion9();
+    imageLoad();
+
+    imu.reset();
+    initialize("power-on", false);
+    initialize("MCU reset", true);
+    imu.reset();
+    initialize("power cycle", false);
+
+    imu.reset();
+    stepped("power-on");
+    stepped("MCU reset");
+
+    printf(failures ? "%u failures\n" : "ok\n", failures);
+    return failures ? 1 : 0;
+}
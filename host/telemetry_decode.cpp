@@ -0,0 +1,92 @@
+// openCM_AHRS telemetry decoder (Linux host)
+//
+// Reads the COBS-framed binary telemetry the sketch sends on SerialUSB when
+// SerialDebug is set (format in openCM_AHRS/telemetry.h) and prints one line
+// per frame. Frames with a bad CRC are dropped and gaps in the frame counter
+// are reported, so a noisy or overrun link is visible.
+//
+//     g++ -O2 -DI2CDEV_IMPLEMENTATION=I2CDEV_HOST_SIM -II2Cdev
+//         host/telemetry_decode.cpp -o telemetry_decode
+//     stty -F /dev/ttyACM0 raw && ./telemetry_decode /dev/ttyACM0
+//
+// Options:
+//     -c       CSV instead of the old SerialDebug text layout
+//
+// 2026-10-17 - initial release
+
+// standard headers first: I2Cdev_host.h defines Arduino-style min()/max() macros
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "I2Cdev.h"
+#include "../openCM_AHRS/telemetry.h"
+
+static void printFrame(const TelemetryFrame *t, boolean csv) {
+    if (csv) {
+        printf("%u,%u,%.5f,%.5f,%.5f,%.5f,%.2f,%.2f,%.2f,%d,%d,%d,%d,%d,%d,%d,%d,%d,%.1f,%.1f,%u,%u,%u\n",
+            t->seq, t->captureMicros, t->q[0], t->q[1], t->q[2], t->q[3], t->ypr[0], t->ypr[1], t->ypr[2],
+            t->accel[0], t->accel[1], t->accel[2], t->gyro[0], t->gyro[1], t->gyro[2],
+            t->mag[0], t->mag[1], t->mag[2], t->rate, t->correctionRate,
+            t->latencyAvg, t->latencyMax, t->dropped);
+    } else {
+        printf("Yaw(Z), Pitch(Y), Roll(X): %.2f, %.2f, %.2f\n", t->ypr[0], t->ypr[1], t->ypr[2]);
+        printf("rate = %.1f Hz, correction = %.1f Hz\n", t->rate, t->correctionRate);
+        printf("latency avg/max = %u / %u us, dropped = %u\n\n", t->latencyAvg, t->latencyMax, t->dropped);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    boolean csv = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "c")) != -1) {
+        switch (opt) {
+            case 'c': csv = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-c] [file|device]\n", argv[0]);
+                return 2;
+        }
+    }
+    FILE *f = stdin;
+    if (optind < argc && strcmp(argv[optind], "-") != 0) {
+        f = fopen(argv[optind], "rb");
+        if (f == 0) {
+            perror(argv[optind]);
+            return 1;
+        }
+    }
+    if (csv) {
+        printf("seq,captureMicros,q0,q1,q2,q3,yaw,pitch,roll,ax,ay,az,gx,gy,gz,mx,my,mz,"
+            "rate,correctionRate,latencyAvg,latencyMax,dropped\n");
+    }
+
+    uint8 frame[TELEMETRY_FRAME_MAX];
+    uint32 length = 0;
+    uint32 frames = 0, bad = 0, lost = 0;
+    boolean haveSeq = false;
+    uint8 lastSeq = 0;
+    TelemetryFrame t;
+    int c;
+    while ((c = getc(f)) != EOF) {
+        if (c != 0) {
+            if (length < sizeof(frame)) frame[length] = c;
+            length++;
+            continue;
+        }
+        if (length == 0) continue;
+        if (length <= sizeof(frame) && telemetryDecode(frame, length, &t)) {
+            if (haveSeq) lost += (uint8)(t.seq - lastSeq - 1);
+            haveSeq = true;
+            lastSeq = t.seq;
+            frames++;
+            printFrame(&t, csv);
+        } else {
+            bad++;
+        }
+        length = 0;
+    }
+    if (f != stdin) fclose(f);
+    fprintf(stderr, "%u frames, %u bad, %u lost\n", frames, bad, lost);
+    return 0;
+}
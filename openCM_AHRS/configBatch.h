@@ -0,0 +1,23 @@
+/* 설정 레지스터 묶음 쓰기 (config builder)
+ *
+ * configWrite()로 모아 두었다가 configCommit()에서 주소가 연속된 레지스터끼리
+ * 한 번의 burst로 전송한다 (함수는 openCM_AHRS.ino).
+ * setup(), 보정, 자체 시험에서만 쓰므로 전역 변수 대신 그 함수의 지역 변수로 둔다.
+ *
+ * .ino 파일에 구조체를 두면 IDE가 만드는 함수 원형보다 뒤에 선언되므로
+ * 구조체를 인자로 받는 함수를 위해 헤더로 분리했다.
+ */
+
+#ifndef _CONFIG_BATCH_H_
+#define _CONFIG_BATCH_H_
+
+#define CONFIG_BATCH_MAX    8   // 한 묶음에 모을 수 있는 레지스터 수 (넘치면 먼저 전송)
+
+struct ConfigBatch {
+  uint8 address;                  // I2C 장치 주소
+  uint8 count;                    // 모인 레지스터 수
+  uint8 reg[CONFIG_BATCH_MAX];    // 레지스터 주소 (오름차순)
+  uint8 data[CONFIG_BATCH_MAX];   // reg[]와 같은 순서의 값
+};
+
+#endif /* _CONFIG_BATCH_H_ */
@@ -24,6 +24,13 @@ FIFO(First In First Out) buffer  항상 최근값으로 덮어쓰는 버퍼
  */
 
 #include <Wire.h>   
+#include <I2Cdev.h>         // I2CDEV_REPEATED_START (I2Cdev 라이브러리 설정을 그대로 따른다)
+#include <helper_3dmath.h>  // invSqrt() (MPU9250_master 라이브러리)
+#include "sensorSample.h"
+#include "sensorLog.h"
+#include "configBatch.h"
+#include "telemetry.h"
+#include "quaternionFiltersFixed.h"
 // See also MPU-9250 Register Map and Descriptions, Revision 4.0, RM-MPU-9250A-00, Rev. 1.4, 9/9/2013 for registers not listed in 
 // above document; the MPU9250 and MPU9150 are virtually identical but the latter has a different register map
 //
@@ -186,11 +193,13 @@ FIFO(First In First Out) buffer  항상 최근값으로 덮어쓰는 버퍼
 #define BR 2
 #define BL 1
 #define AHRS true         // set to false for basic data read
-#define SerialDebug true// set to true to get Serial output for debugging
+#define SerialDebug true// set to true to get Serial output for debugging (이진 텔레메트리, telemetry.h)
 #define speed 512
 #define Serialchart true
 //#define processing
 //#define mag_cailbration 
+//#define fixedFusion       // 자세 필터를 고정소수점(quaternionFiltersFixed.h)으로 계산
+//#define SerialRecord      // 매 샘플의 raw 값을 이진 기록(sensorLog.h)으로 SerialUSB에 출력 (host/ahrs_replay.cpp 입력)
 
 Dynamixel AX(3);
 // Set initial input parameters
@@ -220,12 +229,10 @@ uint8 Mmode = 0x06;        // 2 for 8 Hz, 6 for 100 Hz continuous magnetometer d
 float aRes, gRes, mRes;      // scale resolutions per LSB for the sensors
 
 // Pin definitions
+int intPin = 3;  // MPU9250 INT 핀, 데이터 준비(data ready) 인터럽트
 int button1 = 16, button2 = 17;
 int LED1 = 18, LED2 = 19, LED3 = 20;
 volatile byte state=HIGH;
-int16 accelCount[3];  // Stores the 16-bit signed accelerometer sensor output
-int16 gyroCount[3];   // Stores the 16-bit signed gyro sensor output
-int16 magCount[3];    // Stores the 16-bit signed magnetometer sensor output
 
  //mpu9250 magBias{170,40,220}
 float magCalibration[3] = { 0, 0, 0}, magBias[3] = { 0, 0, 0}, magScale[3] = { 1, 1, 1 };  // Factory mag calibration and mag bias
@@ -250,17 +257,50 @@ float zeta = sqrt(3.0f / 4.0f) * GyroMeasDrift;   // compute zeta, the other fre
 #define Kp 2.0f * 5.0f // these are the free parameters in the Mahony filter and fusion scheme, Kp for proportional feedback, Ki for integral
 #define Ki 0.0f
 
-uint32 delt_t = 0; // used to control display output rate
-uint32 count = 0, sumCount = 0; // used to control display output rate
+uint32 sumCount = 0; // used to control display output rate
+uint32 telemetryDivider = 20;     // 출력(200 Hz) 몇 번마다 텔레메트리를 보낼지, 20이면 10 Hz
+uint32 telemetryCount = 0;
+uint8 telemetrySeq = 0;
+// 1 kHz에서는 샘플 하나가 1 ms이다. 보정 주기에 Serial1 출력(115200 bps, 바이트마다 대기해서 한 줄 ~1.9 ms)과
+// 서보 3개 명령까지 하면 다음 샘플을 놓치므로, 출력은 분주해서 준비만 해 두고
+// 보정 사이의 가벼운 샘플(자이로 전파만 하는 샘플)에서 serviceOutput()이 조금씩 보낸다
+uint32 chartDivider = 10;         // 보정(200 Hz) 몇 번마다 Serialchart 한 줄을 보낼지, 10이면 20 Hz
+uint32 chartCount = 0;
+#define CHART_BYTES_PER_SAMPLE 6  // 가벼운 샘플 하나에서 보낼 Serialchart 바이트 수 (115200 bps에서 ~0.5 ms)
+char chartLine[32];               // "-179.99,-89.99,-179.99\r\n"
+uint8 chartLength = 0, chartSent = 0;
+uint32 servoDivider = 4;          // 보정(200 Hz) 몇 번마다 서보 목표 위치를 보낼지, 4이면 50 Hz
+uint32 servoCount = 0;
+const uint8 servoMotor[3] = { YAWmotor, PITCHmotor, ROLLmotor };
+int servoGoal[3];                 // 보낼 목표 위치
+uint8 servoSent = 3;              // servoGoal 중 보낸 개수, 3이면 보낼 것이 없음
 float pitch, yaw, roll;
 
 float deltat = 0.0f;
 float sum= 0.0f;        // integration interval for both filter schemes
-uint32 lastUpdate= 0; // used to calculate integration interval
-uint32 Now = 0;        // used to calculate integration interval
+SensorSample sample, lastSample;  // 현재 샘플과 직전 샘플, deltat는 두 캡처 시각의 차이
+uint32 samplePeriod = 1000;       // 샘플 주기 [us], 1 kHz / (1 + SMPLRT_DIV 0) = 1 kHz
+// 다중 주기 스케줄러: 자이로 전파는 매 샘플(1 kHz), 가속도/지자기 보정과 출력은 correctionDivider 샘플마다(200 Hz)
+// 지자기 보정은 AK8963(Mmode 0x06, 100 Hz)의 새 데이터가 있을 때만 적용한다
+uint32 correctionDivider = 5;
+uint32 correctionIndex = 0;       // 마지막 보정을 적용한 샘플 번호
+float correctionDeltat = 0.0f;    // 마지막 보정 이후 경과 시간 [s]
+uint32 correctionCount = 0;       // 출력 주기 동안 적용한 보정 횟수
+uint32 droppedCount = 0;          // 처리하지 못하고 놓친 샘플 수
+uint32 latencySum = 0, latencyMax = 0; // 캡처부터 모터 명령까지 걸린 시간 [us]
+volatile boolean dataReady = false; // mpuDataReady()가 세우고 loop()가 내린다
+volatile uint32 sampleMicros = 0;   // 마지막 데이터 준비 인터럽트가 들어온 시각
 
 float ax, ay, az, gx, gy, gz, mx, my, mz; // variables to hold latest sensor data values 
 float q[4] = { 1.0f, 0.0f, 0.0f, 0.0f };    // 사원수용 배열 선언
+#ifdef fixedFusion
+int32 qFixed[4] = { FIXED_ONE, 0, 0, 0 };   // 사원수 (Q30), 출력할 때만 q[]로 옮긴다
+int32 eIntFixed[3] = { 0, 0, 0 };           // Mahony 적분 오차 (Q25)
+int32 betaFixed, kpFixed, kiFixed;          // beta (Q30), Kp/Ki (Q16)
+int32 gyroScaleFixed;                       // 자이로 raw -> rad/s 배율 (Q40)
+int32 magGainFixed[3], magOffsetFixed[3];   // 지자기 raw -> mG 보정 (Q8)
+int32 correctionDeltatFixed = 0;            // 마지막 보정 이후 경과 시간 (Q30)
+#endif
 float eInt[3] = { 0.0f, 0.0f, 0.0f };       // vector to hold integral error for Mahony method
 volatile float zeropoint[3]= {0.0f, 0.0f, 0.0f }; // 모터 영점각도
 float motorangle[3]={0.0f, 0.0f, 0.0f };
@@ -276,7 +316,7 @@ void setup()
         AX.goalPosition(YAWmotor,512);
         AX.goalPosition(PITCHmotor,512);
         AX.goalPosition(ROLLmotor,512);
- pinMode(3, INPUT);  digitalWrite(3, LOW);  // Set up the interrupt pin, its set as active high, push-pull
+ pinMode(intPin, INPUT);  digitalWrite(intPin, LOW);  // Set up the interrupt pin, its set as active high, push-pull
   pinMode(button1, INPUT_PULLUP); // 485 button 1 
   pinMode(button2, INPUT_PULLUP); //485 button 2 
   
@@ -342,57 +382,129 @@ digitalWrite(BOARD_LED_PIN, HIGH);
     while(1) ; // Loop forever if communication doesn't happen
   }
   delay(500);
+#ifdef fixedFusion
+  // 고정소수점 필터의 이득과 센서 배율은 한 번만 계산해 둔다
+  getGres(); getMres();
+  betaFixed = fixedFromFloat(beta, 30);
+  kpFixed = fixedFromFloat(Kp, 16);
+  kiFixed = fixedFromFloat(Ki, 16);
+  gyroScaleFixed = (int32)(gRes*PI/180.0f * 1099511627776.0f);  // * 2^40
+  for (uint8 i = 0; i < 3; i++) {
+    magGainFixed[i] = fixedFromFloat(mRes*magCalibration[i], 8);
+    magOffsetFixed[i] = fixedFromFloat(magBias[i], 8);
+  }
+#endif
+#ifdef SerialRecord
+  recordScale();
+#endif
+  // 초기화가 끝난 뒤에 INT 핀을 연결한다. 이후 샘플 수집은 인터럽트가 주도한다
+  lastSample.captureMicros = micros();
+  attachInterrupt(intPin, mpuDataReady, RISING);
+  readByte(MPU9250_ADDRESS, INT_STATUS);  // 이미 래치된 INT를 풀어야 다음 샘플에서 상승 에지가 생긴다
   
 }
 
+// INT 핀 상승 에지: 샘플 시각만 기록하고 I2C 읽기는 loop()에 맡긴다
+void mpuDataReady()
+{
+  sampleMicros = micros();
+  dataReady = true;
+}
+
 void loop()
 { 
 
-  // If intPin goes high, all data registers have new data
- if (readByte(MPU9250_ADDRESS, INT_STATUS) & 0x01) {  //인터럽 작동, 데이터 수집 확인용 인터럽
-    readAccelData(accelCount);  // Read the x/y/z adc values
-    getAres(); //가속도 단위 불러오기
+  // 새 샘플이 없으면 I2C 버스를 쓰지 않고 필터도 돌리지 않는다
+  if (!dataReady) return;
 
-    // Now we'll calculate the accleration value into actual g's
-    ax = (float)accelCount[0]*aRes; // - accelBias[0];  // get actual g value, this depends on scale being set
-    ay = (float)accelCount[1]*aRes; // - accelBias[1];   
-    az = (float)accelCount[2]*aRes; // - accelBias[2];  
+  noInterrupts();
+  sample.captureMicros = sampleMicros;  // 센서가 샘플을 만든 시각 (loop가 늦게 돌아도 dt가 틀어지지 않음)
+  dataReady = false;
+  interrupts();
+  uint32 steps = sampleSteps(&lastSample, &sample, samplePeriod);
+  sample.index = lastSample.index + steps;
+  droppedCount += steps - 1;
+
+    readMotionData(&sample);  // accel/temp/gyro를 한 번의 burst로 읽는다, 래치된 INT도 이 읽기로 해제됨
+  sample.magFresh = false;  // 지자기는 보정 주기에서만 읽는다
+  
+  deltat = sampleDeltat(&lastSample, &sample); // set integration time by time elapsed between the two sample captures
+#ifdef fixedFusion
+  int32 deltatFixed = fixedDeltat(sample.captureMicros - lastSample.captureMicros);
+#endif
+  lastSample = sample;
+  
+  sum += deltat; // sum for averaging filter update rate
+    sumCount++;
 
-    readGyroData(gyroCount);  // Read the x/y/z adc values
+  // 매 샘플: 자이로만으로 사원수 전파 (정규화와 보정은 보정 주기에서)
+#ifdef fixedFusion
+  // rad/s (Q24) = raw * 배율(Q40) >> 16
+  gyroQuaternionUpdateFixed((int32)(((int64)sample.gyro[0] * gyroScaleFixed) >> 16),
+                            (int32)(((int64)sample.gyro[1] * gyroScaleFixed) >> 16),
+                            (int32)(((int64)sample.gyro[2] * gyroScaleFixed) >> 16), deltatFixed, qFixed);
+  correctionDeltatFixed += deltatFixed;
+#else
     getGres(); //각속도 단위 불러오기 
     
     // Calculate the gyro value into actual degrees per second
-    gx = (float)gyroCount[0]*gRes;  // get actual gyro value, this depends on scale being set
-    gy = (float)gyroCount[1]*gRes;  
-    gz = (float)gyroCount[2]*gRes;   
+    gx = (float)sample.gyro[0]*gRes;  // get actual gyro value, this depends on scale being set
+    gy = (float)sample.gyro[1]*gRes;  
+    gz = (float)sample.gyro[2]*gRes;   
+
+  gyroQuaternionUpdate(gx*PI/180.0f, gy*PI/180.0f, gz*PI/180.0f, deltat, q);
+  correctionDeltat += deltat;
+#endif
+  if (sample.index - correctionIndex < correctionDivider) {
+#ifdef SerialRecord
+    recordSample(&sample);
+#endif
+    serviceOutput();
+    return;
+  }
+  correctionIndex = sample.index;
+  correctionCount++;
+
+    sample.magFresh = readMagData(sample.mag);  // AK8963는 100 Hz이므로 보정 주기에서만 확인한다
+#ifdef SerialRecord
+  recordSample(&sample);
+#endif
+#ifdef fixedFusion
+  // 가속도는 정규화만 하므로 raw 값 그대로, 지자기는 공장/사용자 보정을 적용한 mG (Q8)
+  int32 mxFixed = sample.mag[0]*magGainFixed[0] - magOffsetFixed[0];
+  int32 myFixed = sample.mag[1]*magGainFixed[1] - magOffsetFixed[1];
+  int32 mzFixed = sample.mag[2]*magGainFixed[2] - magOffsetFixed[2];
+  MadgwickCorrectionFixed(sample.accel[0], sample.accel[1], sample.accel[2], myFixed, mxFixed, mzFixed, sample.magFresh, correctionDeltatFixed, betaFixed, qFixed);
+  //MahonyCorrectionFixed(sample.accel[0], sample.accel[1], sample.accel[2], myFixed, mxFixed, mzFixed, sample.magFresh, correctionDeltatFixed, kpFixed, kiFixed, eIntFixed, qFixed);
+  correctionDeltatFixed = 0;
+  for (uint8 i = 0; i < 4; i++) q[i] = fixedToFloat(qFixed[i], 30);
+#else
+    getAres(); //가속도 단위 불러오기
+
+    // Now we'll calculate the accleration value into actual g's
+    ax = (float)sample.accel[0]*aRes; // - accelBias[0];  // get actual g value, this depends on scale being set
+    ay = (float)sample.accel[1]*aRes; // - accelBias[1];   
+    az = (float)sample.accel[2]*aRes; // - accelBias[2];  
 
-    readMagData(magCount);  // Read the x/y/z adc values
  getMres();  //지구자기장 단위 불러오기
 
     // Calculate the magnetometer values in milliGauss 
     // 공장초기값과 사용자 환경 초기값으로 보정
 
-    mx = (float)magCount[0]*mRes*magCalibration[0]-magBias[0]; // get actual magnetometer value, this depends on scale being set
-    my = (float)magCount[1]*mRes*magCalibration[1]-magBias[1];
-    mz = (float)magCount[2]*mRes*magCalibration[2]-magBias[2]; 
-
-  }
-  
-  Now = micros();
-  deltat = ((Now - lastUpdate)/1000000.0f); // set integration time by time elapsed since last filter update
-  lastUpdate = Now;
-  
-  sum += deltat; // sum for averaging filter update rate
-    sumCount++;
+    mx = (float)sample.mag[0]*mRes*magCalibration[0]-magBias[0]; // get actual magnetometer value, this depends on scale being set
+    my = (float)sample.mag[1]*mRes*magCalibration[1]-magBias[1];
+    mz = (float)sample.mag[2]*mRes*magCalibration[2]-magBias[2]; 
     //mpu-6050의 x(y)-축은 지자기센서의 y(x)-축과 일치한다.
     //지자기센서의 +z축과 mpu-6050의 -z축은 지구 중심 방향이다.
   //사원수알고리즘에 입력하기 이전에 이러한 방향성 불일치를 해결해야한다.
   //따라서 mpu-9250에서 x축을 센서 전방으로 하기 위해서 지자기센서를 기준으로 잡았다. (LSM9DS0 도 동일)
   // in the LSM9DS0 sensor.
   // This is ok by aircraft orientation standards!  
-  // Pass gyro rate as rad/s
-  MadgwickQuaternionUpdate(ax, ay, az, gx*PI/180.0f, gy*PI/180.0f, gz*PI/180.0f,  my,  mx, mz,q);
-  //MahonyQuaternionUpdate(ax, ay, az, gx*PI/180.0f, gy*PI/180.0f, gz*PI/180.0f, my, mx, mz,q);
+  // 자이로 적분은 이미 끝났으므로 마지막 보정 이후의 시간만큼 보정 항만 적용한다
+  MadgwickCorrection(ax, ay, az, my, mx, mz, sample.magFresh, correctionDeltat, q);
+  //MahonyCorrection(ax, ay, az, my, mx, mz, sample.magFresh, correctionDeltat, q);
+  correctionDeltat = 0.0f;
+#endif
   
           #ifdef processing
             // display quaternion values in InvenSense Teapot demo format:
@@ -413,12 +525,12 @@ void loop()
     pitch = (asin(2.0f * (q[0] * q[2]-q[1] * q[3])))*180.0f/PI; //raw pitch y
     roll = (atan2(2.0f * (q[0] * q[1] + q[2] * q[3]), q[0] * q[0] -q[1] * q[1] - q[2] * q[2] + q[3] * q[3]))*180.0f/PI;
         #if Serialchart
-            Serial1.print(yaw,2);
-            Serial1.print(',');
-            Serial1.print(pitch,2);
-            Serial1.print(',');
-            Serial1.print(roll,2);
-            Serial1.println();
+  // 한 줄을 만들어 두기만 하고 전송은 serviceOutput()이 나눠서 한다
+  if (++chartCount >= chartDivider && chartSent >= chartLength) {
+    chartCount = 0;
+    chartLength = formatChart(chartLine, yaw, pitch, roll);
+    chartSent = 0;
+  }
         #endif
  motorangle[0]=yaw-zeropoint[0];
     if(motorangle[0]>180){motorangle[0]-=360.0f;}
@@ -431,40 +543,20 @@ motorangle[2]=roll-zeropoint[2];
     if(motorangle[2]<-180){motorangle[2]+=360.0f;}
    
   
-     if(!state)
+     if(!state && ++servoCount >= servoDivider)
      {  
-AX.goalPosition(YAWmotor,1023-motormap(motorangle[0])); 
-AX.goalPosition(PITCHmotor,motormap(motorangle[1]));
-AX.goalPosition(ROLLmotor,motormap(motorangle[2]));
+  servoCount = 0;
+  servoGoal[0] = 1023-motormap(motorangle[0]);
+  servoGoal[1] = motormap(motorangle[1]);
+  servoGoal[2] = motormap(motorangle[2]);
+  servoSent = 0;  // 다음 가벼운 샘플부터 하나씩 보낸다
      }
-// 2Hz로 화면출력
-    delt_t = millis() - count;
-    if (delt_t > 500) { 
-#if SerialDebug
- /*  if(state){
-        SerialUSB.print("ax = "); 
-        SerialUSB.print((float)1000*ax,2);  
-        SerialUSB.print(" ay = "); 
-        SerialUSB.print((float)1000*ay,2); 
-        SerialUSB.print(" az = "); 
-        SerialUSB.print((float)1000*az,2); 
-        SerialUSB.println(" mg");
-        SerialUSB.print("gx = "); 
-        SerialUSB.print( gx, 2); 
-        SerialUSB.print(" gy = "); 
-        SerialUSB.print( gy, 2); 
-        SerialUSB.print(" gz = "); 
-        SerialUSB.print( gz, 2); 
-        SerialUSB.println(" deg/s");
-        SerialUSB.print("mx = "); 
-        SerialUSB.print( (float)mx,2 ); 
-        SerialUSB.print(" my = "); 
-        SerialUSB.print( (float)my,2 ); 
-        SerialUSB.print(" mz = "); 
-        SerialUSB.print( (float)mz,2 ); 
-        SerialUSB.println(" mG");
-   }   */
-#endif      
+  // 센서 캡처 시각부터 여기(모터 목표 결정)까지의 지연 시간, 서보 전송은 이후 샘플에서 한다
+  uint32 latency = micros() - sample.captureMicros;
+  latencySum += latency;
+  if (latency > latencyMax) latencyMax = latency;
+// telemetryDivider번 출력마다 텔레메트리 전송, 주기/지연 통계도 이 구간 기준
+    if (++telemetryCount >= telemetryDivider) { 
   /*
       // Define output variables from updated quaternion---these are Tait-Bryan angles (비행기 제어에 표준화된 모델)
       //  +z축은 지구 중심방향이다.
@@ -485,17 +577,8 @@ AX.goalPosition(ROLLmotor,motormap(motorangle[2]));
 
       #if SerialDebug
          #ifndef processing
-        SerialUSB.print("Yaw(Z), Pitch(Y), Roll(X): ");
-        SerialUSB.print(motorangle[0], 2);
-        SerialUSB.print(", ");
-        SerialUSB.print(motorangle[1], 2);
-        SerialUSB.print(", ");
-        SerialUSB.println(motorangle[2], 2);
+        sendTelemetry();  // 프레임 하나를 write 한 번으로 보낸다
          #endif
-        SerialUSB.println();
-        SerialUSB.print("rate = "); 
-        SerialUSB.print((float)sumCount/sum, 2); 
-        SerialUSB.println(" Hz");
       #endif
       // 영일고등학교 좌표 (37°32'24"N 126°51'36"W) 는
   // 2017-07-14 기준  8° 22' W ± 0° 18' (또는 8.37°)  
@@ -507,11 +590,14 @@ AX.goalPosition(ROLLmotor,motormap(motorangle[2]));
       // an ODR of 10 Hz for the magnetometer produce the above rates, maximum magnetometer ODR of 100 Hz produces
       // filter update rates of 36 - 145 and ~38 Hz for the Madgwick and Mahony schemes, respectively. 
 
-      count = millis(); 
+      telemetryCount = 0;
       sumCount = 0;
       sum = 0;  
+      correctionCount = 0;
+      latencySum = 0;
+      latencyMax = 0;
       
-    }// if(delt_t > 500)
+    }// if(telemetryCount >= telemetryDivider)
 }// void loop
 
 //===================================================================================================================
@@ -588,6 +674,72 @@ void readAccelData(int16 * destination)
 }
 
 
+#if SerialDebug
+// 텔레메트리 프레임 하나를 만들어 SerialUSB.write() 한 번으로 보낸다 (형식은 telemetry.h)
+void sendTelemetry()
+{
+  TelemetryFrame t;
+  uint8 frame[TELEMETRY_FRAME_MAX];
+  t.seq = telemetrySeq++;
+  t.captureMicros = sample.captureMicros;
+  for (uint8 i = 0; i < 4; i++) t.q[i] = q[i];
+  for (uint8 i = 0; i < 3; i++) {
+    t.ypr[i] = motorangle[i];
+    t.accel[i] = sample.accel[i];
+    t.gyro[i] = sample.gyro[i];
+    t.mag[i] = sample.mag[i];
+  }
+  t.rate = (float)sumCount/sum;
+  t.correctionRate = (float)correctionCount/sum;
+  uint32 latencyAvg = correctionCount ? latencySum/correctionCount : 0;
+  t.latencyAvg = latencyAvg > 0xFFFF ? 0xFFFF : latencyAvg;
+  t.latencyMax = latencyMax > 0xFFFF ? 0xFFFF : latencyMax;
+  t.dropped = droppedCount;
+  SerialUSB.write(frame, telemetryEncode(frame, &t));
+}
+#endif
+
+#ifdef SerialRecord
+// 이진 기록 (형식은 sensorLog.h, 호스트에서는 host/ahrs_replay.cpp로 재생)
+// raw 값만 보내고 단위 변환은 호스트에서 한다. 샘플당 30 바이트, 1 kHz에서 30 kB/s
+void recordScale()
+{
+  SensorLogHeader header;
+  uint8 frame[SENSOR_LOG_HEADER_SIZE];
+  getAres(); getGres(); getMres();
+  header.samplePeriod = samplePeriod;
+  header.aRes = aRes;
+  header.gRes = gRes;
+  header.mRes = mRes;
+  for (uint8 i = 0; i < 3; i++) {
+    header.magCalibration[i] = magCalibration[i];
+    header.magBias[i] = magBias[i];
+  }
+  sensorLogEncodeHeader(frame, &header);
+  SerialUSB.write(frame, SENSOR_LOG_HEADER_SIZE);
+}
+
+void recordSample(const SensorSample * s)
+{
+  uint8 frame[SENSOR_LOG_RECORD_SIZE];
+  sensorLogEncodeSample(frame, s);
+  SerialUSB.write(frame, SENSOR_LOG_RECORD_SIZE);
+}
+#endif
+
+// ACCEL_XOUT_H부터 GYRO_ZOUT_L까지 14바이트(accel 6, temp 2, gyro 6)를 한 번에 읽어 샘플에 채운다
+void readMotionData(SensorSample * s)
+{
+  uint8 rawData[14];
+  readBytes(MPU9250_ADDRESS, ACCEL_XOUT_H, 14, &rawData[0]);
+  s->accel[0] = ((int16)rawData[0] << 8) | rawData[1] ;
+  s->accel[1] = ((int16)rawData[2] << 8) | rawData[3] ;
+  s->accel[2] = ((int16)rawData[4] << 8) | rawData[5] ;
+  s->gyro[0] = ((int16)rawData[8] << 8) | rawData[9] ;
+  s->gyro[1] = ((int16)rawData[10] << 8) | rawData[11] ;
+  s->gyro[2] = ((int16)rawData[12] << 8) | rawData[13] ;
+}
+
 void readGyroData(int16 * destination)
 {
   uint8 rawData[6];  // x/y/z gyro register data stored here
@@ -597,7 +749,7 @@ void readGyroData(int16 * destination)
   destination[2] = ((int16)rawData[4] << 8) | rawData[5] ; 
 }
 
-void readMagData(int16 * destination)
+boolean readMagData(int16 * destination) // 새 데이터를 읽었으면 true
 {
   uint8 rawData[7];  // x/y/z gyro register data, ST2 register stored here, must read ST2 at end of data acquisition
   if(readByte(AK8963_ADDRESS, AK8963_ST1) & 0x01) { // wait for magnetometer data ready bit to be set
@@ -607,8 +759,10 @@ void readMagData(int16 * destination)
       destination[0] = ((int16)rawData[1] << 8) | rawData[0] ;  // Turn the MSB and LSB into a signed 16-bit value
       destination[1] = ((int16)rawData[3] << 8) | rawData[2] ;  // Data stored as little Endian
       destination[2] = ((int16)rawData[5] << 8) | rawData[4] ; 
+      return true;
     }
   }
+  return false;
 }
 
 int16 readTempData()
@@ -650,53 +804,57 @@ void initMPU9250()
   writeByte(MPU9250_ADDRESS, PWR_MGMT_1, 0x01);  // Auto select clock source to be PLL gyroscope reference if ready else
   delay(200); 
 
+  // GYRO_CONFIG, ACCEL_CONFIG, ACCEL_CONFIG2 현재값을 한 번에 읽고, 0x19~0x1D 설정은 모아서 한 번에 전송
+  uint8 c[3];
+  readBytes(MPU9250_ADDRESS, GYRO_CONFIG, 3, c);
+  ConfigBatch config;
+  configBegin(&config, MPU9250_ADDRESS);
+
   // Configure Gyro and Thermometer
   // Disable FSYNC and set thermometer and gyro bandwidth to 41 and 42 Hz, respectively; 
   // minimum delay time for this setting is 5.9 ms, which means sensor fusion update rates cannot
   // be higher than 1 / 0.0059 = 170 Hz 
   // DLPF_CFG = bits 2:0 = 011; this limits the sample rate to 1000 Hz for both (저주파통과필터 1KHz이하로 제한)
   // With the MPU9250, it is possible to get gyro sample rates of 32 kHz (!), 8 kHz, or 1 kHz
-  writeByte(MPU9250_ADDRESS, CONFIG, 0x03);  
+  configWrite(&config, CONFIG, 0x03);  
 
   // Set sample rate = gyroscope output rate/(1 + SMPLRT_DIV)
-  writeByte(MPU9250_ADDRESS, SMPLRT_DIV, 0x04);  // Use a 200 Hz rate; a rate consistent with the filter update rate 
+  configWrite(&config, SMPLRT_DIV, 0x00);  // Use a 1 kHz rate for gyro propagation; accel/mag corrections run at 200 Hz in loop()
   // determined inset in CONFIG above
 
   // Set gyroscope full scale range
   // Range selects FS_SEL and AFS_SEL are 0 - 3, so 2-bit values are left-shifted into positions 4:3
-  uint8 c = readByte(MPU9250_ADDRESS, GYRO_CONFIG);
   //  writeRegister(GYRO_CONFIG, c & ~0xE0); // Clear self-test bits [7:5] 
   // writeByte(MPU9250_ADDRESS, GYRO_CONFIG, c & ~0x02); // Clear Fchoice bits [1:0] 
   // writeByte(MPU9250_ADDRESS, GYRO_CONFIG, c & ~0x18); // Clear AFS bits [4:3]
   // writeByte(MPU9250_ADDRESS, GYRO_CONFIG, c | Gscale << 3); // Set full scale range for the gyro
   // Clear Fchoice bit[1] and AFS bits[4:3]
-  writeByte(MPU9250_ADDRESS, GYRO_CONFIG, (c & ~(0x02 | 0x18)) | Gscale << 3); // Set full scale range for the gyro
+  configWrite(&config, GYRO_CONFIG, (c[0] & ~(0x02 | 0x18)) | Gscale << 3); // Set full scale range for the gyro
   // writeRegister(GYRO_CONFIG, c | 0x00); // Set Fchoice for the gyro to 11 by writing its inverse to bits 1:0 of GYRO_CONFIG
 
   // Set accelerometer full-scale range configuration
-  c = readByte(MPU9250_ADDRESS, ACCEL_CONFIG);
   //  writeRegister(ACCEL_CONFIG, c & ~0xE0); // Clear self-test bits [7:5] 
   // writeByte(MPU9250_ADDRESS, ACCEL_CONFIG, c & ~0x18); // Clear AFS bits [4:3]
   // writeByte(MPU9250_ADDRESS, ACCEL_CONFIG, c | Ascale << 3); // Set full scale range for the accelerometer 
-  writeByte(MPU9250_ADDRESS, ACCEL_CONFIG, (c & ~0x18) | Ascale << 3); // Set full scale range for the accelerometer 
+  configWrite(&config, ACCEL_CONFIG, (c[1] & ~0x18) | Ascale << 3); // Set full scale range for the accelerometer 
 
   // Set accelerometer sample rate configuration
   // It is possible to get a 4 kHz sample rate from the accelerometer by choosing 1 for
   // accel_fchoice_b bit [3]; in this case the bandwidth is 1.13 kHz
-  c = readByte(MPU9250_ADDRESS, ACCEL_CONFIG2);
   // writeByte(MPU9250_ADDRESS, ACCEL_CONFIG2, c & ~0x0F); // Clear accel_fchoice_b (bit 3) and A_DLPFG (bits [2:0])  
   // writeByte(MPU9250_ADDRESS, ACCEL_CONFIG2, c | 0x03); // Set accelerometer rate to 1 kHz and bandwidth to 41 Hz
-  writeByte(MPU9250_ADDRESS, ACCEL_CONFIG2, (c & ~0x0F) | 0x03); // Set accelerometer rate to 1 kHz and bandwidth to 41 Hz
+  configWrite(&config, ACCEL_CONFIG2, (c[2] & ~0x0F) | 0x03); // Set accelerometer rate to 1 kHz and bandwidth to 41 Hz
 
   // The accelerometer, gyro, and thermometer are set to 1 kHz sample rates, 
-  // but all these rates are further reduced by a factor of 5 to 200 Hz because of the SMPLRT_DIV setting
+  // and SMPLRT_DIV 0 keeps the output data rate (and the data ready interrupt) at 1 kHz
 
   // Configure Interrupts and Bypass Enable
   // Set interrupt pin active high, push-pull, hold interrupt pin level HIGH until interrupt cleared,
-  // clear on read of INT_STATUS, and enable I2C_BYPASS_EN so additional chips 
-  // can join the I2C bus and all can be controlled by the Arduino as master
-  writeByte(MPU9250_ADDRESS, INT_PIN_CFG, 0x22);    
-  writeByte(MPU9250_ADDRESS, INT_ENABLE, 0x01);  // Enable data ready (bit 0) interrupt
+  // clear on any read (the data burst in loop() clears it, no INT_STATUS read needed), and enable
+  // I2C_BYPASS_EN so additional chips can join the I2C bus and all can be controlled by the Arduino as master
+  configWrite(&config, INT_PIN_CFG, 0x32);    
+  configWrite(&config, INT_ENABLE, 0x01);  // Enable data ready (bit 0) interrupt
+  configCommit(&config);  // 0x19~0x1D, 0x37~0x38 두 번의 burst 쓰기
   delay(100);
 }
 
@@ -715,24 +873,31 @@ void calibrateMPU9250(float * dest1, float * dest2)
 
   // get stable time source; Auto select clock source to be PLL gyroscope reference if ready 
   // else use the internal oscillator, bits 2:0 = 001
-  writeByte(MPU9250_ADDRESS, PWR_MGMT_1, 0x01);  
-  writeByte(MPU9250_ADDRESS, PWR_MGMT_2, 0x00);
+  ConfigBatch config;
+  configBegin(&config, MPU9250_ADDRESS);
+  configWrite(&config, PWR_MGMT_1, 0x01);  
+  configWrite(&config, PWR_MGMT_2, 0x00);
+  configCommit(&config);
   delay(200);                                    
 
   // Configure device for bias calculation
-  writeByte(MPU9250_ADDRESS, INT_ENABLE, 0x00);   // Disable all interrupts
-  writeByte(MPU9250_ADDRESS, FIFO_EN, 0x00);      // Disable FIFO
-  writeByte(MPU9250_ADDRESS, PWR_MGMT_1, 0x00);   // Turn on internal clock source
-  writeByte(MPU9250_ADDRESS, I2C_MST_CTRL, 0x00); // Disable I2C master
-  writeByte(MPU9250_ADDRESS, USER_CTRL, 0x00);    // Disable FIFO and I2C master modes
-  writeByte(MPU9250_ADDRESS, USER_CTRL, 0x0C);    // Reset FIFO and DMP
+  configBegin(&config, MPU9250_ADDRESS);
+  configWrite(&config, INT_ENABLE, 0x00);   // Disable all interrupts
+  configWrite(&config, FIFO_EN, 0x00);      // Disable FIFO
+  configWrite(&config, PWR_MGMT_1, 0x00);   // Turn on internal clock source
+  configWrite(&config, I2C_MST_CTRL, 0x00); // Disable I2C master
+  configWrite(&config, USER_CTRL, 0x00);    // Disable FIFO and I2C master modes
+  configCommit(&config);
+  writeByte(MPU9250_ADDRESS, USER_CTRL, 0x0C);    // Reset FIFO and DMP (순서가 중요하므로 따로 전송)
   delay(15);
 
   // Configure MPU6050 gyro and accelerometer for bias calculation
-  writeByte(MPU9250_ADDRESS, CONFIG, 0x01);      //
-  writeByte(MPU9250_ADDRESS, SMPLRT_DIV, 0x00);  // Set sample rate to 1 kHz
-  writeByte(MPU9250_ADDRESS, GYRO_CONFIG, 0x00);  // Set gyro full-scale to 250 degrees per second, maximum sensitivity
-  writeByte(MPU9250_ADDRESS, ACCEL_CONFIG, 0x00); // Set accelerometer full-scale to 2 g, maximum sensitivity
+  configBegin(&config, MPU9250_ADDRESS);
+  configWrite(&config, CONFIG, 0x01);      //
+  configWrite(&config, SMPLRT_DIV, 0x00);  // Set sample rate to 1 kHz
+  configWrite(&config, GYRO_CONFIG, 0x00);  // Set gyro full-scale to 250 degrees per second, maximum sensitivity
+  configWrite(&config, ACCEL_CONFIG, 0x00); // Set accelerometer full-scale to 2 g, maximum sensitivity
+  configCommit(&config);
 
   uint16  gyrosensitivity  = 131;   // = 131 LSB/degrees/sec
   uint16  accelsensitivity = 16384;  // = 16384 LSB/g
@@ -785,12 +950,7 @@ void calibrateMPU9250(float * dest1, float * dest2)
   data[5] = (-gyro_bias[2]/4)       & 0xFF;
 
   // Push gyro biases to hardware registers
-  writeByte(MPU9250_ADDRESS, XG_OFFSET_H, data[0]);
-  writeByte(MPU9250_ADDRESS, XG_OFFSET_L, data[1]);
-  writeByte(MPU9250_ADDRESS, YG_OFFSET_H, data[2]);
-  writeByte(MPU9250_ADDRESS, YG_OFFSET_L, data[3]);
-  writeByte(MPU9250_ADDRESS, ZG_OFFSET_H, data[4]);
-  writeByte(MPU9250_ADDRESS, ZG_OFFSET_L, data[5]);
+  writeBytes(MPU9250_ADDRESS, XG_OFFSET_H, 6, &data[0]);  // XG_OFFSET_H ~ ZG_OFFSET_L 연속 6바이트
 
   // Output scaled gyro biases for display in the main program
   dest1[0] = (float) gyro_bias[0]/(float) gyrosensitivity;  
@@ -834,12 +994,14 @@ void calibrateMPU9250(float * dest1, float * dest2)
   // Apparently this is not working for the acceleration biases in the MPU-9250
   // Are we handling the temperature correction bit properly?
   // Push accelerometer biases to hardware registers
-  writeByte(MPU9250_ADDRESS, XA_OFFSET_H, data[0]);
-  writeByte(MPU9250_ADDRESS, XA_OFFSET_L, data[1]);
-  writeByte(MPU9250_ADDRESS, YA_OFFSET_H, data[2]);
-  writeByte(MPU9250_ADDRESS, YA_OFFSET_L, data[3]);
-  writeByte(MPU9250_ADDRESS, ZA_OFFSET_H, data[4]);
-  writeByte(MPU9250_ADDRESS, ZA_OFFSET_L, data[5]);
+  configBegin(&config, MPU9250_ADDRESS);
+  configWrite(&config, XA_OFFSET_H, data[0]);
+  configWrite(&config, XA_OFFSET_L, data[1]);
+  configWrite(&config, YA_OFFSET_H, data[2]);
+  configWrite(&config, YA_OFFSET_L, data[3]);
+  configWrite(&config, ZA_OFFSET_H, data[4]);
+  configWrite(&config, ZA_OFFSET_L, data[5]);
+  configCommit(&config);
 
   // Output scaled accelerometer biases for display in the main program
   dest2[0] = (float)accel_bias[0]/(float)accelsensitivity; 
@@ -857,11 +1019,14 @@ void MPU9250SelfTest(float * destination) // Should return percent deviation fro
   float factoryTrim[6];
   uint8 FS = 0;
 
-  writeByte(MPU9250_ADDRESS, SMPLRT_DIV, 0x01);    // Set gyro sample rate to 1 kHz
-  writeByte(MPU9250_ADDRESS, CONFIG, 0x02);        // Set gyro sample rate to 1 kHz and DLPF to 92 Hz
-  writeByte(MPU9250_ADDRESS, GYRO_CONFIG, 1<<FS);  // Set full scale range for the gyro to 250 dps
-  writeByte(MPU9250_ADDRESS, ACCEL_CONFIG2, 0x02); // Set accelerometer rate to 1 kHz and bandwidth to 92 Hz
-  writeByte(MPU9250_ADDRESS, ACCEL_CONFIG, 1<<FS); // Set full scale range for the accelerometer to 2 g
+  ConfigBatch config;
+  configBegin(&config, MPU9250_ADDRESS);
+  configWrite(&config, SMPLRT_DIV, 0x01);    // Set gyro sample rate to 1 kHz
+  configWrite(&config, CONFIG, 0x02);        // Set gyro sample rate to 1 kHz and DLPF to 92 Hz
+  configWrite(&config, GYRO_CONFIG, 1<<FS);  // Set full scale range for the gyro to 250 dps
+  configWrite(&config, ACCEL_CONFIG2, 0x02); // Set accelerometer rate to 1 kHz and bandwidth to 92 Hz
+  configWrite(&config, ACCEL_CONFIG, 1<<FS); // Set full scale range for the accelerometer to 2 g
+  configCommit(&config);
 
   for( int ii = 0; ii < 200; ii++) {  // get average current values of gyro and acclerometer
 
@@ -882,8 +1047,10 @@ void MPU9250SelfTest(float * destination) // Should return percent deviation fro
         }
 
   // Configure the accelerometer for self-test
-  writeByte(MPU9250_ADDRESS, ACCEL_CONFIG, 0xE0); // Enable self test on all three axes and set accelerometer range to +/- 2 g
-  writeByte(MPU9250_ADDRESS, GYRO_CONFIG,  0xE0); // Enable self test on all three axes and set gyro range to +/- 250 degrees/s
+  configBegin(&config, MPU9250_ADDRESS);
+  configWrite(&config, ACCEL_CONFIG, 0xE0); // Enable self test on all three axes and set accelerometer range to +/- 2 g
+  configWrite(&config, GYRO_CONFIG,  0xE0); // Enable self test on all three axes and set gyro range to +/- 250 degrees/s
+  configCommit(&config);
   delay(25);  // Delay a while to let the device stabilize
 
   for( int ii = 0; ii < 200; ii++) {  // get average self-test values of gyro and acclerometer
@@ -905,8 +1072,10 @@ void MPU9250SelfTest(float * destination) // Should return percent deviation fro
       }   
 
   // Configure the gyro and accelerometer for normal operation
-  writeByte(MPU9250_ADDRESS, ACCEL_CONFIG, 0x00);  
-  writeByte(MPU9250_ADDRESS, GYRO_CONFIG,  0x00);  
+  configBegin(&config, MPU9250_ADDRESS);
+  configWrite(&config, ACCEL_CONFIG, 0x00);  
+  configWrite(&config, GYRO_CONFIG,  0x00);  
+  configCommit(&config);
   delay(25);  // Delay a while to let the device stabilize
 
   // Retrieve accelerometer and gyro factory Self-Test Code from USR_Reg
@@ -1040,14 +1209,71 @@ void writeByte(uint8 address, uint8 subAddress, uint8 data)
   Wire.endTransmission();           // // 통신종료(주소값 전송 기능)
 }
 
+void writeBytes(uint8 address, uint8 subAddress, uint8 count, uint8 * data)
+{
+  Wire.beginTransmission(address);  // 접속(송신버퍼 열기)
+  Wire.write(subAddress);           // 첫 서브주소 입력 (이후 자동 증가)
+  for (uint8 i = 0; i < count; i++) {
+    Wire.write(data[i]);            // 송신버퍼에 데이터 입력
+  }
+  Wire.endTransmission();           // 통신종료
+}
+
+// 설정 묶음 시작
+void configBegin(ConfigBatch * batch, uint8 address)
+{
+  batch->address = address;
+  batch->count = 0;
+}
+
+// 설정 레지스터 값 기록 (같은 레지스터는 마지막 값만 전송됨)
+// reg[]를 오름차순으로 유지하므로 연속된 레지스터의 값도 data[]에 연속으로 놓인다
+void configWrite(ConfigBatch * batch, uint8 subAddress, uint8 data)
+{
+  uint8 i = 0;
+  while (i < batch->count && batch->reg[i] < subAddress) i++;
+  if (i < batch->count && batch->reg[i] == subAddress) {
+    batch->data[i] = data;
+    return;
+  }
+  if (batch->count == CONFIG_BATCH_MAX) {
+    configCommit(batch);  // 가득 차면 모인 것부터 보낸다
+    i = 0;
+  }
+  for (uint8 k = batch->count; k > i; k--) {
+    batch->reg[k] = batch->reg[k - 1];
+    batch->data[k] = batch->data[k - 1];
+  }
+  batch->reg[i] = subAddress;
+  batch->data[i] = data;
+  batch->count++;
+}
+
+// 모아 둔 설정을 주소 오름차순으로, 연속된 레지스터끼리 묶어서 전송
+void configCommit(ConfigBatch * batch)
+{
+  for (uint8 first = 0; first < batch->count; ) {
+    uint8 count = 1;
+    while (first + count < batch->count && count < BUFFER_LENGTH - 1
+        && batch->reg[first + count] == batch->reg[first] + count) count++;
+    writeBytes(batch->address, batch->reg[first], count, &batch->data[first]);
+    first += count;
+  }
+  batch->count = 0;
+}
+
 uint8 readByte(uint8 address, uint8 subAddress)
 {
   uint8 data; // `data` will store the register data	 
   Wire.beginTransmission(address);         // 접속
   Wire.write(subAddress);	                 // 송신 버퍼에 주소기록
-  Wire.endTransmission();      // 통신종료(주소값 전송 기능)
-  Wire.beginTransmission(address);     // 데이터를 읽기 위해 재접속
+#if I2CDEV_REPEATED_START
+  Wire.endTransmission(false);  // STOP 없이 주소값만 전송 (repeated START로 이어서 읽기)
+  Wire.requestFrom(address, (uint8) 1, (uint8) true);  // 서브 주소에서 데이터 요청 후 STOP
+#else
+  Wire.endTransmission();       // 주소값 전송 후 STOP
   Wire.requestFrom(address, (uint8) 1);  // 서브 주소에서 데이터 요청
+#endif
   data = Wire.read();                      // 수신데이터
   return data;                             // Return data read from slave register
 }
@@ -1056,10 +1282,15 @@ void readBytes(uint8 address, uint8 subAddress, uint8 count, uint8 * dest)
 {  
   Wire.beginTransmission(address);   // sensor 접속
   Wire.write(subAddress);            // 송신 버퍼에 서브주소기록
-  Wire.endTransmission();   //통신종료(주소값 전송 기능)
-  Wire.beginTransmission(address);     // 데이터를 읽기 위해 재접속
+#if I2CDEV_REPEATED_START
+  Wire.endTransmission(false);  // STOP 없이 주소값만 전송 (repeated START로 이어서 읽기)
+  uint8 i = 0;
+  Wire.requestFrom(address, count, (uint8) true);  // 서브 주소에서 데이터 요청 후 STOP
+#else
+  Wire.endTransmission();       // 주소값 전송 후 STOP
   uint8 i = 0;
   Wire.requestFrom(address, count);  // 서브 주소에서 데이터 요청
+#endif
   while (Wire.available()) {
     dest[i++] = Wire.read(); 
   }         // 수신데이터->배열에 담기
@@ -1084,4 +1315,51 @@ void motorpower(void) //button1 interrupt 모터 제어기능
   int motor;  angle=constrain(angle,-150,150); return motor=map(angle,-150,150,0,1023);
   }
 
-
+// 보정 사이의 가벼운 샘플마다 호출: 서보 명령 하나, 보낼 서보 명령이 없으면 Serialchart 몇 바이트
+void serviceOutput()
+{
+  if (servoSent < 3) {
+    AX.goalPosition(servoMotor[servoSent], servoGoal[servoSent]);
+    servoSent++;
+    return;
+  }
+#if Serialchart
+  if (chartSent < chartLength) {
+    uint8 n = min(chartLength - chartSent, CHART_BYTES_PER_SAMPLE);
+    Serial1.write((const uint8 *)chartLine + chartSent, n);
+    chartSent += n;
+  }
+#endif
+}
+
+// 각도를 소수점 둘째 자리까지 쓴다 (Serial1.print(v, 2)와 같은 모양), 쓴 길이를 돌려준다
+uint8 formatAngle(char * p, float v)
+{
+  int32 c = (int32)(v * 100.0f + (v < 0.0f ? -0.5f : 0.5f));
+  uint8 n = 0;
+  if (c < 0) { p[n++] = '-'; c = -c; }
+  char digits[8];
+  uint8 d = 0;
+  int32 whole = c / 100;
+  do { digits[d++] = '0' + whole % 10; whole /= 10; } while (whole > 0);
+  while (d > 0) p[n++] = digits[--d];
+  p[n++] = '.';
+  p[n++] = '0' + (c / 10) % 10;
+  p[n++] = '0' + c % 10;
+  return n;
+}
+
+// Serialchart 한 줄 "yaw,pitch,roll\r\n"을 만든다, 줄 길이를 돌려준다
+uint8 formatChart(char * line, float y, float p, float r)
+{
+  uint8 n = formatAngle(line, y);
+  line[n++] = ',';
+  n += formatAngle(line + n, p);
+  line[n++] = ',';
+  n += formatAngle(line + n, r);
+  line[n++] = '\r';
+  line[n++] = '\n';
+  return n;
+}
+
+
@@ -5,7 +5,9 @@
 // device orientation -- which can be converted to yaw, pitch, and roll. Useful for stabilizing quadcopters, etc.
 // The performance of the orientation filter is at least as good as conventional Kalman-based filtering algorithms
 // but is much less computationally intensive---it can be performed on a 3.3 V Pro Mini operating at 8 MHz!
-        void MadgwickQuaternionUpdate(float ax, float ay, float az, float gx, float gy, float gz, float mx, float my, float mz, float* vector)
+// 정규화는 sqrt와 나눗셈 대신 helper_3dmath.h의 invSqrt()를 쓴다
+// deltat는 두 샘플의 캡처 시각 차이(sampleDeltat())를 넘겨받는다
+        void MadgwickQuaternionUpdate(float ax, float ay, float az, float gx, float gy, float gz, float mx, float my, float mz, float deltat, float* vector)
         {
             float q1 = vector[0], q2 = vector[1], q3 = vector[2], q4 = vector[3];   // short name local variable for readability
             float norm;
@@ -38,17 +40,17 @@
             float q4q4 = q4 * q4;
 
             // Normalise accelerometer measurement
-            norm = sqrt(ax * ax + ay * ay + az * az);
+            norm = ax * ax + ay * ay + az * az;
             if (norm == 0.0f) return; // handle NaN
-            norm = 1.0f/norm;
+            norm = invSqrt(norm);
             ax *= norm;
             ay *= norm;
             az *= norm;
 
             // Normalise magnetometer measurement
-            norm = sqrt(mx * mx + my * my + mz * mz);
+            norm = mx * mx + my * my + mz * mz;
             if (norm == 0.0f) return; // handle NaN
-            norm = 1.0f/norm;
+            norm = invSqrt(norm);
             mx *= norm;
             my *= norm;
             mz *= norm;
@@ -60,7 +62,8 @@
             _2q2mx = 2.0f * q2 * mx;
             hx = mx * q1q1 - _2q1my * q4 + _2q1mz * q3 + mx * q2q2 + _2q2 * my * q3 + _2q2 * mz * q4 - mx * q3q3 - mx * q4q4;
             hy = _2q1mx * q4 + my * q1q1 - _2q1mz * q2 + _2q2mx * q3 - my * q2q2 + my * q3q3 + _2q3 * mz * q4 - my * q4q4;
-            _2bx = sqrt(hx * hx + hy * hy);
+            _2bx = hx * hx + hy * hy;
+            _2bx *= invSqrt(_2bx);
             _2bz = -_2q1mx * q3 + _2q1my * q2 + mz * q1q1 + _2q2mx * q4 - mz * q2q2 + _2q3 * my * q4 - mz * q3q3 + mz * q4q4;
             _4bx = 2.0f * _2bx;
             _4bz = 2.0f * _2bz;
@@ -70,8 +73,8 @@
             s2 = _2q4 * (2.0f * q2q4 - _2q1q3 - ax) + _2q1 * (2.0f * q1q2 + _2q3q4 - ay) - 4.0f * q2 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - az) + _2bz * q4 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (_2bx * q3 + _2bz * q1) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + (_2bx * q4 - _4bz * q2) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
             s3 = -_2q1 * (2.0f * q2q4 - _2q1q3 - ax) + _2q4 * (2.0f * q1q2 + _2q3q4 - ay) - 4.0f * q3 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - az) + (-_4bx * q3 - _2bz * q1) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (_2bx * q2 + _2bz * q4) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + (_2bx * q1 - _4bz * q3) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
             s4 = _2q2 * (2.0f * q2q4 - _2q1q3 - ax) + _2q3 * (2.0f * q1q2 + _2q3q4 - ay) + (-_4bx * q4 + _2bz * q2) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (-_2bx * q1 + _2bz * q3) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + _2bx * q2 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
-            norm = sqrt(s1 * s1 + s2 * s2 + s3 * s3 + s4 * s4);    // normalise step magnitude
-            norm = 1.0f/norm;
+            norm = s1 * s1 + s2 * s2 + s3 * s3 + s4 * s4;    // normalise step magnitude
+            norm = invSqrt(norm);
             s1 *= norm;
             s2 *= norm;
             s3 *= norm;
@@ -88,8 +91,8 @@
             q2 += qDot2 * deltat;
             q3 += qDot3 * deltat;
             q4 += qDot4 * deltat;
-            norm = sqrt(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);    // normalise quaternion
-            norm = 1.0f/norm;
+            norm = q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4;    // normalise quaternion
+            norm = invSqrt(norm);
             vector[0] = q1 * norm;
             vector[1] = q2 * norm;
             vector[2] = q3 * norm;
@@ -101,7 +104,7 @@
   
  // Similar to Madgwick scheme but uses proportional and integral filtering on the error between estimated reference vectors and
  // measured ones. 
-            void MahonyQuaternionUpdate(float ax, float ay, float az, float gx, float gy, float gz, float mx, float my, float mz, float* vector)
+            void MahonyQuaternionUpdate(float ax, float ay, float az, float gx, float gy, float gz, float mx, float my, float mz, float deltat, float* vector)
         {
             float q1 = vector[0], q2 = vector[1], q3 = vector[2], q4 = vector[3];   // short name local variable for readability
             float norm;
@@ -123,17 +126,17 @@
             float q4q4 = q4 * q4;   
 
             // Normalise accelerometer measurement
-            norm = sqrt(ax * ax + ay * ay + az * az);
+            norm = ax * ax + ay * ay + az * az;
             if (norm == 0.0f) return; // handle NaN
-            norm = 1.0f / norm;        // use reciprocal for division
+            norm = invSqrt(norm);        // use reciprocal for division
             ax *= norm;
             ay *= norm;
             az *= norm;
 
             // Normalise magnetometer measurement
-            norm = sqrt(mx * mx + my * my + mz * mz);
+            norm = mx * mx + my * my + mz * mz;
             if (norm == 0.0f) return; // handle NaN
-            norm = 1.0f / norm;        // use reciprocal for division
+            norm = invSqrt(norm);        // use reciprocal for division
             mx *= norm;
             my *= norm;
             mz *= norm;
@@ -141,7 +144,8 @@
             // Reference direction of Earth's magnetic field
             hx = 2.0f * mx * (0.5f - q3q3 - q4q4) + 2.0f * my * (q2q3 - q1q4) + 2.0f * mz * (q2q4 + q1q3);
             hy = 2.0f * mx * (q2q3 + q1q4) + 2.0f * my * (0.5f - q2q2 - q4q4) + 2.0f * mz * (q3q4 - q1q2);
-            bx = sqrt((hx * hx) + (hy * hy));
+            bx = hx * hx + hy * hy;
+            bx *= invSqrt(bx);
             bz = 2.0f * mx * (q2q4 - q1q3) + 2.0f * my * (q3q4 + q1q2) + 2.0f * mz * (0.5f - q2q2 - q3q3);
 
             // Estimated direction of gravity and magnetic field
@@ -184,11 +188,222 @@
             q4 = pc + (q1 * gz + pa * gy - pb * gx) * (0.5f * deltat);
 
             // Normalise quaternion
-            norm = sqrt(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);
-            norm = 1.0f / norm;
+            norm = q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4;
+            norm = invSqrt(norm);
             vector[0] = q1 * norm;
             vector[1] = q2 * norm;
             vector[2] = q3 * norm;
             vector[3] = q4 * norm;
  
         }
+
+
+
+// 다중 주기 스케줄러용 분할 버전
+// gyroQuaternionUpdate()는 매 IMU 샘플마다 자이로만으로 사원수를 전파하고,
+// MadgwickCorrection()/MahonyCorrection()은 새 가속도(와 지자기) 샘플이 있을 때만 보정 항을 적용한다.
+// 보정 함수의 deltat는 마지막 보정 이후 경과 시간이다.
+
+        // q += 0.5 * q ⊗ (0, gx, gy, gz) * deltat, 정규화하지 않는다 (다음 보정에서 정규화)
+        void gyroQuaternionUpdate(float gx, float gy, float gz, float deltat, float* vector)
+        {
+            float q1 = vector[0], q2 = vector[1], q3 = vector[2], q4 = vector[3];   // short name local variable for readability
+            float h = 0.5f * deltat;
+
+            vector[0] = q1 + (-q2 * gx - q3 * gy - q4 * gz) * h;
+            vector[1] = q2 + (q1 * gx + q3 * gz - q4 * gy) * h;
+            vector[2] = q3 + (q1 * gy - q2 * gz + q4 * gx) * h;
+            vector[3] = q4 + (q1 * gz + q2 * gy - q3 * gx) * h;
+        }
+
+        // Madgwick 경사 하강 보정 단계만 적용: q -= beta * s * deltat
+        // useMag가 false이면 가속도만 쓰는 IMU 목적함수로 보정한다
+        void MadgwickCorrection(float ax, float ay, float az, float mx, float my, float mz, boolean useMag, float deltat, float* vector)
+        {
+            float q1 = vector[0], q2 = vector[1], q3 = vector[2], q4 = vector[3];   // short name local variable for readability
+            float norm;
+            float s1, s2, s3, s4;
+
+            // Normalise accelerometer measurement
+            norm = ax * ax + ay * ay + az * az;
+            if (norm == 0.0f) return; // handle NaN
+            norm = invSqrt(norm);
+            ax *= norm;
+            ay *= norm;
+            az *= norm;
+
+            if (useMag)
+            {
+                // Normalise magnetometer measurement
+                norm = mx * mx + my * my + mz * mz;
+                if (norm == 0.0f) useMag = false; // 지자기 없이 가속도만으로 보정
+                else
+                {
+                    norm = invSqrt(norm);
+                    mx *= norm;
+                    my *= norm;
+                    mz *= norm;
+                }
+            }
+
+            float _2q1 = 2.0f * q1;
+            float _2q2 = 2.0f * q2;
+            float _2q3 = 2.0f * q3;
+            float _2q4 = 2.0f * q4;
+            float q1q1 = q1 * q1;
+            float q2q2 = q2 * q2;
+            float q3q3 = q3 * q3;
+            float q4q4 = q4 * q4;
+
+            if (useMag)
+            {
+                float _2q1q3 = 2.0f * q1 * q3;
+                float _2q3q4 = 2.0f * q3 * q4;
+                float q1q2 = q1 * q2;
+                float q1q3 = q1 * q3;
+                float q1q4 = q1 * q4;
+                float q2q3 = q2 * q3;
+                float q2q4 = q2 * q4;
+                float q3q4 = q3 * q4;
+
+                // Reference direction of Earth's magnetic field
+                float _2q1mx = 2.0f * q1 * mx;
+                float _2q1my = 2.0f * q1 * my;
+                float _2q1mz = 2.0f * q1 * mz;
+                float _2q2mx = 2.0f * q2 * mx;
+                float hx = mx * q1q1 - _2q1my * q4 + _2q1mz * q3 + mx * q2q2 + _2q2 * my * q3 + _2q2 * mz * q4 - mx * q3q3 - mx * q4q4;
+                float hy = _2q1mx * q4 + my * q1q1 - _2q1mz * q2 + _2q2mx * q3 - my * q2q2 + my * q3q3 + _2q3 * mz * q4 - my * q4q4;
+                float _2bx = hx * hx + hy * hy;
+                _2bx *= invSqrt(_2bx);
+                float _2bz = -_2q1mx * q3 + _2q1my * q2 + mz * q1q1 + _2q2mx * q4 - mz * q2q2 + _2q3 * my * q4 - mz * q3q3 + mz * q4q4;
+                float _4bx = 2.0f * _2bx;
+                float _4bz = 2.0f * _2bz;
+
+                // Gradient decent algorithm corrective step
+                s1 = -_2q3 * (2.0f * q2q4 - _2q1q3 - ax) + _2q2 * (2.0f * q1q2 + _2q3q4 - ay) - _2bz * q3 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (-_2bx * q4 + _2bz * q2) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + _2bx * q3 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+                s2 = _2q4 * (2.0f * q2q4 - _2q1q3 - ax) + _2q1 * (2.0f * q1q2 + _2q3q4 - ay) - 4.0f * q2 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - az) + _2bz * q4 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (_2bx * q3 + _2bz * q1) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + (_2bx * q4 - _4bz * q2) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+                s3 = -_2q1 * (2.0f * q2q4 - _2q1q3 - ax) + _2q4 * (2.0f * q1q2 + _2q3q4 - ay) - 4.0f * q3 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - az) + (-_4bx * q3 - _2bz * q1) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (_2bx * q2 + _2bz * q4) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + (_2bx * q1 - _4bz * q3) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+                s4 = _2q2 * (2.0f * q2q4 - _2q1q3 - ax) + _2q3 * (2.0f * q1q2 + _2q3q4 - ay) + (-_4bx * q4 + _2bz * q2) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (-_2bx * q1 + _2bz * q3) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + _2bx * q2 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
+            }
+            else
+            {
+                // 가속도만 쓰는 경사 하강 보정 단계 (Madgwick IMU 버전)
+                float _4q1 = 4.0f * q1;
+                float _4q2 = 4.0f * q2;
+                float _4q3 = 4.0f * q3;
+                float _8q2 = 8.0f * q2;
+                float _8q3 = 8.0f * q3;
+                s1 = _4q1 * q3q3 + _2q3 * ax + _4q1 * q2q2 - _2q2 * ay;
+                s2 = _4q2 * q4q4 - _2q4 * ax + 4.0f * q1q1 * q2 - _2q1 * ay - _4q2 + _8q2 * q2q2 + _8q2 * q3q3 + _4q2 * az;
+                s3 = 4.0f * q1q1 * q3 + _2q1 * ax + _4q3 * q4q4 - _2q4 * ay - _4q3 + _8q3 * q2q2 + _8q3 * q3q3 + _4q3 * az;
+                s4 = 4.0f * q2q2 * q4 - _2q2 * ax + 4.0f * q3q3 * q4 - _2q3 * ay;
+            }
+            norm = s1 * s1 + s2 * s2 + s3 * s3 + s4 * s4;    // normalise step magnitude
+            if (norm > 0.0f)
+            {
+                norm = beta * deltat * invSqrt(norm);
+                q1 -= s1 * norm;
+                q2 -= s2 * norm;
+                q3 -= s3 * norm;
+                q4 -= s4 * norm;
+            }
+            norm = q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4;    // normalise quaternion
+            norm = invSqrt(norm);
+            vector[0] = q1 * norm;
+            vector[1] = q2 * norm;
+            vector[2] = q3 * norm;
+            vector[3] = q4 * norm;
+        }
+
+        // Mahony 비례/적분 피드백만 적용: 오차 벡터를 각속도처럼 deltat 동안 회전시킨다
+        // useMag가 false이면 중력 방향 오차만 사용한다
+        void MahonyCorrection(float ax, float ay, float az, float mx, float my, float mz, boolean useMag, float deltat, float* vector)
+        {
+            float q1 = vector[0], q2 = vector[1], q3 = vector[2], q4 = vector[3];   // short name local variable for readability
+            float norm;
+            float vx, vy, vz;
+            float ex, ey, ez;
+
+            // Auxiliary variables to avoid repeated arithmetic
+            float q1q1 = q1 * q1;
+            float q1q2 = q1 * q2;
+            float q1q3 = q1 * q3;
+            float q1q4 = q1 * q4;
+            float q2q2 = q2 * q2;
+            float q2q3 = q2 * q3;
+            float q2q4 = q2 * q4;
+            float q3q3 = q3 * q3;
+            float q3q4 = q3 * q4;
+            float q4q4 = q4 * q4;   
+
+            // Normalise accelerometer measurement
+            norm = ax * ax + ay * ay + az * az;
+            if (norm == 0.0f) return; // handle NaN
+            norm = invSqrt(norm);        // use reciprocal for division
+            ax *= norm;
+            ay *= norm;
+            az *= norm;
+
+            // Estimated direction of gravity
+            vx = 2.0f * (q2q4 - q1q3);
+            vy = 2.0f * (q1q2 + q3q4);
+            vz = q1q1 - q2q2 - q3q3 + q4q4;
+
+            // Error is cross product between estimated direction and measured direction of gravity
+            ex = (ay * vz - az * vy);
+            ey = (az * vx - ax * vz);
+            ez = (ax * vy - ay * vx);
+
+            if (useMag)
+            {
+                // Normalise magnetometer measurement
+                norm = mx * mx + my * my + mz * mz;
+                if (norm > 0.0f)
+                {
+                    norm = invSqrt(norm);        // use reciprocal for division
+                    mx *= norm;
+                    my *= norm;
+                    mz *= norm;
+
+                    // Reference direction of Earth's magnetic field
+                    float hx = 2.0f * mx * (0.5f - q3q3 - q4q4) + 2.0f * my * (q2q3 - q1q4) + 2.0f * mz * (q2q4 + q1q3);
+                    float hy = 2.0f * mx * (q2q3 + q1q4) + 2.0f * my * (0.5f - q2q2 - q4q4) + 2.0f * mz * (q3q4 - q1q2);
+                    float bx = hx * hx + hy * hy;
+                    bx *= invSqrt(bx);
+                    float bz = 2.0f * mx * (q2q4 - q1q3) + 2.0f * my * (q3q4 + q1q2) + 2.0f * mz * (0.5f - q2q2 - q3q3);
+
+                    // Estimated direction of magnetic field
+                    float wx = 2.0f * bx * (0.5f - q3q3 - q4q4) + 2.0f * bz * (q2q4 - q1q3);
+                    float wy = 2.0f * bx * (q2q3 - q1q4) + 2.0f * bz * (q1q2 + q3q4);
+                    float wz = 2.0f * bx * (q1q3 + q2q4) + 2.0f * bz * (0.5f - q2q2 - q3q3);  
+
+                    ex += (my * wz - mz * wy);
+                    ey += (mz * wx - mx * wz);
+                    ez += (mx * wy - my * wx);
+                }
+            }
+            if (Ki > 0.0f)
+            {
+                eInt[0] += ex;      // accumulate integral error
+                eInt[1] += ey;
+                eInt[2] += ez;
+            }
+            else
+            {
+                eInt[0] = 0.0f;     // prevent integral wind up
+                eInt[1] = 0.0f;
+                eInt[2] = 0.0f;
+            }
+
+            // Apply feedback terms as a rotation over the correction interval
+            gyroQuaternionUpdate(Kp * ex + Ki * eInt[0], Kp * ey + Ki * eInt[1], Kp * ez + Ki * eInt[2], deltat, vector);
+
+            // Normalise quaternion
+            q1 = vector[0]; q2 = vector[1]; q3 = vector[2]; q4 = vector[3];
+            norm = q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4;
+            norm = invSqrt(norm);
+            vector[0] = q1 * norm;
+            vector[1] = q2 * norm;
+            vector[2] = q3 * norm;
+            vector[3] = q4 * norm;
+        }
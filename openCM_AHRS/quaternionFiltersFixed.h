@@ -0,0 +1,273 @@
+/* 고정소수점(Q-format) Madgwick / Mahony 필터
+ *
+ * OpenCM9.04(Cortex-M3)에는 FPU가 없어서 quaternionFilters.ino의 float 곱셈은 전부
+ * 소프트웨어 라이브러리 호출이 된다. 여기의 함수들은 같은 알고리즘을 정수 곱셈
+ * (SMULL)과 시프트만으로 계산하고, sqrt 대신 정수 역제곱근(fixedRsqrt)을 쓴다.
+ *
+ * 형식
+ *   사원수 q, 단위 벡터, deltat [s], beta [rad/s] : Q30 (1.0 = 1 << 30)
+ *   각속도 gx, gy, gz [rad/s]                       : Q24 (최대 ±128 rad/s)
+ *   Kp, Ki                                            : Q16
+ *   가속도/지자기 입력                                : 단위 무관 정수 (raw 값 그대로 가능, 내부에서 정규화)
+ *   경사(gradient)/오차 벡터 중간값                   : Q25 (±64, 2*q 같은 항이 넘치지 않도록)
+ *   Mahony 적분 오차 eInt                             : Q25, ±FIXED_EINT_MAX(32)에서 포화
+ *
+ * float 버전과의 차이는 매 갱신마다 Q30 절단 오차(약 1e-9) 수준이다. 합성 궤적 200k 샘플에서
+ * 누적 차이는 Madgwick 통합 갱신과 분할 Mahony가 5e-6 이하 (float 쪽 invSqrt 3회 반복 기준),
+ * 기울기 방향이 나쁜 경우(Mahony 통합 갱신, 지자기 없는 분할 Madgwick 보정)는 float와 double도
+ * 5e-3까지 벌어지므로 그 안이다. host/fixed_filters_test.cpp가 이 한계를 확인한다.
+ */
+
+#ifndef _QUATERNION_FILTERS_FIXED_H_
+#define _QUATERNION_FILTERS_FIXED_H_
+
+#define FIXED_ONE           (1L << 30)     // Q30 1.0
+#define FIXED_GRAD_SHIFT    5              // Q30 -> Q25
+#define FIXED_GRAD_FRAC     25
+// Mahony 적분 오차의 한계 (Q25 32.0). 오차 벡터 성분은 ±2 이내라 한 번 더해도 int32를 넘지 않는다.
+// float 버전에는 한계가 없지만, Ki * 32 rad/s 넘게 쌓인 적분은 어차피 발산 중이다
+#define FIXED_EINT_MAX      (1L << 30)
+
+static inline int32 fixedMul(int32 a, int32 b, uint8 frac)
+{
+  return (int32)(((int64)a * b) >> frac);
+}
+
+static inline int32 fixedFromFloat(float x, uint8 frac)
+{
+  return (int32)(x * (float)(1UL << frac));
+}
+
+static inline float fixedToFloat(int32 x, uint8 frac)
+{
+  return (float)x / (float)(1UL << frac);
+}
+
+// 마이크로초 -> Q30 초 (2^50 / 10^6 = 1125899906.8)
+static inline int32 fixedDeltat(uint32 micros)
+{
+  return (int32)(((int64)micros * 1125899907LL) >> 20);
+}
+
+// 1/sqrt(x)의 시작값, x = 1.125, 1.375, ..., 3.875 (Q16)
+static const uint16 fixedRsqrtSeed[12] = {
+  61788, 55889, 51411, 47861, 44957, 42525, 40450, 38651, 37073, 35673, 34421, 33292
+};
+
+// x: Q30, 1 <= x < 4 -> 1/sqrt(x) (Q30)
+// 시작값의 상대 오차 6% 이하, Newton 3회 후 약 3e-9
+static uint32 fixedRsqrt(uint32 x)
+{
+  uint32 y = (uint32)fixedRsqrtSeed[(x - FIXED_ONE) >> 28] << 14;
+  for (uint8 i = 0; i < 3; i++) {
+    uint32 y2 = (uint32)(((uint64)y * y) >> 30);
+    uint32 t = (3UL << 30) - (uint32)(((uint64)x * y2) >> 30);   // 3 - x*y^2
+    y = (uint32)(((uint64)y * t) >> 31);                         // y * (3 - x*y^2) / 2
+  }
+  return y;
+}
+
+// in[n]을 Q30 단위 벡터로 정규화한다. 입력의 스케일은 상관없다 (|in[i]| < 2^30)
+// in과 out이 같은 배열이어도 된다. 영벡터면 false
+static boolean fixedNormalize(const int32 * in, int32 * out, uint8 n)
+{
+  uint64 s = 0;
+  for (uint8 i = 0; i < n; i++) s += (uint64)((int64)in[i] * in[i]);
+  if (s == 0) return false;
+
+  // s = m * 4^-half, 2^60 <= m < 2^62 이 되도록 짝수 비트만큼 옮긴다
+  int8 half = ((int8)__builtin_clzll(s) - 2) >> 1;
+  uint64 m = half >= 0 ? s << (2 * half) : s >> (-2 * half);
+  uint32 r = fixedRsqrt((uint32)(m >> 30));
+
+  // out = in / sqrt(s) * 2^30 = in * r * 2^half / 2^30
+  uint8 shift = 30 - half;
+  for (uint8 i = 0; i < n; i++) out[i] = (int32)(((int64)in[i] * r) >> shift);
+  return true;
+}
+
+// |(a, b)|, a와 b와 같은 형식
+static int32 fixedMagnitude(int32 a, int32 b)
+{
+  int32 v[2] = { a, b }, u[2];
+  if (!fixedNormalize(v, u, 2)) return 0;
+  return fixedMul(a, u[0], 30) + fixedMul(b, u[1], 30);
+}
+
+// q += 0.5 * q ⊗ (0, gx, gy, gz) * deltat, 정규화하지 않는다
+static void gyroQuaternionUpdateFixed(int32 gx, int32 gy, int32 gz, int32 deltat, int32 * q)
+{
+  int32 q1 = q[0], q2 = q[1], q3 = q[2], q4 = q[3];
+  // 반각 증분 (Q24 * Q30 >> 25 = Q30, 0.5배 포함)
+  int32 hx = (int32)(((int64)gx * deltat) >> 25);
+  int32 hy = (int32)(((int64)gy * deltat) >> 25);
+  int32 hz = (int32)(((int64)gz * deltat) >> 25);
+
+  q[0] = q1 - fixedMul(q2, hx, 30) - fixedMul(q3, hy, 30) - fixedMul(q4, hz, 30);
+  q[1] = q2 + fixedMul(q1, hx, 30) + fixedMul(q3, hz, 30) - fixedMul(q4, hy, 30);
+  q[2] = q3 + fixedMul(q1, hy, 30) - fixedMul(q2, hz, 30) + fixedMul(q4, hx, 30);
+  q[3] = q4 + fixedMul(q1, hz, 30) + fixedMul(q2, hy, 30) - fixedMul(q3, hx, 30);
+}
+
+// Madgwick 경사 하강 방향 s (Q30 단위 벡터). a, m은 Q30 단위 벡터, useMag가 false면 IMU 목적함수
+static boolean madgwickGradientFixed(const int32 * q, const int32 * a, const int32 * m, boolean useMag, int32 * s)
+{
+#define M(x, y) fixedMul(x, y, FIXED_GRAD_FRAC)
+  const int32 one = 1L << FIXED_GRAD_FRAC, half = one >> 1;
+  int32 q1 = q[0] >> FIXED_GRAD_SHIFT, q2 = q[1] >> FIXED_GRAD_SHIFT, q3 = q[2] >> FIXED_GRAD_SHIFT, q4 = q[3] >> FIXED_GRAD_SHIFT;
+  int32 ax = a[0] >> FIXED_GRAD_SHIFT, ay = a[1] >> FIXED_GRAD_SHIFT, az = a[2] >> FIXED_GRAD_SHIFT;
+  int32 _2q1 = q1 << 1, _2q2 = q2 << 1, _2q3 = q3 << 1, _2q4 = q4 << 1;
+  int32 q1q1 = M(q1, q1), q2q2 = M(q2, q2), q3q3 = M(q3, q3), q4q4 = M(q4, q4);
+  int32 g[4];
+
+  if (useMag) {
+    int32 mx = m[0] >> FIXED_GRAD_SHIFT, my = m[1] >> FIXED_GRAD_SHIFT, mz = m[2] >> FIXED_GRAD_SHIFT;
+    int32 _2q1q3 = M(_2q1, q3), _2q3q4 = M(_2q3, q4);
+    int32 q1q2 = M(q1, q2), q1q3 = M(q1, q3), q1q4 = M(q1, q4);
+    int32 q2q3 = M(q2, q3), q2q4 = M(q2, q4), q3q4 = M(q3, q4);
+
+    // Reference direction of Earth's magnetic field
+    int32 _2q1mx = M(_2q1, mx), _2q1my = M(_2q1, my), _2q1mz = M(_2q1, mz), _2q2mx = M(_2q2, mx);
+    int32 hx = M(mx, q1q1) - M(_2q1my, q4) + M(_2q1mz, q3) + M(mx, q2q2) + M(M(_2q2, my), q3) + M(M(_2q2, mz), q4) - M(mx, q3q3) - M(mx, q4q4);
+    int32 hy = M(_2q1mx, q4) + M(my, q1q1) - M(_2q1mz, q2) + M(_2q2mx, q3) - M(my, q2q2) + M(my, q3q3) + M(M(_2q3, mz), q4) - M(my, q4q4);
+    int32 _2bx = fixedMagnitude(hx, hy);
+    int32 _2bz = -M(_2q1mx, q3) + M(_2q1my, q2) + M(mz, q1q1) + M(_2q2mx, q4) - M(mz, q2q2) + M(M(_2q3, my), q4) - M(mz, q3q3) + M(mz, q4q4);
+    int32 _4bx = _2bx << 1, _4bz = _2bz << 1;
+
+    // 목적함수 값 (float 버전에서 반복되는 괄호 항)
+    int32 f1 = (q2q4 << 1) - _2q1q3 - ax;
+    int32 f2 = (q1q2 << 1) + _2q3q4 - ay;
+    int32 f3 = one - (q2q2 << 1) - (q3q3 << 1) - az;
+    int32 f4 = M(_2bx, half - q3q3 - q4q4) + M(_2bz, q2q4 - q1q3) - mx;
+    int32 f5 = M(_2bx, q2q3 - q1q4) + M(_2bz, q1q2 + q3q4) - my;
+    int32 f6 = M(_2bx, q1q3 + q2q4) + M(_2bz, half - q2q2 - q3q3) - mz;
+
+    // Gradient decent algorithm corrective step
+    g[0] = -M(_2q3, f1) + M(_2q2, f2) - M(M(_2bz, q3), f4) + M(-M(_2bx, q4) + M(_2bz, q2), f5) + M(M(_2bx, q3), f6);
+    g[1] = M(_2q4, f1) + M(_2q1, f2) - M(q2 << 2, f3) + M(M(_2bz, q4), f4) + M(M(_2bx, q3) + M(_2bz, q1), f5) + M(M(_2bx, q4) - M(_4bz, q2), f6);
+    g[2] = -M(_2q1, f1) + M(_2q4, f2) - M(q3 << 2, f3) + M(-M(_4bx, q3) - M(_2bz, q1), f4) + M(M(_2bx, q2) + M(_2bz, q4), f5) + M(M(_2bx, q1) - M(_4bz, q3), f6);
+    g[3] = M(_2q2, f1) + M(_2q3, f2) + M(-M(_4bx, q4) + M(_2bz, q2), f4) + M(-M(_2bx, q1) + M(_2bz, q3), f5) + M(M(_2bx, q2), f6);
+  } else {
+    // 가속도만 쓰는 경사 하강 보정 단계 (Madgwick IMU 버전)
+    int32 _4q1 = q1 << 2, _4q2 = q2 << 2, _4q3 = q3 << 2, _8q2 = q2 << 3, _8q3 = q3 << 3;
+    g[0] = M(_4q1, q3q3) + M(_2q3, ax) + M(_4q1, q2q2) - M(_2q2, ay);
+    g[1] = M(_4q2, q4q4) - M(_2q4, ax) + M(q1q1 << 2, q2) - M(_2q1, ay) - _4q2 + M(_8q2, q2q2) + M(_8q2, q3q3) + M(_4q2, az);
+    g[2] = M(q1q1 << 2, q3) + M(_2q1, ax) + M(_4q3, q4q4) - M(_2q4, ay) - _4q3 + M(_8q3, q2q2) + M(_8q3, q3q3) + M(_4q3, az);
+    g[3] = M(q2q2 << 2, q4) - M(_2q2, ax) + M(q3q3 << 2, q4) - M(_2q3, ay);
+  }
+#undef M
+  return fixedNormalize(g, s, 4);   // normalise step magnitude
+}
+
+// Mahony 오차 벡터 e (Q25): 추정 방향과 측정 방향의 외적
+static void mahonyErrorFixed(const int32 * q, const int32 * a, const int32 * m, boolean useMag, int32 * e)
+{
+#define M(x, y) fixedMul(x, y, FIXED_GRAD_FRAC)
+  const int32 half = 1L << (FIXED_GRAD_FRAC - 1);
+  int32 q1 = q[0] >> FIXED_GRAD_SHIFT, q2 = q[1] >> FIXED_GRAD_SHIFT, q3 = q[2] >> FIXED_GRAD_SHIFT, q4 = q[3] >> FIXED_GRAD_SHIFT;
+  int32 ax = a[0] >> FIXED_GRAD_SHIFT, ay = a[1] >> FIXED_GRAD_SHIFT, az = a[2] >> FIXED_GRAD_SHIFT;
+  int32 q1q1 = M(q1, q1), q1q2 = M(q1, q2), q1q3 = M(q1, q3), q1q4 = M(q1, q4);
+  int32 q2q2 = M(q2, q2), q2q3 = M(q2, q3), q2q4 = M(q2, q4);
+  int32 q3q3 = M(q3, q3), q3q4 = M(q3, q4), q4q4 = M(q4, q4);
+
+  // Estimated direction of gravity
+  int32 vx = (q2q4 - q1q3) << 1;
+  int32 vy = (q1q2 + q3q4) << 1;
+  int32 vz = q1q1 - q2q2 - q3q3 + q4q4;
+
+  e[0] = M(ay, vz) - M(az, vy);
+  e[1] = M(az, vx) - M(ax, vz);
+  e[2] = M(ax, vy) - M(ay, vx);
+
+  if (useMag) {
+    int32 mx = m[0] >> FIXED_GRAD_SHIFT, my = m[1] >> FIXED_GRAD_SHIFT, mz = m[2] >> FIXED_GRAD_SHIFT;
+
+    // Reference direction of Earth's magnetic field
+    int32 hx = (M(mx, half - q3q3 - q4q4) + M(my, q2q3 - q1q4) + M(mz, q2q4 + q1q3)) << 1;
+    int32 hy = (M(mx, q2q3 + q1q4) + M(my, half - q2q2 - q4q4) + M(mz, q3q4 - q1q2)) << 1;
+    int32 bx = fixedMagnitude(hx, hy);
+    int32 bz = (M(mx, q2q4 - q1q3) + M(my, q3q4 + q1q2) + M(mz, half - q2q2 - q3q3)) << 1;
+
+    // Estimated direction of magnetic field
+    int32 wx = (M(bx, half - q3q3 - q4q4) + M(bz, q2q4 - q1q3)) << 1;
+    int32 wy = (M(bx, q2q3 - q1q4) + M(bz, q1q2 + q3q4)) << 1;
+    int32 wz = (M(bx, q1q3 + q2q4) + M(bz, half - q2q2 - q3q3)) << 1;
+
+    e[0] += M(my, wz) - M(mz, wy);
+    e[1] += M(mz, wx) - M(mx, wz);
+    e[2] += M(mx, wy) - M(my, wx);
+  }
+#undef M
+}
+
+// Mahony 피드백을 적용한 각속도 (Q24)
+static void mahonyFeedbackFixed(const int32 * e, int32 kp, int32 ki, int32 * eInt, int32 * g)
+{
+  for (uint8 i = 0; i < 3; i++) {
+    if (ki > 0) {
+      eInt[i] += e[i];              // accumulate integral error
+      if (eInt[i] > FIXED_EINT_MAX) eInt[i] = FIXED_EINT_MAX;
+      else if (eInt[i] < -FIXED_EINT_MAX) eInt[i] = -FIXED_EINT_MAX;
+    }
+    else eInt[i] = 0;               // prevent integral wind up
+    // Q16 * Q25 >> 17 = Q24
+    g[i] += (int32)(((int64)kp * e[i] + (int64)ki * eInt[i]) >> 17);
+  }
+}
+
+// MadgwickQuaternionUpdate()의 고정소수점 버전
+void MadgwickQuaternionUpdateFixed(int32 ax, int32 ay, int32 az, int32 gx, int32 gy, int32 gz, int32 mx, int32 my, int32 mz, int32 deltat, int32 beta, int32 * q)
+{
+  int32 a[3] = { ax, ay, az }, m[3] = { mx, my, mz }, s[4];
+  if (!fixedNormalize(a, a, 3)) return; // handle NaN
+  if (!fixedNormalize(m, m, 3)) return; // handle NaN
+  boolean corrected = madgwickGradientFixed(q, a, m, true, s);
+
+  // qDot = 0.5 q ⊗ ω - beta s 를 적분
+  int32 bd = fixedMul(beta, deltat, 30);
+  int32 p[4] = { q[0], q[1], q[2], q[3] };
+  gyroQuaternionUpdateFixed(gx, gy, gz, deltat, p);
+  if (corrected) {
+    for (uint8 i = 0; i < 4; i++) p[i] -= fixedMul(bd, s[i], 30);
+  }
+  fixedNormalize(p, q, 4);    // normalise quaternion
+}
+
+// MahonyQuaternionUpdate()의 고정소수점 버전
+void MahonyQuaternionUpdateFixed(int32 ax, int32 ay, int32 az, int32 gx, int32 gy, int32 gz, int32 mx, int32 my, int32 mz, int32 deltat, int32 kp, int32 ki, int32 * eInt, int32 * q)
+{
+  int32 a[3] = { ax, ay, az }, m[3] = { mx, my, mz }, e[3], g[3] = { gx, gy, gz };
+  if (!fixedNormalize(a, a, 3)) return; // handle NaN
+  if (!fixedNormalize(m, m, 3)) return; // handle NaN
+  mahonyErrorFixed(q, a, m, true, e);
+  mahonyFeedbackFixed(e, kp, ki, eInt, g);
+  gyroQuaternionUpdateFixed(g[0], g[1], g[2], deltat, q);
+  fixedNormalize(q, q, 4);    // normalise quaternion
+}
+
+// MadgwickCorrection()의 고정소수점 버전 (다중 주기 스케줄러용)
+void MadgwickCorrectionFixed(int32 ax, int32 ay, int32 az, int32 mx, int32 my, int32 mz, boolean useMag, int32 deltat, int32 beta, int32 * q)
+{
+  int32 a[3] = { ax, ay, az }, m[3] = { mx, my, mz }, s[4];
+  if (!fixedNormalize(a, a, 3)) return; // handle NaN
+  if (useMag && !fixedNormalize(m, m, 3)) useMag = false;
+  if (madgwickGradientFixed(q, a, m, useMag, s)) {
+    int32 bd = fixedMul(beta, deltat, 30);
+    for (uint8 i = 0; i < 4; i++) q[i] -= fixedMul(bd, s[i], 30);
+  }
+  fixedNormalize(q, q, 4);    // normalise quaternion
+}
+
+// MahonyCorrection()의 고정소수점 버전 (다중 주기 스케줄러용)
+void MahonyCorrectionFixed(int32 ax, int32 ay, int32 az, int32 mx, int32 my, int32 mz, boolean useMag, int32 deltat, int32 kp, int32 ki, int32 * eInt, int32 * q)
+{
+  int32 a[3] = { ax, ay, az }, m[3] = { mx, my, mz }, e[3], g[3] = { 0, 0, 0 };
+  if (!fixedNormalize(a, a, 3)) return; // handle NaN
+  if (useMag && !fixedNormalize(m, m, 3)) useMag = false;
+  mahonyErrorFixed(q, a, m, useMag, e);
+  mahonyFeedbackFixed(e, kp, ki, eInt, g);
+  gyroQuaternionUpdateFixed(g[0], g[1], g[2], deltat, q);
+  fixedNormalize(q, q, 4);    // normalise quaternion
+}
+
+#endif /* _QUATERNION_FILTERS_FIXED_H_ */
@@ -0,0 +1,168 @@
+/* 이진 센서 기록 형식
+ *
+ * SerialRecord로 SerialUSB에 내보내는 기록의 형식과 인코더.
+ * 호스트의 host/sensor_log.h(mmap 리더)도 이 파일을 그대로 쓴다.
+ *
+ * 모든 값은 little endian이고, 프레임마다 CRC-16/CCITT(0x1021, 초기값 0xFFFF)가 붙는다.
+ * 바이트가 빠지거나 다른 출력(SerialDebug 등)이 섞여도 리더가 다음 프레임에서 다시 맞춘다.
+ *
+ * 헤더 (48 바이트, 기록 시작/재시작마다 한 번)
+ *    0  'A' 'H' 'R' 'S'
+ *    4  버전 (SENSOR_LOG_VERSION), 헤더 길이
+ *    6  샘플 주기 [us] (uint32)
+ *   10  aRes, gRes, mRes (float)
+ *   22  magCalibration[3] (float)
+ *   34  magBias[3] (float)
+ *   46  CRC
+ *
+ * 샘플 (30 바이트, 샘플마다)
+ *    0  0xA5
+ *    1  플래그 (bit 0: magFresh)
+ *    2  index (uint32)
+ *    6  captureMicros (uint32)
+ *   10  accel[3], gyro[3], mag[3] (int16 raw)
+ *   28  CRC
+ *
+ * 텍스트 기록(샘플당 약 60 바이트, print 호출 수십 번)보다 절반 크기이고
+ * SerialUSB.write() 한 번으로 끝나며 raw 값을 그대로 보존한다.
+ */
+
+#ifndef _SENSOR_LOG_H_
+#define _SENSOR_LOG_H_
+
+#include <string.h>
+#include "sensorSample.h"
+
+#define SENSOR_LOG_VERSION        1
+#define SENSOR_LOG_HEADER_SIZE    48
+#define SENSOR_LOG_RECORD_SIZE    30
+#define SENSOR_LOG_RECORD_SYNC    0xA5
+#define SENSOR_LOG_MAG_FRESH      0x01
+
+struct SensorLogHeader {
+  uint32 samplePeriod;      // [us]
+  float aRes, gRes, mRes;   // LSB당 g, deg/s, mG
+  float magCalibration[3];  // AK8963 공장 보정값
+  float magBias[3];         // 사용자 지자기 보정 [mG]
+};
+
+// CRC-16/CCITT, 4비트 표 (16개, 32 바이트 플래시)
+static inline uint16 sensorLogCrc(const uint8 * data, uint16 length)
+{
+  static const uint16 table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+  };
+  uint16 crc = 0xFFFF;
+  for (uint16 i = 0; i < length; i++) {
+    crc = (crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)];
+    crc = (crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)];
+  }
+  return crc;
+}
+
+static inline void sensorLogPut16(uint8 * p, uint16 v)
+{
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+static inline void sensorLogPut32(uint8 * p, uint32 v)
+{
+  p[0] = v & 0xFF;
+  p[1] = (v >> 8) & 0xFF;
+  p[2] = (v >> 16) & 0xFF;
+  p[3] = v >> 24;
+}
+
+static inline void sensorLogPutFloat(uint8 * p, float f)
+{
+  uint32 v;
+  memcpy(&v, &f, 4);
+  sensorLogPut32(p, v);
+}
+
+static inline uint16 sensorLogGet16(const uint8 * p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static inline uint32 sensorLogGet32(const uint8 * p)
+{
+  return p[0] | (p[1] << 8) | ((uint32)p[2] << 16) | ((uint32)p[3] << 24);
+}
+
+static inline float sensorLogGetFloat(const uint8 * p)
+{
+  uint32 v = sensorLogGet32(p);
+  float f;
+  memcpy(&f, &v, 4);
+  return f;
+}
+
+// 헤더 프레임을 buf(SENSOR_LOG_HEADER_SIZE)에 만든다
+static inline void sensorLogEncodeHeader(uint8 * buf, const SensorLogHeader * h)
+{
+  buf[0] = 'A'; buf[1] = 'H'; buf[2] = 'R'; buf[3] = 'S';
+  buf[4] = SENSOR_LOG_VERSION;
+  buf[5] = SENSOR_LOG_HEADER_SIZE;
+  sensorLogPut32(&buf[6], h->samplePeriod);
+  sensorLogPutFloat(&buf[10], h->aRes);
+  sensorLogPutFloat(&buf[14], h->gRes);
+  sensorLogPutFloat(&buf[18], h->mRes);
+  for (uint8 i = 0; i < 3; i++) {
+    sensorLogPutFloat(&buf[22 + 4*i], h->magCalibration[i]);
+    sensorLogPutFloat(&buf[34 + 4*i], h->magBias[i]);
+  }
+  sensorLogPut16(&buf[46], sensorLogCrc(buf, 46));
+}
+
+// 샘플 프레임을 buf(SENSOR_LOG_RECORD_SIZE)에 만든다
+static inline void sensorLogEncodeSample(uint8 * buf, const SensorSample * s)
+{
+  buf[0] = SENSOR_LOG_RECORD_SYNC;
+  buf[1] = s->magFresh ? SENSOR_LOG_MAG_FRESH : 0;
+  sensorLogPut32(&buf[2], s->index);
+  sensorLogPut32(&buf[6], s->captureMicros);
+  for (uint8 i = 0; i < 3; i++) {
+    sensorLogPut16(&buf[10 + 2*i], s->accel[i]);
+    sensorLogPut16(&buf[16 + 2*i], s->gyro[i]);
+    sensorLogPut16(&buf[22 + 2*i], s->mag[i]);
+  }
+  sensorLogPut16(&buf[28], sensorLogCrc(buf, 28));
+}
+
+// buf가 CRC까지 맞는 헤더 프레임이면 h에 풀어 넣고 true
+static inline boolean sensorLogDecodeHeader(const uint8 * buf, SensorLogHeader * h)
+{
+  if (buf[0] != 'A' || buf[1] != 'H' || buf[2] != 'R' || buf[3] != 'S') return false;
+  if (buf[4] != SENSOR_LOG_VERSION || buf[5] != SENSOR_LOG_HEADER_SIZE) return false;
+  if (sensorLogGet16(&buf[46]) != sensorLogCrc(buf, 46)) return false;
+  h->samplePeriod = sensorLogGet32(&buf[6]);
+  h->aRes = sensorLogGetFloat(&buf[10]);
+  h->gRes = sensorLogGetFloat(&buf[14]);
+  h->mRes = sensorLogGetFloat(&buf[18]);
+  for (uint8 i = 0; i < 3; i++) {
+    h->magCalibration[i] = sensorLogGetFloat(&buf[22 + 4*i]);
+    h->magBias[i] = sensorLogGetFloat(&buf[34 + 4*i]);
+  }
+  return true;
+}
+
+// buf가 CRC까지 맞는 샘플 프레임이면 s에 풀어 넣고 true
+static inline boolean sensorLogDecodeSample(const uint8 * buf, SensorSample * s)
+{
+  if (buf[0] != SENSOR_LOG_RECORD_SYNC) return false;
+  if (sensorLogGet16(&buf[28]) != sensorLogCrc(buf, 28)) return false;
+  s->magFresh = (buf[1] & SENSOR_LOG_MAG_FRESH) != 0;
+  s->index = sensorLogGet32(&buf[2]);
+  s->captureMicros = sensorLogGet32(&buf[6]);
+  for (uint8 i = 0; i < 3; i++) {
+    s->accel[i] = (int16)sensorLogGet16(&buf[10 + 2*i]);
+    s->gyro[i] = (int16)sensorLogGet16(&buf[16 + 2*i]);
+    s->mag[i] = (int16)sensorLogGet16(&buf[22 + 2*i]);
+  }
+  return true;
+}
+
+#endif /* _SENSOR_LOG_H_ */
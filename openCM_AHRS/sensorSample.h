@@ -0,0 +1,38 @@
+/* 센서 샘플 기록
+ *
+ * data ready 인터럽트 한 번에 대응하는 샘플 하나를 담는다.
+ * 캡처 시각은 ISR에서 찍기 때문에 I2C 읽기나 필터 계산이 늦어져도
+ * 적분 시간(dt)에 버스 지터가 섞이지 않고, 액추에이터 출력 시점과 비교하면
+ * 센서-모터 사이의 지연 시간을 그대로 잴 수 있다.
+ *
+ * .ino 파일에 구조체를 두면 IDE가 만드는 함수 원형보다 뒤에 선언되므로
+ * 구조체를 인자로 받는 함수를 위해 헤더로 분리했다.
+ */
+
+#ifndef _SENSOR_SAMPLE_H_
+#define _SENSOR_SAMPLE_H_
+
+struct SensorSample {
+  uint32 captureMicros;  // data ready ISR이 기록한 시각 [us]
+  uint32 index;          // 센서 샘플 번호, 놓친 샘플만큼 건너뛴다
+  int16 accel[3];        // 가속도 raw 값
+  int16 gyro[3];         // 각속도 raw 값
+  int16 mag[3];          // 지자기 raw 값 (새 데이터가 없으면 이전 값 유지)
+  boolean magFresh;      // 이번 샘플에서 AK8963의 새 데이터를 읽었는지
+};
+
+// 두 샘플의 캡처 시각 차이 [s]
+static inline float sampleDeltat(const SensorSample * prev, const SensorSample * cur)
+{
+  return (cur->captureMicros - prev->captureMicros) / 1000000.0f;
+}
+
+// prev 이후 지난 샘플 수 (샘플 주기 periodMicros 기준 반올림, 최소 1)
+// INT 에지를 놓쳐도 index가 실제 센서 샘플 번호를 따라가게 한다
+static inline uint32 sampleSteps(const SensorSample * prev, const SensorSample * cur, uint32 periodMicros)
+{
+  uint32 steps = (cur->captureMicros - prev->captureMicros + periodMicros / 2) / periodMicros;
+  return steps ? steps : 1;
+}
+
+#endif /* _SENSOR_SAMPLE_H_ */
@@ -0,0 +1,144 @@
+/* 이진 텔레메트리 프레임
+ *
+ * SerialDebug 출력을 print 수십 번 대신 SerialUSB.write() 한 번으로 보낸다.
+ * 호스트 디코더는 host/telemetry_decode.cpp.
+ *
+ * 프레임 = COBS(페이로드 + CRC) + 0x00
+ * COBS로 인코딩하면 프레임 안에 0x00이 없으므로 0x00만 찾으면 프레임 경계가 된다.
+ * CRC는 sensorLog.h와 같은 CRC-16/CCITT, 값은 모두 little endian.
+ *
+ * 페이로드 (50 바이트)
+ *    0  버전 (TELEMETRY_VERSION)
+ *    1  프레임 번호 (1씩 증가, 빠진 프레임 확인용)
+ *    2  captureMicros (uint32)
+ *    6  q[4] (int16, x16384)
+ *   14  yaw, pitch, roll (int16, x100 deg, 모터 영점 기준)
+ *   20  accel[3], gyro[3], mag[3] (int16 raw)
+ *   38  필터 주기, 보정 주기 (uint16, x10 Hz, 6553.5 Hz에서 포화)
+ *   42  지연 시간 평균, 최대 (uint16, us, 65535에서 포화)
+ *   46  놓친 샘플 수 (uint32)
+ */
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include "sensorLog.h"
+
+#define TELEMETRY_VERSION         1
+#define TELEMETRY_PAYLOAD_SIZE    50
+#define TELEMETRY_FRAME_MAX       (TELEMETRY_PAYLOAD_SIZE + 2 + 2)   // CRC, COBS 오버헤드 1, 구분자 1
+
+struct TelemetryFrame {
+  uint8 seq;
+  uint32 captureMicros;
+  float q[4];
+  float ypr[3];             // [deg]
+  int16 accel[3], gyro[3], mag[3];
+  float rate;               // 필터 주기 [Hz]
+  float correctionRate;     // 보정 주기 [Hz]
+  uint16 latencyAvg, latencyMax;  // [us]
+  uint32 dropped;
+};
+
+// 범위를 넘는 값은 int16 끝값으로 자른다
+static inline int16 telemetryScale(float v, float scale)
+{
+  v *= scale;
+  if (v > 32767.0f) return 32767;
+  if (v < -32768.0f) return -32768;
+  return (int16)(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+// 부호 없는 값 (주기), 범위를 넘으면 0 또는 65535로 자른다
+static inline uint16 telemetryScaleUnsigned(float v, float scale)
+{
+  v *= scale;
+  if (v > 65535.0f) return 65535;
+  if (!(v > 0.0f)) return 0;
+  return (uint16)(v + 0.5f);
+}
+
+// COBS 인코딩, 끝에 0x00 구분자까지 붙인다 (254 바이트 이하 입력)
+static inline uint8 telemetryCobs(const uint8 * in, uint8 length, uint8 * out)
+{
+  uint8 code = 1;
+  uint8 codeIndex = 0;
+  uint8 o = 1;
+  for (uint8 i = 0; i < length; i++) {
+    if (in[i] == 0) {
+      out[codeIndex] = code;
+      code = 1;
+      codeIndex = o++;
+    } else {
+      out[o++] = in[i];
+      code++;
+    }
+  }
+  out[codeIndex] = code;
+  out[o++] = 0;
+  return o;
+}
+
+// COBS 디코딩 (구분자 제외), 잘못된 프레임이면 0
+static inline uint8 telemetryUncobs(const uint8 * in, uint8 length, uint8 * out)
+{
+  uint8 o = 0;
+  uint8 i = 0;
+  while (i < length) {
+    uint8 code = in[i++];
+    if (code == 0 || i + code - 1 > length) return 0;
+    for (uint8 k = 1; k < code; k++) out[o++] = in[i++];
+    if (code < 0xFF && i < length) out[o++] = 0;
+  }
+  return o;
+}
+
+// 프레임을 out(TELEMETRY_FRAME_MAX)에 만들고 길이를 돌려준다
+static inline uint8 telemetryEncode(uint8 * out, const TelemetryFrame * t)
+{
+  uint8 p[TELEMETRY_PAYLOAD_SIZE + 2];
+  p[0] = TELEMETRY_VERSION;
+  p[1] = t->seq;
+  sensorLogPut32(&p[2], t->captureMicros);
+  for (uint8 i = 0; i < 4; i++) sensorLogPut16(&p[6 + 2*i], telemetryScale(t->q[i], 16384.0f));
+  for (uint8 i = 0; i < 3; i++) {
+    sensorLogPut16(&p[14 + 2*i], telemetryScale(t->ypr[i], 100.0f));
+    sensorLogPut16(&p[20 + 2*i], t->accel[i]);
+    sensorLogPut16(&p[26 + 2*i], t->gyro[i]);
+    sensorLogPut16(&p[32 + 2*i], t->mag[i]);
+  }
+  sensorLogPut16(&p[38], telemetryScaleUnsigned(t->rate, 10.0f));
+  sensorLogPut16(&p[40], telemetryScaleUnsigned(t->correctionRate, 10.0f));
+  sensorLogPut16(&p[42], t->latencyAvg);
+  sensorLogPut16(&p[44], t->latencyMax);
+  sensorLogPut32(&p[46], t->dropped);
+  sensorLogPut16(&p[TELEMETRY_PAYLOAD_SIZE], sensorLogCrc(p, TELEMETRY_PAYLOAD_SIZE));
+  return telemetryCobs(p, TELEMETRY_PAYLOAD_SIZE + 2, out);
+}
+
+// 구분자를 뺀 COBS 프레임을 풀어 t에 넣는다, CRC가 맞으면 true
+static inline boolean telemetryDecode(const uint8 * in, uint8 length, TelemetryFrame * t)
+{
+  uint8 p[255];
+  if (length > TELEMETRY_FRAME_MAX) return false;
+  if (telemetryUncobs(in, length, p) != TELEMETRY_PAYLOAD_SIZE + 2) return false;
+  if (p[0] != TELEMETRY_VERSION) return false;
+  if (sensorLogGet16(&p[TELEMETRY_PAYLOAD_SIZE]) != sensorLogCrc(p, TELEMETRY_PAYLOAD_SIZE)) return false;
+  t->seq = p[1];
+  t->captureMicros = sensorLogGet32(&p[2]);
+  for (uint8 i = 0; i < 4; i++) t->q[i] = (int16)sensorLogGet16(&p[6 + 2*i]) / 16384.0f;
+  for (uint8 i = 0; i < 3; i++) {
+    t->ypr[i] = (int16)sensorLogGet16(&p[14 + 2*i]) / 100.0f;
+    t->accel[i] = (int16)sensorLogGet16(&p[20 + 2*i]);
+    t->gyro[i] = (int16)sensorLogGet16(&p[26 + 2*i]);
+    t->mag[i] = (int16)sensorLogGet16(&p[32 + 2*i]);
+  }
+  t->rate = sensorLogGet16(&p[38]) / 10.0f;
+  t->correctionRate = sensorLogGet16(&p[40]) / 10.0f;
+  t->latencyAvg = sensorLogGet16(&p[42]);
+  t->latencyMax = sensorLogGet16(&p[44]);
+  t->dropped = sensorLogGet32(&p[46]);
+  return true;
+}
+
+#endif /* _TELEMETRY_H_ */